@@ -0,0 +1,158 @@
+// Compares JSON and binary snapshots, plain and compressed: save time, load
+// time and file size, plus the cost of an incremental save after a single
+// change.
+//
+// usage: snapshot_benchmark [total_mb=64] [file_kb=256]
+//   snapshot_benchmark 1024   -> 1GB tree of 256KB files
+//
+// Snapshots are written to data/ and removed afterwards.
+
+#include "storage/Storage.h"
+#include "testHelpers/MockSysApi.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+using storage::StorageManager;
+using Response = StorageManager::StorageResponse;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t FILES_PER_FOLDER = 64;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Printable content so the JSON format can hold it as a string
+std::string makeContent(size_t size, size_t seed) {
+    std::string content(size, ' ');
+    for (size_t i = 0; i < size; ++i) {
+        content[i] = static_cast<char>('a' + (i * 7 + seed) % 26);
+        if (i % 80 == 79) content[i] = '\n';
+    }
+    return content;
+}
+
+bool buildTree(StorageManager& storage, size_t totalBytes, size_t fileBytes, size_t& outFiles) {
+    size_t fileCount = (totalBytes + fileBytes - 1) / fileBytes;
+    for (size_t i = 0; i < fileCount; ++i) {
+        std::string folder = "/dir" + std::to_string(i / FILES_PER_FOLDER);
+        if (i % FILES_PER_FOLDER == 0 && storage.makeDir(folder) != Response::OK) return false;
+
+        std::string path = folder + "/file" + std::to_string(i);
+        if (storage.createFile(path) != Response::OK) return false;
+        // writeFile adds a trailing newline
+        if (storage.writeFile(path, makeContent(fileBytes - 1, i)) != Response::OK) return false;
+    }
+    outFiles = fileCount;
+    return true;
+}
+
+void runFormat(const char* label, const std::string& name, const std::string& path, bool lazy, bool compress,
+               StorageManager& source, size_t totalBytes, const std::string& probePath,
+               const std::string& probeContent) {
+    auto start = Clock::now();
+    if (source.saveToDisk(name, false, compress) != Response::OK) {
+        std::printf("%-6s save failed\n", label);
+        return;
+    }
+    double saveSeconds = secondsSince(start);
+    auto fileSize = std::filesystem::file_size(path);
+
+    testHelpers::MockSysApi loadSys;
+    StorageManager loaded;
+    loaded.setLogCallback([](const std::string&, const std::string&, const std::string&) {});
+    loaded.setSysApi(&loadSys);
+
+    start = Clock::now();
+    if (loaded.loadFromDisk(name, lazy) != Response::OK) {
+        std::printf("%-6s load failed\n", label);
+        std::filesystem::remove(path);
+        return;
+    }
+    double loadSeconds = secondsSince(start);
+
+    std::string check;
+    bool intact = loaded.readFile(probePath, check) == Response::OK && check == probeContent;
+
+    double mb = static_cast<double>(totalBytes) / (1024.0 * 1024.0);
+    std::printf("%-6s save %8.3fs (%7.1f MB/s)  load %8.3fs (%7.1f MB/s)  size %12llu bytes  %s\n",
+                label, saveSeconds, mb / saveSeconds, loadSeconds, mb / loadSeconds,
+                static_cast<unsigned long long>(fileSize), intact ? "ok" : "MISMATCH");
+
+    std::filesystem::remove(path);
+}
+
+// Incremental save after touching one file, on top of a full binary base
+void runDelta(StorageManager& source, const std::string& probePath) {
+    const std::string name = "snapshot_bench_delta.bin";
+    const std::string path = "data/" + name;
+    if (source.saveToDisk(name) != Response::OK ||
+        source.writeFile(probePath, "changed") != Response::OK) {
+        std::printf("delta  setup failed\n");
+        return;
+    }
+
+    auto start = Clock::now();
+    Response result = source.saveToDisk(name, true);
+    double saveSeconds = secondsSince(start);
+    if (result != Response::OK) {
+        std::printf("delta  save failed\n");
+    } else {
+        std::printf("delta  save %8.3fs for one changed file, delta %llu bytes\n", saveSeconds,
+                    static_cast<unsigned long long>(std::filesystem::file_size(path + ".delta")));
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".delta");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t totalMb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    size_t fileKb = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 256;
+    if (totalMb == 0 || fileKb == 0) {
+        std::fprintf(stderr, "usage: %s [total_mb] [file_kb]\n", argv[0]);
+        return 1;
+    }
+    size_t totalBytes = totalMb * 1024 * 1024;
+    size_t fileBytes = fileKb * 1024;
+
+    testHelpers::MockSysApi sys;
+    StorageManager storage;
+    storage.setLogCallback([](const std::string&, const std::string&, const std::string&) {});
+    storage.setSysApi(&sys);
+
+    size_t fileCount = 0;
+    auto start = Clock::now();
+    if (!buildTree(storage, totalBytes, fileBytes, fileCount)) {
+        std::fprintf(stderr, "failed to build the tree\n");
+        return 1;
+    }
+    std::printf("tree: %zu files of %zu KB (%zu MB) built in %.3fs\n",
+                fileCount, fileKb, totalMb, secondsSince(start));
+
+    std::string probePath = "/dir0/file0";
+    std::string probeContent;
+    storage.readFile(probePath, probeContent);
+
+    runFormat("json", "snapshot_bench", "data/snapshot_bench.json", false, false,
+              storage, totalBytes, probePath, probeContent);
+    runFormat("json.z", "snapshot_bench", "data/snapshot_bench.json", false, true,
+              storage, totalBytes, probePath, probeContent);
+    runFormat("binary", "snapshot_bench.bin", "data/snapshot_bench.bin", false, false,
+              storage, totalBytes, probePath, probeContent);
+    runFormat("bin.z", "snapshot_bench.bin", "data/snapshot_bench.bin", false, true,
+              storage, totalBytes, probePath, probeContent);
+    // lazy load time covers only the tree; the probe read pulls in one file
+    runFormat("lazy", "snapshot_bench.bin", "data/snapshot_bench.bin", true, false,
+              storage, totalBytes, probePath, probeContent);
+    runDelta(storage, probePath);
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+// Measures what the tree itself costs: builds folders of empty files with
+// the kind of names real trees repeat (every folder holds the same file
+// names), then reports host memory per node and how fast a full walk goes.
+//
+// usage: storage_memory_benchmark [folders=1000] [files_per_folder=1000]
+//   storage_memory_benchmark 4000 500   -> 2M files in 4000 folders
+
+#include "storage/Storage.h"
+#include "testHelpers/MockSysApi.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using storage::StorageManager;
+using Response = StorageManager::StorageResponse;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Resident set size of this process
+size_t residentBytes() {
+    long pages = 0, resident = 0;
+    if (std::FILE* statm = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        std::fclose(statm);
+    }
+    return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+std::string fileName(size_t n) {
+    static const char* kinds[] = {".log", ".txt", ".json", ".csv"};
+    char name[32];
+    std::snprintf(name, sizeof(name), "part-%05zu%s", n, kinds[n % 4]);
+    return name;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t folders = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    size_t filesPerFolder = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+    if (folders == 0) {
+        std::fprintf(stderr, "usage: %s [folders] [files_per_folder]\n", argv[0]);
+        return 1;
+    }
+
+    testHelpers::MockSysApi sys;
+    StorageManager storage;
+    storage.setLogCallback([](const std::string&, const std::string&, const std::string&) {});
+    storage.setSysApi(&sys);
+    storage.setDedup(false);
+
+    std::vector<std::string> names;
+    for (size_t f = 0; f < filesPerFolder; ++f) names.push_back(fileName(f));
+
+    size_t before = residentBytes();
+    auto started = Clock::now();
+    for (size_t d = 0; d < folders; ++d) {
+        std::string dir = "/d" + std::to_string(d / 100) + "/project-" + std::to_string(d);
+        if (d % 100 == 0 && storage.makeDir("/d" + std::to_string(d / 100)) != Response::OK) return 1;
+        if (storage.makeDir(dir) != Response::OK) return 1;
+        for (const auto& name : names) {
+            if (storage.createFile(dir + "/" + name) != Response::OK) return 1;
+        }
+    }
+    double buildSeconds = secondsSince(started);
+    size_t after = residentBytes();
+
+    StorageManager::DirUsage usage;
+    storage.dirUsage("/", usage);
+    size_t nodes = usage.folders + usage.files;
+    std::printf("tree: %zu folders, %zu files, built in %.2fs\n", static_cast<size_t>(usage.folders),
+                static_cast<size_t>(usage.files), buildSeconds);
+    std::printf("node structs: File %zu bytes, Folder %zu bytes, FileContent %zu bytes\n",
+                sizeof(StorageManager::File), sizeof(StorageManager::Folder), sizeof(storage::FileContent));
+    storage::NameTableStats table = storage::nameTableStats();
+    std::printf("names: %zu distinct, %.1f KB in the name table\n", static_cast<size_t>(table.names),
+                static_cast<double>(table.bytes) / 1024.0);
+    std::printf("host memory: %.1f MB, %.1f bytes per node\n", static_cast<double>(after - before) / (1024.0 * 1024.0),
+                static_cast<double>(after - before) / static_cast<double>(nodes));
+
+    // a full walk touching every node's name, size and time
+    StorageManager::FindQuery query;
+    query.nameGlob = "*.json";
+    size_t matched = 0;
+    started = Clock::now();
+    storage.find("/", query, [&matched](const StorageManager::FoundEntry&) {
+        ++matched;
+        return true;
+    });
+    double walkSeconds = secondsSince(started);
+    std::printf("find: %zu of %zu nodes matched in %.3fs, %.1fM nodes/s\n", matched, nodes, walkSeconds,
+                walkSeconds > 0 ? static_cast<double>(nodes) / walkSeconds / 1e6 : 0.0);
+
+    // one lookup per file by path
+    started = Clock::now();
+    StorageManager::FileStat stat;
+    size_t found = 0;
+    for (size_t d = 0; d < folders; d += 7) {
+        std::string dir = "/d" + std::to_string(d / 100) + "/project-" + std::to_string(d) + "/";
+        for (const auto& name : names) found += storage.statFile(dir + name, stat) == Response::OK;
+    }
+    double statSeconds = secondsSince(started);
+    std::printf("stat: %zu lookups in %.3fs, %.2f us each\n", found, statSeconds,
+                found > 0 ? statSeconds * 1e6 / static_cast<double>(found) : 0.0);
+    return 0;
+}
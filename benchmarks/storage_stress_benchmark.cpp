@@ -0,0 +1,129 @@
+// Hammers one StorageManager from several threads at once: each reader
+// resolves a path, reads a 4KB file and lists its folder in a loop. Reports
+// reads per second for 1, 2, 4, ... threads, alone and next to a writer
+// that keeps rewriting files and creating and removing folders.
+//
+// usage: storage_stress_benchmark [max_threads=cores] [seconds=1]
+//   storage_stress_benchmark 16 2   -> up to 16 readers, 2s per run
+
+#include "storage/Storage.h"
+#include "testHelpers/MockSysApi.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using storage::StorageManager;
+using Response = StorageManager::StorageResponse;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr size_t FOLDERS = 64;
+constexpr size_t FILES_PER_FOLDER = 32;
+constexpr size_t FILE_BYTES = 4096;
+
+std::string filePath(size_t n) {
+    return "/dir" + std::to_string(n / FILES_PER_FOLDER % FOLDERS) + "/file" + std::to_string(n % FILES_PER_FOLDER);
+}
+
+bool buildTree(StorageManager& storage) {
+    for (size_t d = 0; d < FOLDERS; ++d) {
+        if (storage.makeDir("/dir" + std::to_string(d)) != Response::OK) return false;
+    }
+    for (size_t n = 0; n < FOLDERS * FILES_PER_FOLDER; ++n) {
+        std::string path = filePath(n);
+        if (storage.createFile(path) != Response::OK) return false;
+        if (storage.writeFile(path, std::string(FILE_BYTES - 1, static_cast<char>('a' + n % 26))) != Response::OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads per second over all readers
+double run(StorageManager& storage, unsigned readers, bool withWriter, double seconds) {
+    std::atomic<bool> stop{false};
+    std::vector<uint64_t> counts(readers, 0);
+    std::vector<std::thread> threads;
+    for (unsigned r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            std::string content;
+            std::vector<StorageManager::DirEntry> entries;
+            // precomputed paths keep string building out of the measurement
+            std::vector<std::string> paths;
+            for (size_t n = r; n < FOLDERS * FILES_PER_FOLDER; n += 7) paths.push_back(filePath(n));
+            uint64_t done = 0;
+            for (size_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+                const std::string& path = paths[i % paths.size()];
+                storage.readFile(path, content);
+                if (i % 8 == 0) storage.listDirEntries(path.substr(0, path.rfind('/')), entries);
+                ++done;
+            }
+            counts[r] = done;
+        });
+    }
+
+    std::thread writer;
+    std::atomic<uint64_t> writes{0};
+    if (withWriter) {
+        writer = std::thread([&] {
+            for (size_t n = 0; !stop.load(std::memory_order_relaxed); ++n) {
+                storage.writeFile(filePath(n * 13), std::string(FILE_BYTES - 1, static_cast<char>('a' + n % 26)));
+                if (n % 16 == 0) {
+                    storage.makeDir("/scratch");
+                    storage.removeDir("/scratch");
+                }
+                ++writes;
+            }
+        });
+    }
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& thread : threads) thread.join();
+    if (writer.joinable()) writer.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    uint64_t total = 0;
+    for (uint64_t count : counts) total += count;
+    if (withWriter) std::printf("    (writer: %.0f writes/s)\n", static_cast<double>(writes.load()) / elapsed);
+    return static_cast<double>(total) / elapsed;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    unsigned cores = std::thread::hardware_concurrency();
+    unsigned maxThreads = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : (cores ? cores : 4);
+    double seconds = argc > 2 ? std::strtod(argv[2], nullptr) : 1.0;
+    if (maxThreads == 0 || seconds <= 0) {
+        std::fprintf(stderr, "usage: %s [max_threads] [seconds]\n", argv[0]);
+        return 1;
+    }
+
+    testHelpers::MockSysApi sys;
+    StorageManager storage;
+    storage.setLogCallback([](const std::string&, const std::string&, const std::string&) {});
+    storage.setSysApi(&sys);
+    if (!buildTree(storage)) {
+        std::fprintf(stderr, "failed to build the tree\n");
+        return 1;
+    }
+    std::printf("tree: %zu folders of %zu files of %zu bytes\n", FOLDERS, FILES_PER_FOLDER, FILE_BYTES);
+
+    for (bool withWriter : {false, true}) {
+        std::printf("%s\n", withWriter ? "readers next to one writer:" : "readers only:");
+        double single = 0;
+        for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+            double rate = run(storage, threads, withWriter, seconds);
+            if (threads == 1) single = rate;
+            std::printf("  %3u threads  %12.0f reads/s  x%.2f\n", threads, rate, single > 0 ? rate / single : 0.0);
+        }
+    }
+    return 0;
+}
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <sstream>
 #include <iomanip>
 #include <ctime>
+#include <unordered_map>
 
 namespace common {
 
@@ -54,4 +56,35 @@ public:
     }
 };
 
+// Formats many time points as "YYYY-MM-DD HH:MM:SS" (Format::DateTimeSeconds),
+// converting each distinct second only once. Listings repeat the same few
+// seconds over and over. A returned view is valid until the next call.
+class TimeFormatCache {
+public:
+    std::string_view format(std::time_t seconds) {
+        auto it = cache.find(seconds);
+        if (it == cache.end()) {
+            if (cache.size() >= MAX_ENTRIES) cache.clear();
+            std::tm local{};
+#ifdef _WIN32
+            localtime_s(&local, &seconds);
+#else
+            localtime_r(&seconds, &local);
+#endif
+            char text[32];
+            size_t length = std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+            it = cache.emplace(seconds, std::string(text, length)).first;
+        }
+        return it->second;
+    }
+
+    std::string_view format(const std::chrono::system_clock::time_point& tp) {
+        return format(std::chrono::system_clock::to_time_t(tp));
+    }
+
+private:
+    static constexpr size_t MAX_ENTRIES = 4096;
+    std::unordered_map<std::time_t, std::string> cache;
+};
+
 } // namespace common
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace common {
+
+// Fixed set of host threads running submitted tasks in FIFO order.
+// Destroying the pool finishes the queued tasks first.
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned threads = defaultThreads()) {
+        threads = std::max(threads, 1u);
+        workers.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i) {
+            workers.emplace_back([this] { run(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    static unsigned defaultThreads() {
+        unsigned cores = std::thread::hardware_concurrency();
+        return cores > 0 ? cores : 2;
+    }
+
+    // Process-wide pool for host-side work split across cores
+    static WorkerPool& shared() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    size_t size() const { return workers.size(); }
+
+    // The future carries the result, or the exception fn threw
+    template <typename Fn>
+    auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>> {
+        using Result = std::invoke_result_t<Fn>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        auto future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace_back([task] { (*task)(); });
+        }
+        wake.notify_one();
+        return future;
+    }
+
+    // Calls fn(i) for every i in [0, count), spread over the pool and the
+    // calling thread; returns when all calls are done. Not for use from
+    // inside a pool task, which would wait on tasks queued behind itself.
+    template <typename Fn>
+    void parallelFor(size_t count, Fn&& fn) {
+        std::atomic<size_t> next{0};
+        auto drain = [&] {
+            for (size_t i = next++; i < count; i = next++) fn(i);
+        };
+        std::vector<std::future<void>> helpers;
+        size_t helperCount = std::min(count > 0 ? count - 1 : 0, workers.size());
+        helpers.reserve(helperCount);
+        for (size_t i = 0; i < helperCount; ++i) helpers.push_back(submit(drain));
+
+        // the helpers use this frame, so they finish before anything is rethrown
+        std::exception_ptr error;
+        try {
+            drain();
+        } catch (...) {
+            error = std::current_exception();
+            next = count;
+        }
+        for (auto& helper : helpers) {
+            try {
+                helper.get();
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+            auto task = std::move(tasks.front());
+            tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+};
+
+}  // namespace common
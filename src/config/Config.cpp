@@ -26,6 +26,12 @@ bool Config::parseArgs(int argc, char* argv[], Config& config) {
         {"prio", scheduler::SchedulerAlgorithm::Priority}
     };
 
+    static const std::map<std::string, storage::JournalSync> journalSyncMap = {
+        {"always", storage::JournalSync::Always},
+        {"batch", storage::JournalSync::Batch},
+        {"never", storage::JournalSync::Never}
+    };
+
     const size_t MAX_MEMORY = 2ULL * 1024 * 1024 * 1024; // 2GB
     
     for (int i = 1; i < argc; ++i) {
@@ -155,6 +161,41 @@ bool Config::parseArgs(int argc, char* argv[], Config& config) {
                 return false;
             }
         }
+        // Storage journal
+        else if ((arg == "--journal" || arg == "-j") && i + 1 < argc) {
+            config.journalFile = argv[++i];
+        }
+        else if (arg == "--journal-sync" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            std::transform(policy.begin(), policy.end(), policy.begin(), ::tolower);
+
+            auto it = journalSyncMap.find(policy);
+            if (it != journalSyncMap.end()) {
+                config.journal.sync = it->second;
+            } else {
+                std::cerr << "Unknown journal sync policy: " << policy << std::endl;
+                std::cerr << "Valid options: always, batch, never" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--journal-window" && i + 1 < argc) {
+            try {
+                int windowMs = std::stoi(argv[++i]);
+                if (windowMs < 0) {
+                    throw std::invalid_argument("must not be negative");
+                }
+                config.journal.groupWindow = std::chrono::milliseconds(windowMs);
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid journal window: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--no-dedup") {
+            config.dedup = false;
+        }
+        else if (arg == "--index") {
+            config.index = true;
+        }
         else {
             std::cerr << "Unknown option: " << arg << std::endl;
             showHelp(argv[0]);
@@ -188,6 +229,18 @@ void Config::showHelp(const char* programName) {
     std::cout << "  -t, --tick-ms N        Milliseconds between scheduler ticks\n";
     std::cout << "                         Default: 100 (10 ticks per second)\n";
     std::cout << "\n";
+    std::cout << "Storage Options:\n";
+    std::cout << "  -j, --journal FILE     Journal storage changes to FILE and replay it on boot\n";
+    std::cout << "  --journal-sync POLICY  When journal records reach the disk: always (fsync\n";
+    std::cout << "                         each change), batch (group commit), never (leave it\n";
+    std::cout << "                         to the OS). Default: batch\n";
+    std::cout << "  --journal-window MS    Longest a batched record waits for its group commit\n";
+    std::cout << "                         Default: 20\n";
+    std::cout << "  --no-dedup             Keep a separate copy of every file's content instead\n";
+    std::cout << "                         of sharing identical ones\n";
+    std::cout << "  --index                Keep a full-text index of file contents for\n";
+    std::cout << "                         'index search'\n";
+    std::cout << "\n";
     std::cout << "Examples:\n";
     std::cout << "  " << programName << " --verbose\n";
     std::cout << "  " << programName << " --memory 2M\n";
@@ -195,6 +248,7 @@ void Config::showHelp(const char* programName) {
     std::cout << "  " << programName << " --log-level info\n";
     std::cout << "  " << programName << " --scheduler rr --quantum 3\n";
     std::cout << "  " << programName << " -s priority -c 2 -t 50\n";
+    std::cout << "  " << programName << " --journal data/storage.wal --journal-sync always\n";
 }
 
 } // namespace config
@@ -4,6 +4,7 @@
 #include <cstddef>
 #include "logger/Logger.h"
 #include "scheduler/algorithms/SchedulerAlgorithm.h"
+#include "storage/Journal.h"
 
 namespace config {
 
@@ -17,6 +18,14 @@ struct Config {
     int schedulerQuantum = 5;               // Time quantum for RoundRobin (cycles)
     int cyclesPerTick = 1;                 // CPU cycles per scheduler tick
     int tickIntervalMs = 100;              // Milliseconds between ticks (CPU speed)
+
+    // Storage write-ahead journal, replayed on boot (empty = disabled)
+    std::string journalFile;
+    storage::JournalOptions journal;
+    // Share one copy of identical file contents
+    bool dedup = true;
+    // Keep a full-text index of file contents
+    bool index = false;
     
     // Parse command-line arguments
     // Returns true on success, false if help was shown or error occurred
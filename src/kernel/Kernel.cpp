@@ -18,6 +18,10 @@ namespace kernel {
 Kernel::Kernel(const config::Config& config)
         : cpuScheduler(config),
             memManager(config.memorySize),
+            journalFile(config.journalFile),
+            journalOptions(config.journal),
+            storageDedup(config.dedup),
+            storageIndex(config.index),
             procManager(nullptr) {
     auto loggerCallback = [](const std::string& level, const std::string& module, const std::string& message){
         logging::Logger::getInstance().log(level, module, message);
@@ -33,6 +37,9 @@ sys::SysApi::SysInfo Kernel::getSysInfo() const {
     sys::SysApi::SysInfo info;
     info.totalMemory = memManager.getTotalMemory();
     info.usedMemory = memManager.getUsedMemory();
+    auto dedup = storageManager.dedupStats();
+    info.fileBytes = dedup.logicalBytes;
+    info.uniqueFileBytes = dedup.storedBytes;
     return info;
 }
 
@@ -272,6 +279,15 @@ void Kernel::boot() {
     
     storageManager.setSysApi(&sys);
     procManager.setSysApi(&sys);
+
+    storageManager.setDedup(storageDedup);
+    storageManager.setIndexing(storageIndex);
+
+    // Rebuild the filesystem from the journal before anything can change it
+    if (!journalFile.empty() &&
+        storageManager.openJournal(journalFile, journalOptions) != storage::StorageManager::StorageResponse::OK) {
+        logError("Failed to open storage journal " + journalFile + ", changes will not be journaled");
+    }
     
     // notify ProcessManager so it can handle state transitions
     cpuScheduler.setProcessCompleteCallback([this](int pid) {
@@ -282,6 +298,7 @@ void Kernel::boot() {
     int initPid = procManager.submit("init", 1, 1024, 10, true);
     if (initPid != 1) {
         logError("Failed to create init process");
+        storageManager.setSysApi(nullptr);
         return;
     }
     
@@ -307,12 +324,17 @@ void Kernel::boot() {
     if (!init.start()) {
         logError("Init process failed to start");
         stopKernelThread();
+        storageManager.setSysApi(nullptr);
         return;
     }
     
     
     // After init exits, stop kernel event loop
     stopKernelThread();
+    storageManager.closeJournal();
+
+    // sys goes out of scope here; file contents must not free through it later
+    storageManager.setSysApi(nullptr);
     
     logInfo("Shutdown complete");
 }
@@ -95,6 +95,10 @@ private:
     
     memory::MemoryManager memManager;
     storage::StorageManager storageManager;
+    std::string journalFile;
+    storage::JournalOptions journalOptions;
+    bool storageDedup;
+    bool storageIndex;
     scheduler::CPUScheduler cpuScheduler;
     process::ProcessManager procManager;
 
@@ -48,6 +48,7 @@ struct SysApiKernel : ::sys::SysApi {
             case Resp::NotFound: return ::sys::SysResult::NotFound;
             case Resp::AtRoot: return ::sys::SysResult::AtRoot;
             case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            case Resp::QuotaExceeded: return ::sys::SysResult::QuotaExceeded;
             default: return ::sys::SysResult::Error;
         }
     }
@@ -59,6 +60,7 @@ struct SysApiKernel : ::sys::SysApi {
             case Resp::OK: return ::sys::SysResult::OK;
             case Resp::NotFound: return ::sys::SysResult::NotFound;
             case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            case Resp::QuotaExceeded: return ::sys::SysResult::QuotaExceeded;
             default: return ::sys::SysResult::Error;
         }
     }
@@ -74,14 +76,97 @@ struct SysApiKernel : ::sys::SysApi {
         }
     }
 
-    sys::SysResult appendFile(const std::string& name, const std::string& content) override {
-        std::string existing;
-        auto readRes = readFile(name, existing);
-        if (readRes != sys::SysResult::OK)
-            return readRes;
+    ::sys::SysResult appendFile(const std::string& name, const std::string& content) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        auto res = storageManager.appendFile(name, content);
+        switch(res) {
+            case Resp::OK: return ::sys::SysResult::OK;
+            case Resp::NotFound: return ::sys::SysResult::NotFound;
+            case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            case Resp::QuotaExceeded: return ::sys::SysResult::QuotaExceeded;
+            default: return ::sys::SysResult::Error;
+        }
+    }
+
+    ::sys::SysResult readFileRange(const std::string& name, size_t offset, size_t length, std::string& out) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        auto res = storageManager.readFileRange(name, offset, length, out);
+        switch(res) {
+            case Resp::OK: return ::sys::SysResult::OK;
+            case Resp::NotFound: return ::sys::SysResult::NotFound;
+            case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            default: return ::sys::SysResult::Error;
+        }
+    }
+
+    ::sys::SysResult writeFileAt(const std::string& name, size_t offset, const std::string& data) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        auto res = storageManager.writeFileAt(name, offset, data);
+        switch(res) {
+            case Resp::OK: return ::sys::SysResult::OK;
+            case Resp::NotFound: return ::sys::SysResult::NotFound;
+            case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            case Resp::QuotaExceeded: return ::sys::SysResult::QuotaExceeded;
+            default: return ::sys::SysResult::Error;
+        }
+    }
+
+    ::sys::SysResult statFile(const std::string& name, ::sys::SysApi::FileStat& out) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        storage::StorageManager::FileStat st;
+        auto res = storageManager.statFile(name, st);
+        switch(res) {
+            case Resp::OK:
+                out.size = st.size;
+                out.createdAt = std::chrono::duration_cast<std::chrono::seconds>(
+                    st.createdAt.time_since_epoch()).count();
+                out.modifiedAt = std::chrono::duration_cast<std::chrono::seconds>(
+                    st.modifiedAt.time_since_epoch()).count();
+                out.mode = st.mode;
+                out.links = st.links;
+                out.ownerUid = st.ownerUid;
+                out.ownerPid = st.ownerPid;
+                out.version = st.version;
+                return ::sys::SysResult::OK;
+            case Resp::NotFound: return ::sys::SysResult::NotFound;
+            case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            default: return ::sys::SysResult::Error;
+        }
+    }
+
+    ::sys::SysResult setFileMode(const std::string& name, uint16_t mode) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        auto res = storageManager.setFileMode(name, mode);
+        switch(res) {
+            case Resp::OK: return ::sys::SysResult::OK;
+            case Resp::NotFound: return ::sys::SysResult::NotFound;
+            case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            default: return ::sys::SysResult::Error;
+        }
+    }
+
+    // there are no users yet, so everything runs as uid 0
+    void setCallerPid(int pid) override { storageManager.setCaller(0, pid); }
 
-        existing += content;
-        return writeFile(name, existing);
+    ::sys::SysResult openFileView(const std::string& name, ::sys::FileView& out) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        std::shared_ptr<const storage::FileContent> content;
+        auto res = storageManager.pinFile(name, content);
+        switch(res) {
+            case Resp::OK: {
+                std::vector<std::string_view> segments;
+                segments.reserve(content->getExtents().size() + 1);
+                content->forEachSegment([&segments](const char* bytes, size_t count) {
+                    segments.emplace_back(bytes, count);
+                });
+                size_t size = content->size();
+                out = ::sys::FileView(std::move(content), std::move(segments), size);
+                return ::sys::SysResult::OK;
+            }
+            case Resp::NotFound: return ::sys::SysResult::NotFound;
+            case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            default: return ::sys::SysResult::Error;
+        }
     }
 
     ::sys::SysResult writeFile(const std::string& name, const std::string& content) override {
@@ -91,6 +176,7 @@ struct SysApiKernel : ::sys::SysApi {
             case Resp::OK: return ::sys::SysResult::OK;
             case Resp::NotFound: return ::sys::SysResult::NotFound;
             case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            case Resp::QuotaExceeded: return ::sys::SysResult::QuotaExceeded;
             default: return ::sys::SysResult::Error;
         }
     }
@@ -103,6 +189,7 @@ struct SysApiKernel : ::sys::SysApi {
             case Resp::NotFound: return sys::SysResult::NotFound;
             case Resp::AlreadyExists: return ::sys::SysResult::AlreadyExists;
             case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            case Resp::QuotaExceeded: return ::sys::SysResult::QuotaExceeded;
             default: return ::sys::SysResult::Error;
         }
     }
@@ -130,9 +217,9 @@ struct SysApiKernel : ::sys::SysApi {
         }
     }
 
-    ::sys::SysResult saveToDisk(const std::string& fileName) override {
+    ::sys::SysResult saveToDisk(const std::string& fileName, bool incremental = false, bool compress = false) override {
         using Resp = storage::StorageManager::StorageResponse;
-        auto res = storageManager.saveToDisk(fileName);
+        auto res = storageManager.saveToDisk(fileName, incremental, compress);
         switch (res) {
             case Resp::OK: return ::sys::SysResult::OK;
             case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
@@ -140,9 +227,25 @@ struct SysApiKernel : ::sys::SysApi {
         }
     }
 
-    ::sys::SysResult loadFromDisk(const std::string& fileName) override {
+    ::sys::SysResult saveToDiskAsync(const std::string& fileName, bool compress = false) override {
         using Resp = storage::StorageManager::StorageResponse;
-        auto res = storageManager.loadFromDisk(fileName);
+        auto res = storageManager.saveToDiskAsync(fileName, compress);
+        return res == Resp::OK ? ::sys::SysResult::OK : ::sys::SysResult::Error;
+    }
+
+    ::sys::SysApi::SnapshotStats getSnapshotStats() override {
+        const auto& stats = storageManager.lastSnapshotStats();
+        ::sys::SysApi::SnapshotStats out;
+        out.rawBytes = stats.rawBytes;
+        out.storedBytes = stats.storedBytes;
+        out.seconds = std::chrono::duration<double>(stats.elapsed).count();
+        out.compressed = stats.compressed;
+        return out;
+    }
+
+    ::sys::SysResult loadFromDisk(const std::string& fileName, bool lazy = false) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        auto res = storageManager.loadFromDisk(fileName, lazy);
         switch (res) {
             case Resp::OK: return ::sys::SysResult::OK;
             case Resp::NotFound: return ::sys::SysResult::NotFound;
@@ -151,6 +254,16 @@ struct SysApiKernel : ::sys::SysApi {
         }
     }
 
+    ::sys::SysResult compactSnapshot(const std::string& fileName) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        auto res = storageManager.compactSnapshot(fileName);
+        switch (res) {
+            case Resp::OK: return ::sys::SysResult::OK;
+            case Resp::NotFound: return ::sys::SysResult::NotFound;
+            default: return ::sys::SysResult::Error;
+        }
+    }
+
     ::sys::SysResult readFileFromHost(const std::string& hostFileName, std::string& outContent) override {
         using Resp = storage::StorageManager::StorageResponse;
         auto res = storageManager.readFileFromHost(hostFileName, outContent);
@@ -162,6 +275,35 @@ struct SysApiKernel : ::sys::SysApi {
         }
     }
 
+    ::sys::SysResult importTree(const std::string& hostDir, const std::string& path, ImportStats& out) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        storage::StorageManager::ImportStats stats;
+        auto res = storageManager.importTree(hostDir, path, stats);
+        out = {stats.folders, stats.files, stats.bytes, stats.skipped,
+               std::chrono::duration<double>(stats.elapsed).count()};
+        switch (res) {
+            case Resp::OK: return ::sys::SysResult::OK;
+            case Resp::AlreadyExists: return ::sys::SysResult::AlreadyExists;
+            case Resp::NotFound: return ::sys::SysResult::NotFound;
+            case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            case Resp::QuotaExceeded: return ::sys::SysResult::QuotaExceeded;
+            default: return ::sys::SysResult::Error;
+        }
+    }
+
+    ::sys::SysResult exportTree(const std::string& path, const std::string& hostDir, ExportStats& out) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        storage::StorageManager::ExportStats stats;
+        auto res = storageManager.exportTree(path, hostDir, stats);
+        out = {stats.folders, stats.files, stats.bytes, std::chrono::duration<double>(stats.elapsed).count()};
+        switch (res) {
+            case Resp::OK: return ::sys::SysResult::OK;
+            case Resp::NotFound: return ::sys::SysResult::NotFound;
+            case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            default: return ::sys::SysResult::Error;
+        }
+    }
+
     ::sys::SysResult listDataFiles(std::vector<std::string>& out) override {
         using Resp = storage::StorageManager::StorageResponse;
         auto res = storageManager.listDataFiles(out);
@@ -189,6 +331,7 @@ struct SysApiKernel : ::sys::SysApi {
             case Resp::AlreadyExists: return sys::SysResult::AlreadyExists;
             case Resp::NotFound: return sys::SysResult::NotFound;
             case Resp::InvalidArgument: return sys::SysResult::InvalidArgument;
+            case Resp::QuotaExceeded: return sys::SysResult::QuotaExceeded;
             default: return sys::SysResult::Error;
         }
     }
@@ -201,6 +344,7 @@ struct SysApiKernel : ::sys::SysApi {
             case Resp::AlreadyExists: return sys::SysResult::AlreadyExists;
             case Resp::NotFound: return sys::SysResult::NotFound;
             case Resp::InvalidArgument: return sys::SysResult::InvalidArgument;
+            case Resp::QuotaExceeded: return sys::SysResult::QuotaExceeded;
             default: return sys::SysResult::Error;
         }
     }
@@ -213,6 +357,7 @@ struct SysApiKernel : ::sys::SysApi {
             case Resp::AlreadyExists: return sys::SysResult::AlreadyExists;
             case Resp::NotFound: return sys::SysResult::NotFound;
             case Resp::InvalidArgument: return sys::SysResult::InvalidArgument;
+            case Resp::QuotaExceeded: return sys::SysResult::QuotaExceeded;
             default: return sys::SysResult::Error;
         }
     }
@@ -225,6 +370,7 @@ struct SysApiKernel : ::sys::SysApi {
             case Resp::AlreadyExists: return sys::SysResult::AlreadyExists;
             case Resp::NotFound: return sys::SysResult::NotFound;
             case Resp::InvalidArgument: return sys::SysResult::InvalidArgument;
+            case Resp::QuotaExceeded: return sys::SysResult::QuotaExceeded;
             default: return sys::SysResult::Error;
         }
     }
@@ -239,6 +385,147 @@ struct SysApiKernel : ::sys::SysApi {
         }
     }
 
+    ::sys::SysResult listDirEntries(const std::string& path, std::vector<DirEntry>& out) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        std::vector<storage::StorageManager::DirEntry> entries;
+        auto res = storageManager.listDirEntries(path, entries);
+        out.clear();
+        out.reserve(entries.size());
+        for (const auto& entry : entries) {
+            out.push_back({entry.name, entry.isFolder, entry.size,
+                           std::chrono::duration_cast<std::chrono::seconds>(entry.createdAt.time_since_epoch()).count(),
+                           std::chrono::duration_cast<std::chrono::seconds>(entry.modifiedAt.time_since_epoch()).count(),
+                           entry.files});
+        }
+        switch (res) {
+            case Resp::OK: return sys::SysResult::OK;
+            case Resp::NotFound: return sys::SysResult::NotFound;
+            default: return sys::SysResult::Error;
+        }
+    }
+
+    ::sys::SysResult setDirQuota(const std::string& path, const DirQuota& quota) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        auto res = storageManager.setQuota(path, {quota.bytes, quota.inodes});
+        switch (res) {
+            case Resp::OK: return sys::SysResult::OK;
+            case Resp::NotFound: return sys::SysResult::NotFound;
+            default: return sys::SysResult::Error;
+        }
+    }
+
+    ::sys::SysResult getDirQuota(const std::string& path, DirQuota& out) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        storage::StorageManager::DirQuota quota;
+        auto res = storageManager.getQuota(path, quota);
+        out = {quota.bytes, quota.inodes};
+        switch (res) {
+            case Resp::OK: return sys::SysResult::OK;
+            case Resp::NotFound: return sys::SysResult::NotFound;
+            default: return sys::SysResult::Error;
+        }
+    }
+
+    ::sys::SysResult dirUsage(const std::string& path, DirUsage& out) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        storage::StorageManager::DirUsage usage;
+        auto res = storageManager.dirUsage(path, usage);
+        out = {usage.folders, usage.files, usage.bytes};
+        switch (res) {
+            case Resp::OK: return sys::SysResult::OK;
+            case Resp::NotFound: return sys::SysResult::NotFound;
+            default: return sys::SysResult::Error;
+        }
+    }
+
+    ::sys::SysResult findFiles(const std::string& path, const FindQuery& query,
+                               const std::function<bool(const FindEntry&)>& onEntry) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        using Clock = std::chrono::system_clock;
+        auto toTime = [](long long seconds) {
+            if (seconds == LLONG_MIN) return Clock::time_point::min();
+            if (seconds == LLONG_MAX) return Clock::time_point::max();
+            return Clock::time_point(std::chrono::seconds(seconds));
+        };
+        storage::StorageManager::FindQuery q;
+        q.nameGlob = query.nameGlob;
+        q.type = query.type == 'f'   ? storage::StorageManager::FindQuery::Type::File
+                 : query.type == 'd' ? storage::StorageManager::FindQuery::Type::Folder
+                                     : storage::StorageManager::FindQuery::Type::Any;
+        q.minSize = query.minSize;
+        q.maxSize = query.maxSize == SIZE_MAX ? UINT64_MAX : query.maxSize;
+        q.modifiedAfter = toTime(query.modifiedAfter);
+        // the whole last second counts
+        q.modifiedBefore = query.modifiedBefore == LLONG_MAX ? Clock::time_point::max()
+                                                             : toTime(query.modifiedBefore + 1) - Clock::duration(1);
+        auto res = storageManager.find(path, q, [&onEntry](const storage::StorageManager::FoundEntry& found) {
+            FindEntry entry;
+            entry.path = found.path;
+            entry.isDir = found.isFolder;
+            entry.size = found.size;
+            entry.modifiedAt = std::chrono::duration_cast<std::chrono::seconds>(
+                found.modifiedAt.time_since_epoch()).count();
+            return onEntry(entry);
+        });
+        switch (res) {
+            case Resp::OK: return ::sys::SysResult::OK;
+            case Resp::NotFound: return ::sys::SysResult::NotFound;
+            case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            default: return ::sys::SysResult::Error;
+        }
+    }
+
+    ::sys::SysResult grepFiles(const std::string& path, const GrepQuery& query,
+                               const std::function<bool(const GrepMatch&)>& onMatch) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        storage::StorageManager::GrepQuery q;
+        q.pattern = query.pattern;
+        q.regex = query.regex;
+        q.ignoreCase = query.ignoreCase;
+        q.nameGlob = query.nameGlob;
+        auto res = storageManager.grep(path, q, [&onMatch](const storage::StorageManager::GrepMatch& found) {
+            GrepMatch match;
+            match.path = found.path;
+            match.lineNumber = found.lineNumber;
+            match.line = found.line;
+            return onMatch(match);
+        });
+        switch (res) {
+            case Resp::OK: return ::sys::SysResult::OK;
+            case Resp::NotFound: return ::sys::SysResult::NotFound;
+            case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            default: return ::sys::SysResult::Error;
+        }
+    }
+
+    ::sys::SysResult setFileIndex(bool enabled) override {
+        storageManager.setIndexing(enabled);
+        return ::sys::SysResult::OK;
+    }
+
+    IndexStats getFileIndexStats() override {
+        auto stats = storageManager.indexStats();
+        IndexStats out;
+        out.enabled = stats.enabled;
+        out.files = stats.files;
+        out.terms = stats.terms;
+        out.postings = stats.postings;
+        return out;
+    }
+
+    ::sys::SysResult searchFileIndex(const std::string& query,
+                                     const std::function<bool(const IndexHit&)>& onHit) override {
+        using Resp = storage::StorageManager::StorageResponse;
+        auto res = storageManager.searchIndex(query, [&onHit](const storage::StorageManager::IndexHit& found) {
+            return onHit(IndexHit{found.path, found.offsets});
+        });
+        switch (res) {
+            case Resp::OK: return ::sys::SysResult::OK;
+            case Resp::InvalidArgument: return ::sys::SysResult::InvalidArgument;
+            default: return ::sys::SysResult::Error;
+        }
+    }
+
     std::string getWorkingDir() override {
         return storageManager.getWorkingDir();
     }
@@ -257,6 +544,9 @@ struct SysApiKernel : ::sys::SysApi {
         ::sys::SysApi::SysInfo info;
         info.totalMemory = memoryManager.getTotalMemory();
         info.usedMemory = memoryManager.getUsedMemory();
+        auto dedup = storageManager.dedupStats();
+        info.fileBytes = dedup.logicalBytes;
+        info.uniqueFileBytes = dedup.storedBytes;
         return info;
     }
     
@@ -268,6 +558,10 @@ struct SysApiKernel : ::sys::SysApi {
         return memoryManager.deallocate(ptr) ? ::sys::SysResult::OK : ::sys::SysResult::Error;
     }
     
+    ::sys::SysResult deallocateMemoryBatch(const std::vector<void*>& ptrs) override {
+        return memoryManager.deallocateBatch(ptrs) == ptrs.size() ? ::sys::SysResult::OK : ::sys::SysResult::Error;
+    }
+    
     void freeProcessMemory(int processId) override {
         memoryManager.freeProcessMemory(processId);
     }
@@ -1,7 +1,15 @@
 #pragma once
 
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory>
+#include <ostream>
 #include "scheduler/Scheduler.h"
 #include "scheduler/algorithms/SchedulerAlgorithm.h"
  
@@ -14,7 +22,8 @@ enum class SysResult {
     NotFound,
     AtRoot,
     InvalidArgument,
-    Error
+    Error,
+    QuotaExceeded
 };
 
 inline std::string toString(SysResult r) {
@@ -24,14 +33,150 @@ inline std::string toString(SysResult r) {
         case SysResult::NotFound: return "NotFound";
         case SysResult::AtRoot: return "AtRoot";
         case SysResult::InvalidArgument: return "InvalidArgument";
+        case SysResult::QuotaExceeded: return "QuotaExceeded";
         default: return "Error";
     }
 }
 
+// Read-only, zero-copy view of a file's bytes, split into the segments the
+// storage keeps them in. The view pins what it was opened on: writes made
+// to the file afterwards land in a fresh copy, so the segments stay valid
+// and unchanged until the view is reset or destroyed.
+class FileView {
+public:
+    FileView() = default;
+    FileView(std::shared_ptr<const void> pin, std::vector<std::string_view> segments, size_t size)
+        : pin(std::move(pin)), parts(std::move(segments)), totalSize(size) {}
+
+    size_t size() const { return totalSize; }
+    bool empty() const { return totalSize == 0; }
+    const std::vector<std::string_view>& segments() const { return parts; }
+
+    void writeTo(std::ostream& out) const {
+        for (auto part : parts) out.write(part.data(), static_cast<std::streamsize>(part.size()));
+    }
+
+    // Only for callers that need one contiguous buffer
+    std::string str() const {
+        std::string out;
+        out.reserve(totalSize);
+        for (auto part : parts) out.append(part);
+        return out;
+    }
+
+    void reset() {
+        parts.clear();
+        totalSize = 0;
+        pin.reset();
+    }
+
+private:
+    std::shared_ptr<const void> pin;
+    std::vector<std::string_view> parts;
+    size_t totalSize = 0;
+};
+
 struct SysApi {
     struct SysInfo {
         size_t totalMemory{0};
         size_t usedMemory{0};
+        // file bytes as listed, and as held once identical contents share
+        size_t fileBytes{0};
+        size_t uniqueFileBytes{0};
+    };
+    // name is only valid until the directory changes
+    struct DirEntry {
+        std::string_view name;
+        bool isDir{false};
+        size_t size{0};           // bytes; a directory's is everything below it
+        long long createdAt{0};   // seconds since epoch
+        long long modifiedAt{0};
+        size_t files{0};          // files below a directory
+    };
+    // A directory and everything below it (folders counts the directory)
+    struct DirUsage {
+        size_t folders{0};
+        size_t files{0};
+        size_t bytes{0};
+    };
+    // Limits below a directory, 0 for none; inodes counts files and folders
+    struct DirQuota {
+        size_t bytes{0};
+        size_t inodes{0};
+    };
+    // version changes whenever the file does, never repeating, so an
+    // unchanged version means bytes and metadata are as they were
+    struct FileStat {
+        size_t size{0};
+        long long createdAt{0};   // seconds since epoch
+        long long modifiedAt{0};
+        uint16_t mode{0};         // permission bits, e.g. 0644
+        uint32_t links{0};
+        uint32_t ownerUid{0};
+        int ownerPid{0};          // 0 is the kernel
+        uint64_t version{0};
+    };
+    // What importTree brought in; skipped counts host entries left out
+    struct ImportStats {
+        size_t folders{0};
+        size_t files{0};
+        size_t bytes{0};
+        size_t skipped{0};
+        double seconds{0};
+    };
+    // What exportTree wrote out
+    struct ExportStats {
+        size_t folders{0};
+        size_t files{0};
+        size_t bytes{0};
+        double seconds{0};
+    };
+    // Last full snapshot save or load; storedBytes is the size on disk
+    struct SnapshotStats {
+        size_t rawBytes{0};
+        size_t storedBytes{0};
+        double seconds{0};
+        bool compressed{false};
+    };
+    // findFiles: every test that is set must hold; size bounds only
+    // apply to files, so setting one leaves directories out
+    struct FindQuery {
+        std::string nameGlob;                 // '*' and '?' wildcards, empty = any name
+        char type{0};                         // 'f' files, 'd' directories, 0 both
+        size_t minSize{0};
+        size_t maxSize{SIZE_MAX};
+        long long modifiedAfter{LLONG_MIN};   // seconds since epoch, inclusive
+        long long modifiedBefore{LLONG_MAX};
+    };
+    // path and line are only valid during the callback
+    struct FindEntry {
+        std::string_view path;
+        bool isDir{false};
+        size_t size{0};
+        long long modifiedAt{0};
+    };
+    struct GrepQuery {
+        std::string pattern;
+        bool regex{false};                    // ECMAScript regex instead of a literal
+        bool ignoreCase{false};
+        std::string nameGlob;                 // only files whose name matches
+    };
+    struct GrepMatch {
+        std::string_view path;
+        size_t lineNumber{0};
+        std::string_view line;
+    };
+    // A file holding every searched term; offsets are the byte offsets
+    // where the terms start. Both are only valid during the callback.
+    struct IndexHit {
+        std::string_view path;
+        std::span<const uint64_t> offsets;
+    };
+    struct IndexStats {
+        bool enabled{false};
+        size_t files{0};
+        size_t terms{0};
+        size_t postings{0};
     };
     virtual SysResult fileExists(const std::string& name) = 0;
     virtual SysResult readFile(const std::string& name, std::string& out) = 0;
@@ -43,8 +188,24 @@ struct SysApi {
     virtual SysResult moveFile(const std::string& src, const std::string& dest) = 0;
     virtual SysResult appendFile(const std::string& name, const std::string& content) = 0;
 
+    // Ranged file access (pread/pwrite style) and metadata without reading content
+    virtual SysResult readFileRange(const std::string& name, size_t offset, size_t length, std::string& out) = 0;
+    virtual SysResult writeFileAt(const std::string& name, size_t offset, const std::string& data) = 0;
+    virtual SysResult statFile(const std::string& name, FileStat& out) = 0;
+    // Permission bits are recorded and reported, not enforced
+    virtual SysResult setFileMode(const std::string& name, uint16_t mode) = 0;
+    // Files this thread creates from now on belong to process pid (0 for
+    // the kernel)
+    virtual void setCallerPid(int pid) = 0;
+    virtual SysResult openFileView(const std::string& name, FileView& out) = 0;
+
     virtual std::string getWorkingDir() = 0;
     virtual SysResult listDir(const std::string& path, std::vector<std::string>& out) = 0;
+    // Unformatted entries: directories first, each group in creation order
+    virtual SysResult listDirEntries(const std::string& path, std::vector<DirEntry>& out) = 0;
+    virtual SysResult dirUsage(const std::string& path, DirUsage& out) = 0;
+    virtual SysResult setDirQuota(const std::string& path, const DirQuota& quota) = 0;
+    virtual SysResult getDirQuota(const std::string& path, DirQuota& out) = 0;
 
     virtual SysResult makeDir(const std::string& name) = 0;
     virtual SysResult removeDir(const std::string& name) = 0;
@@ -52,9 +213,39 @@ struct SysApi {
     virtual SysResult copyDir(const std::string& src, const std::string& dest) = 0;
     virtual SysResult moveDir(const std::string& src, const std::string& dest) = 0;
 
-    virtual SysResult saveToDisk(const std::string& fileName) = 0;
-    virtual SysResult loadFromDisk(const std::string& fileName) = 0;
+    // Search below path (or just path, if it is a file); matches stream to
+    // the callback as they are found, and returning false stops the search
+    virtual SysResult findFiles(const std::string& path, const FindQuery& query,
+                                const std::function<bool(const FindEntry&)>& onEntry) = 0;
+    virtual SysResult grepFiles(const std::string& path, const GrepQuery& query,
+                                const std::function<bool(const GrepMatch&)>& onMatch) = 0;
+
+    // Full-text index: kept up to date on every write while enabled.
+    // searchFileIndex returns files holding every term of query, Error
+    // while the index is off
+    virtual SysResult setFileIndex(bool enabled) = 0;
+    virtual IndexStats getFileIndexStats() = 0;
+    virtual SysResult searchFileIndex(const std::string& query,
+                                      const std::function<bool(const IndexHit&)>& onHit) = 0;
+
+    // incremental: append only what changed since the last binary save or
+    // load of this snapshot (a full save when there is nothing to build on)
+    // compress: write full snapshots block-compressed, loads detect it
+    virtual SysResult saveToDisk(const std::string& fileName, bool incremental = false, bool compress = false) = 0;
+    // full save written by a background worker; returns once it has started
+    virtual SysResult saveToDiskAsync(const std::string& fileName, bool compress = false) = 0;
+    virtual SnapshotStats getSnapshotStats() = 0;
+    // lazy: map a binary snapshot and load file contents on first use
+    virtual SysResult loadFromDisk(const std::string& fileName, bool lazy = false) = 0;
+    // fold a binary snapshot's incremental saves back into its base file
+    virtual SysResult compactSnapshot(const std::string& fileName) = 0;
     virtual SysResult readFileFromHost(const std::string& hostFileName, std::string& outContent) = 0;
+    // copy a host directory tree into a new directory at path, bytes as
+    // they are (no newline added); AlreadyExists if path is taken
+    virtual SysResult importTree(const std::string& hostDir, const std::string& path, ImportStats& out) = 0;
+    // write the directory at path and everything below it out to a host
+    // directory, overwriting files of the same name
+    virtual SysResult exportTree(const std::string& path, const std::string& hostDir, ExportStats& out) = 0;
     virtual SysResult resetStorage() = 0;
     virtual SysResult listDataFiles(std::vector<std::string>& out) = 0;
 
@@ -63,6 +254,8 @@ struct SysApi {
     // Memory allocation syscalls for storage and processes
     virtual void* allocateMemory(size_t size, int processId = 0) = 0;
     virtual SysResult deallocateMemory(void* ptr) = 0;
+    // Frees every block in one call; Error if any of them was not allocated
+    virtual SysResult deallocateMemoryBatch(const std::vector<void*>& ptrs) = 0;
     virtual void freeProcessMemory(int processId) = 0;
     
     // Scheduler operations
@@ -136,4 +329,43 @@ struct SysApi {
     virtual ~SysApi() = default;
 };
 
+// "64.00 MB -> 9.81 MB (6.52x) at 410.3 MB/s", without the ratio when uncompressed
+inline std::string toString(const SysApi::SnapshotStats& stats) {
+    double rawMb = static_cast<double>(stats.rawBytes) / (1024.0 * 1024.0);
+    double throughput = stats.seconds > 0 ? rawMb / stats.seconds : 0.0;
+    char text[96];
+    if (stats.compressed && stats.storedBytes > 0) {
+        std::snprintf(text, sizeof(text), "%.2f MB -> %.2f MB (%.2fx) at %.1f MB/s", rawMb,
+                      static_cast<double>(stats.storedBytes) / (1024.0 * 1024.0),
+                      static_cast<double>(stats.rawBytes) / static_cast<double>(stats.storedBytes), throughput);
+    } else {
+        std::snprintf(text, sizeof(text), "%.2f MB at %.1f MB/s", rawMb, throughput);
+    }
+    return text;
+}
+
+namespace detail {
+inline std::string transferSummary(size_t files, size_t folders, size_t bytes, double seconds) {
+    double mb = static_cast<double>(bytes) / (1024.0 * 1024.0);
+    char text[128];
+    int length = std::snprintf(text, sizeof(text), "%zu files in %zu directories, %.2f MB in %.3fs", files, folders,
+                               mb, seconds);
+    if (seconds > 0 && length > 0 && static_cast<size_t>(length) < sizeof(text)) {
+        std::snprintf(text + length, sizeof(text) - length, " (%.0f files/s, %.1f MB/s)",
+                      static_cast<double>(files) / seconds, mb / seconds);
+    }
+    return text;
+}
+} // namespace detail
+
+// "50000 files in 120 directories, 195.31 MB in 1.204s (41528 files/s, 162.2 MB/s)"
+inline std::string toString(const SysApi::ImportStats& stats) {
+    return detail::transferSummary(stats.files, stats.folders, stats.bytes, stats.seconds);
+}
+
+// same shape as an import's
+inline std::string toString(const SysApi::ExportStats& stats) {
+    return detail::transferSummary(stats.files, stats.folders, stats.bytes, stats.seconds);
+}
+
 } // namespace sys
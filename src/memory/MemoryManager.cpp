@@ -46,6 +46,26 @@ bool MemoryManager::deallocate(void *ptr)
     return true;
 }
 
+size_t MemoryManager::deallocateBatch(const std::vector<void*>& ptrs)
+{
+    size_t released = 0;
+    size_t freed = 0;
+    for (void* ptr : ptrs) {
+        auto it = allocations.find(ptr);
+        if (it == allocations.end()) continue;
+        freed += it->second.size;
+        allocations.erase(it);
+        delete[] static_cast<std::byte*>(ptr);
+        ++released;
+    }
+    usedMemory -= freed;
+    if (released < ptrs.size()) {
+        logError("Attempt to deallocate " + std::to_string(ptrs.size() - released) + " untracked blocks");
+    }
+    logDebug("Deallocated " + std::to_string(freed) + " bytes in " + std::to_string(released) + " blocks");
+    return released;
+}
+
 void MemoryManager::freeProcessMemory(int processId)
 {
     size_t freed = 0;
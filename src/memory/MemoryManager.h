@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <functional>
 #include <string>
+#include <vector>
 #include "common/LoggingMixin.h"
 
 namespace memory {
@@ -18,6 +19,10 @@ public:
 
     // Deallocate specific pointer
     virtual bool deallocate(void* ptr);
+
+    // Deallocate many pointers at once, logging a single summary;
+    // returns how many of them were tracked allocations
+    virtual size_t deallocateBatch(const std::vector<void*>& ptrs);
     
     // Deallocate ALL memory owned by a process
     virtual void freeProcessMemory(int processId);
@@ -14,6 +14,7 @@ namespace shell {
 // Import SysApi from sys namespace for shell commands
 using sys::SysApi;
 using sys::SysResult;
+using sys::FileView;
 using sys::toString;
 
 // Global interrupt flag for Ctrl+C handling
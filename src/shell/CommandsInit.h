@@ -9,12 +9,20 @@ namespace shell {
 std::unique_ptr<ICommand> createAddCommand();
 std::unique_ptr<ICommand> createCatCommand();
 std::unique_ptr<ICommand> createCdCommand();
+std::unique_ptr<ICommand> createChmodCommand();
+std::unique_ptr<ICommand> createCompactCommand();
 std::unique_ptr<ICommand> createCpCommand();
 std::unique_ptr<ICommand> createCpdirCommand();
 std::unique_ptr<ICommand> createCurlCommand();
+std::unique_ptr<ICommand> createDuCommand();
 std::unique_ptr<ICommand> createEchoCommand();
 std::unique_ptr<ICommand> createEditCommand();
+std::unique_ptr<ICommand> createFindCommand();
+std::unique_ptr<ICommand> createGrepCommand();
 std::unique_ptr<ICommand> createHelpCommand(CommandRegistry* reg);
+std::unique_ptr<ICommand> createImportCommand();
+std::unique_ptr<ICommand> createExportCommand();
+std::unique_ptr<ICommand> createIndexCommand();
 std::unique_ptr<ICommand> createKillCommand();
 std::unique_ptr<ICommand> createListdataCommand();
 std::unique_ptr<ICommand> createLoadCommand();
@@ -29,12 +37,14 @@ std::unique_ptr<ICommand> createOsLogCommand();
 std::unique_ptr<ICommand> createPsCommand();
 std::unique_ptr<ICommand> createPwdCommand();
 std::unique_ptr<ICommand> createQuitCommand();
+std::unique_ptr<ICommand> createQuotaCommand();
 std::unique_ptr<ICommand> createResetCommand();
 std::unique_ptr<ICommand> createRmCommand();
 std::unique_ptr<ICommand> createRmdirCommand();
 std::unique_ptr<ICommand> createSaveStateCommand();
 std::unique_ptr<ICommand> createSchedulerCommand();
 std::unique_ptr<ICommand> createSleepCommand();
+std::unique_ptr<ICommand> createStatCommand();
 std::unique_ptr<ICommand> createTexedCommand();
 std::unique_ptr<ICommand> createTouchCommand();
 std::unique_ptr<ICommand> createWriteCommand();
@@ -43,11 +53,19 @@ inline void initCommands(CommandRegistry& reg) {
     reg.add(createAddCommand());
     reg.add(createCatCommand());
     reg.add(createCdCommand());
+    reg.add(createChmodCommand());
+    reg.add(createCompactCommand());
     reg.add(createCpCommand());
     reg.add(createCpdirCommand());
     reg.add(createCurlCommand());
+    reg.add(createDuCommand());
     reg.add(createEchoCommand());
     reg.add(createEditCommand());
+    reg.add(createFindCommand());
+    reg.add(createGrepCommand());
+    reg.add(createImportCommand());
+    reg.add(createExportCommand());
+    reg.add(createIndexCommand());
     reg.add(createKillCommand());
     reg.add(createListdataCommand());
     reg.add(createLoadCommand());
@@ -61,12 +79,14 @@ inline void initCommands(CommandRegistry& reg) {
     reg.add(createOsLogCommand());
     reg.add(createPsCommand());
     reg.add(createPwdCommand());
+    reg.add(createQuotaCommand());
     reg.add(createResetCommand());
     reg.add(createRmCommand());
     reg.add(createRmdirCommand());
     reg.add(createSaveStateCommand());
     reg.add(createSchedulerCommand());
     reg.add(createSleepCommand());
+    reg.add(createStatCommand());
     reg.add(createTexedCommand());
     reg.add(createTouchCommand());
     reg.add(createWriteCommand());
@@ -14,6 +14,60 @@ namespace shell {
 // Global interrupt flag for Ctrl+C handling
 std::atomic<bool> interruptRequested{false};
 
+namespace {
+
+Shell* shellFromLua(lua_State* L) {
+    lua_getfield(L, LUA_REGISTRYINDEX, "__shell_ptr");
+    Shell* shell = (Shell*)lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    return shell;
+}
+
+int pushSysError(lua_State* L, SysResult r) {
+    lua_pushnil(L);
+    lua_pushstring(L, toString(r).c_str());
+    return 2;
+}
+
+// Feeds a script to lua_load one stored segment at a time
+struct SegmentReader {
+    const std::vector<std::string_view>& segments;
+    size_t next = 0;
+};
+
+const char* readSegment(lua_State*, void* data, size_t* size) {
+    auto* reader = static_cast<SegmentReader*>(data);
+    if (reader->next >= reader->segments.size()) {
+        *size = 0;
+        return nullptr;
+    }
+    auto segment = reader->segments[reader->next++];
+    *size = segment.size();
+    return segment.data();
+}
+
+size_t checkOffset(lua_State* L, int index) {
+    auto value = luaL_checkinteger(L, index);
+    if (value < 0) {
+        luaL_error(L, "offset and length must not be negative");
+    }
+    return static_cast<size_t>(value);
+}
+
+// Files a command creates while this is alive belong to its process
+class CallerScope {
+public:
+    CallerScope(SysApi& sys, int pid) : sys(sys) { sys.setCallerPid(pid); }
+    ~CallerScope() { sys.setCallerPid(0); }
+    CallerScope(const CallerScope&) = delete;
+    CallerScope& operator=(const CallerScope&) = delete;
+
+private:
+    SysApi& sys;
+};
+
+}  // namespace
+
 Shell::Shell(SysApi& sys, const CommandRegistry& reg)
     : sys(sys), registry(reg), luaState(nullptr) {}
 
@@ -44,9 +98,7 @@ void Shell::initLuaOnce() {
         }
 
         // Get Shell instance from registry
-        lua_getfield(L, LUA_REGISTRYINDEX, "__shell_ptr");
-        Shell* shell = (Shell*)lua_touserdata(L, -1);
-        lua_pop(L, 1);
+        Shell* shell = shellFromLua(L);
 
         if (!shell) {
             lua_pushstring(L, "Error: Shell instance not found");
@@ -79,10 +131,55 @@ void Shell::initLuaOnce() {
 
     lua_setglobal(luaState, "sh");
 
+    // Ranged file access so scripts can page through large files.
+    // Each returns nil plus the error name on failure.
+    lua_pushcfunction(luaState, [](lua_State* L) -> int {
+        const char* path = luaL_checkstring(L, 1);
+        Shell* shell = shellFromLua(L);
+        if (!shell) return luaL_error(L, "Shell instance not found");
+
+        SysApi::FileStat st;
+        auto r = shell->sys.statFile(path, st);
+        if (r != SysResult::OK) return pushSysError(L, r);
+        lua_pushinteger(L, static_cast<lua_Integer>(st.size));
+        return 1;
+    });
+    lua_setglobal(luaState, "fs_size");
+
+    lua_pushcfunction(luaState, [](lua_State* L) -> int {
+        const char* path = luaL_checkstring(L, 1);
+        size_t offset = checkOffset(L, 2);
+        size_t length = checkOffset(L, 3);
+        Shell* shell = shellFromLua(L);
+        if (!shell) return luaL_error(L, "Shell instance not found");
+
+        std::string data;
+        auto r = shell->sys.readFileRange(path, offset, length, data);
+        if (r != SysResult::OK) return pushSysError(L, r);
+        lua_pushlstring(L, data.data(), data.size());
+        return 1;
+    });
+    lua_setglobal(luaState, "fs_read");
+
+    lua_pushcfunction(luaState, [](lua_State* L) -> int {
+        const char* path = luaL_checkstring(L, 1);
+        size_t offset = checkOffset(L, 2);
+        size_t length = 0;
+        const char* bytes = luaL_checklstring(L, 3, &length);
+        Shell* shell = shellFromLua(L);
+        if (!shell) return luaL_error(L, "Shell instance not found");
+
+        auto r = shell->sys.writeFileAt(path, offset, std::string(bytes, length));
+        if (r != SysResult::OK) return pushSysError(L, r);
+        lua_pushboolean(L, 1);
+        return 1;
+    });
+    lua_setglobal(luaState, "fs_write");
+
     logInfo("Lua engine initialized");
 }
 
-std::string Shell::runLuaScript(const std::string &luaCode) {
+std::string Shell::runLuaScript(const FileView& script, const std::string& chunkName) {
 
     initLuaOnce();
 
@@ -92,8 +189,13 @@ std::string Shell::runLuaScript(const std::string &luaCode) {
 
     interruptRequested.store(false);
 
-    // Execute Lua code
-    int result = luaL_dostring(luaState, luaCode.c_str());
+    // Compile straight from the file's segments, then run
+    SegmentReader reader{script.segments()};
+    std::string name = "=" + chunkName;
+    int result = lua_load(luaState, readSegment, &reader, name.c_str(), nullptr);
+    if (result == LUA_OK) {
+        result = lua_pcall(luaState, 0, LUA_MULTRET, 0);
+    }
 
     if (result != LUA_OK) {
         const char *error = lua_tostring(luaState, -1);
@@ -122,21 +224,15 @@ std::string Shell::handleInputRedirection(const std::string &segment) {
         return "";
     }
 
-    ICommand* catCmd = registry.find("cat");
-    if (!catCmd) {
-        logError("No 'cat' command found for input redirection");
-        return "";
-    }
-
-    std::ostringstream out, err;
-    std::vector<std::string> readArgs = { fileName };
-    int rc = catCmd->execute(readArgs, "", out, err, sys);
-    if (!err.str().empty()) {
-        logError(err.str());
+    FileView view;
+    auto r = sys.openFileView(fileName, view);
+    if (r != SysResult::OK) {
+        logError("Input redirection failed for '" + fileName + "': " + toString(r));
         return "";
     }
 
-    return out.str();
+    // commands take their input as one string, this is the only copy made
+    return view.str();
 }
 
 std::string Shell::handleOutputRedirection(std::string segment, const std::string &output) {
@@ -221,6 +317,7 @@ void Shell::processCommandLine(const std::string& commandLine) {
         ICommand* cmd = registry.find(command);
         if (cmd) {
             // write/edit commands should go directly to std::cout / std::cerr
+            CallerScope caller(sys, std::max(shellPid, 0));
             int rc = cmd->execute(args, "", std::cout, std::cerr, sys);
 
             std::cout.flush();
@@ -327,6 +424,7 @@ std::string Shell::executeCommand(const std::string& command,
         }
 
         std::ostringstream out, err;
+        CallerScope caller(sys, std::max(shellPid, 0));
         
         if (inPipeChain) {
             std::cerr.flush();
@@ -367,6 +465,7 @@ std::string Shell::executeCommand(const std::string& command,
     }
 
     // Now execute the actual command after scheduler completes
+    CallerScope caller(sys, pid);
     if (inPipeChain) {
         // Pipe output mode
         std::ostringstream out, err;
@@ -398,9 +497,9 @@ std::string Shell::executeScriptFile(const std::string &fileName) {
     logInfo("Executing script file: " + fileName);
 
 
-    // Read file directly from memory filesystem
-    std::string fileContent;
-    auto readResult = sys.readFile(fileName, fileContent);
+    // Run the script from a view of the file, without copying it out
+    FileView script;
+    auto readResult = sys.openFileView(fileName, script);
 
     if (readResult != SysResult::OK) {
         std::string error = "Error: Cannot read Lua file '" + fileName + "': " + shell::toString(readResult);
@@ -408,12 +507,12 @@ std::string Shell::executeScriptFile(const std::string &fileName) {
         return error;
     }
 
-    if (fileContent.empty()) {
+    if (script.empty()) {
         return "Error: Lua file is empty";
     }
 
-    logDebug("Executing Lua content: " + fileContent.substr(0, 50) + "...");
-    return runLuaScript(fileContent);
+    logDebug("Executing Lua content: " + std::string(script.segments().front().substr(0, 50)) + "...");
+    return runLuaScript(script, fileName);
 }
 
 void Shell::parseCommand(const std::string& commandLine, std::string& command, std::vector<std::string>& args) {
@@ -65,7 +65,7 @@ namespace shell {
         int shellPid = -1;
         
         void initLuaOnce();
-        std::string runLuaScript(const std::string& luaCode);
+        std::string runLuaScript(const FileView& script, const std::string& chunkName);
         std::string executeScriptFile(const std::string& fileName);
 
         std::string handleInputRedirection(const std::string &segment);
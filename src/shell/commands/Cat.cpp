@@ -21,8 +21,9 @@ public:
 
         int rc = 0;
         for (const auto& name : args) {
-            std::string content;
-            auto r = sys.readFile(name, content);
+            // written straight from the stored segments, no copy of the file
+            FileView view;
+            auto r = sys.openFileView(name, view);
             if (r != shell::SysResult::OK) {
                 err << "cat: " << name << ": " << shell::toString(r) << "\n";
                 rc = 1;
@@ -30,10 +31,16 @@ public:
             }
 
             out << "=== contents of " << name << " ===\n";
-            if (content.empty())
+            if (view.empty())
                 out << "(empty)\n";
-            else
-                out << content;
+
+            for (auto segment : view.segments()) {
+                if (interruptRequested.load()) {
+                    err << "cat: interrupted\n";
+                    return 1;
+                }
+                out.write(segment.data(), static_cast<std::streamsize>(segment.size()));
+            }
             out << "=============================\n";
         }
         return rc;
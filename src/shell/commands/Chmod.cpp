@@ -0,0 +1,48 @@
+#include "shell/CommandAPI.h"
+#include <charconv>
+#include <cstdint>
+#include <memory>
+
+namespace shell {
+
+class ChmodCommand : public ICommand {
+public:
+    int execute(const std::vector<std::string>& args,
+                const std::string& /*input*/,
+                std::ostream& /*out*/,
+                std::ostream& err,
+                SysApi& sys) override
+    {
+        if (!requireArgs(args, 2, err)) return 1;
+
+        // octal, as chmod takes it: 644, 0755
+        const std::string& text = args[0];
+        uint16_t mode = 0;
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), mode, 8);
+        if (ec != std::errc() || end != text.data() + text.size() || mode > 07777) {
+            err << "chmod: invalid mode: " << text << "\n";
+            return 1;
+        }
+
+        int rc = 0;
+        for (size_t i = 1; i < args.size(); ++i) {
+            auto res = sys.setFileMode(args[i], mode);
+            if (res != SysResult::OK) {
+                err << "chmod: " << args[i] << ": " << toString(res) << "\n";
+                rc = 1;
+            }
+        }
+        return rc;
+    }
+
+    const char* getName() const override { return "chmod"; }
+    const char* getDescription() const override { return "Set the permission bits of files (recorded, not enforced)"; }
+    const char* getUsage() const override { return "chmod <octalMode> <fileName> [fileName...]"; }
+    int getCpuCost() const override { return 1; }
+};
+
+std::unique_ptr<ICommand> createChmodCommand() {
+    return std::make_unique<ChmodCommand>();
+}
+
+} // namespace shell
@@ -0,0 +1,34 @@
+#include "shell/CommandAPI.h"
+#include <memory>
+
+namespace shell {
+
+class CompactCommand : public ICommand {
+public:
+    int execute(const std::vector<std::string>& args,
+                const std::string&,
+                std::ostream& out,
+                std::ostream& err,
+                SysApi& sys) override
+    {
+        if (!requireArgs(args, 1, err, 1)) return 1;
+
+        auto res = sys.compactSnapshot(args[0]);
+        if (res == SysResult::NotFound) {
+            err << "compact: no binary snapshot named " << args[0] << "\n";
+            return 1;
+        }
+        out << "Compact result: " << toString(res) << "\n";
+        return res == SysResult::OK ? 0 : 1;
+    }
+
+    const char* getName() const override { return "compact"; }
+    const char* getDescription() const override { return "Merge incremental saves into their base snapshot"; }
+    const char* getUsage() const override { return "compact <name>"; }
+};
+
+std::unique_ptr<ICommand> createCompactCommand() {
+    return std::make_unique<CompactCommand>();
+}
+
+} // namespace shell
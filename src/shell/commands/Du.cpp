@@ -0,0 +1,98 @@
+#include "shell/CommandAPI.h"
+#include <cstdio>
+#include <iterator>
+#include <memory>
+
+namespace shell {
+
+class DuCommand : public ICommand {
+public:
+    int execute(const std::vector<std::string>& args,
+                const std::string& /*input*/,
+                std::ostream& out,
+                std::ostream& err,
+                SysApi& sys) override
+    {
+        std::string path = ".";
+        bool summaryOnly = false;
+        bool human = false;
+        bool havePath = false;
+        for (const auto& arg : args) {
+            if (arg == "-s") {
+                summaryOnly = true;
+            } else if (arg == "-h") {
+                human = true;
+            } else if (arg.starts_with("-") || havePath) {
+                err << "Usage: " << getUsage() << "\n";
+                return 1;
+            } else {
+                path = arg;
+                havePath = true;
+            }
+        }
+
+        // totals are kept up to date by storage, so nothing is walked here
+        SysApi::DirUsage usage;
+        auto res = sys.dirUsage(path, usage);
+        if (res != SysResult::OK) {
+            err << "du: " << path << ": " << toString(res) << "\n";
+            return 1;
+        }
+
+        if (!summaryOnly) {
+            std::vector<SysApi::DirEntry> entries;
+            res = sys.listDirEntries(path, entries);
+            if (res != SysResult::OK) {
+                err << "du: " << path << ": " << toString(res) << "\n";
+                return 1;
+            }
+            std::string prefix = path.ends_with("/") ? path : path + "/";
+            for (const auto& entry : entries) {
+                if (!entry.isDir) continue;
+                printLine(out, entry.size, entry.files, human);
+                out << prefix << entry.name << "\n";
+            }
+        }
+        printLine(out, usage.bytes, usage.files, human);
+        out << path << "\n";
+        return 0;
+    }
+    
+    const char* getName() const override { return "du"; }
+    const char* getDescription() const override { return "Show bytes and files used below directories"; }
+    const char* getUsage() const override { return "du [-s] [-h] [dirName]"; }
+    int getCpuCost() const override { return 1; }
+
+private:
+    static void printLine(std::ostream& out, size_t bytes, size_t files, bool human) {
+        if (human) {
+            out << humanSize(bytes);
+        } else {
+            out << bytes;
+        }
+        out << "\t" << files << (files == 1 ? " file\t" : " files\t");
+    }
+
+    static std::string humanSize(size_t bytes) {
+        static const char* units[] = {"B", "K", "M", "G", "T"};
+        double value = static_cast<double>(bytes);
+        size_t unit = 0;
+        while (value >= 1024.0 && unit + 1 < std::size(units)) {
+            value /= 1024.0;
+            ++unit;
+        }
+        char text[32];
+        if (unit == 0) {
+            std::snprintf(text, sizeof(text), "%zu%s", bytes, units[0]);
+        } else {
+            std::snprintf(text, sizeof(text), "%.1f%s", value, units[unit]);
+        }
+        return text;
+    }
+};
+
+std::unique_ptr<ICommand> createDuCommand() {
+    return std::make_unique<DuCommand>();
+}
+
+} // namespace shell
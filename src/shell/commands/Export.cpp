@@ -0,0 +1,36 @@
+#include "shell/CommandAPI.h"
+#include <memory>
+
+namespace shell {
+
+class ExportCommand : public ICommand {
+public:
+    int execute(const std::vector<std::string>& args,
+                const std::string& /*input*/,
+                std::ostream& out,
+                std::ostream& err,
+                SysApi& sys) override
+    {
+        if (!requireArgs(args, 2, err, 2)) return 1;
+
+        SysApi::ExportStats stats;
+        auto res = sys.exportTree(args[0], args[1], stats);
+        if (res != SysResult::OK) {
+            err << "export: " << args[0] << " -> " << args[1] << ": " << shell::toString(res) << "\n";
+            return 1;
+        }
+
+        out << "Exported " << args[0] << " -> " << args[1] << ": " << toString(stats) << "\n";
+        return 0;
+    }
+
+    const char* getName() const override { return "export"; }
+    const char* getDescription() const override { return "Copy a directory tree out to the host filesystem"; }
+    const char* getUsage() const override { return "export <dir> <hostDir>"; }
+};
+
+std::unique_ptr<ICommand> createExportCommand() {
+    return std::make_unique<ExportCommand>();
+}
+
+} // namespace shell
@@ -0,0 +1,133 @@
+#include "shell/CommandAPI.h"
+#include <chrono>
+#include <memory>
+
+namespace shell {
+
+class FindCommand : public ICommand {
+public:
+    int execute(const std::vector<std::string>& args,
+                const std::string& /*input*/,
+                std::ostream& out,
+                std::ostream& err,
+                SysApi& sys) override
+    {
+        std::string path = ".";
+        SysApi::FindQuery query;
+        size_t i = 0;
+        if (i < args.size() && !args[i].starts_with("-")) path = args[i++];
+
+        for (; i < args.size(); ++i) {
+            const std::string& flag = args[i];
+            if (i + 1 >= args.size()) {
+                err << "Usage: " << getUsage() << "\n";
+                return 1;
+            }
+            const std::string& value = args[++i];
+            if (flag == "-name") {
+                query.nameGlob = value;
+            } else if (flag == "-type" && (value == "f" || value == "d")) {
+                query.type = value[0];
+            } else if (flag == "-size") {
+                if (!parseSize(value, query)) {
+                    err << "find: invalid size: " << value << "\n";
+                    return 1;
+                }
+            } else if (flag == "-mmin") {
+                if (!parseMinutes(value, query)) {
+                    err << "find: invalid minutes: " << value << "\n";
+                    return 1;
+                }
+            } else {
+                err << "Usage: " << getUsage() << "\n";
+                return 1;
+            }
+        }
+
+        bool interrupted = false;
+        auto res = sys.findFiles(path, query, [&](const SysApi::FindEntry& entry) {
+            if (interruptRequested.load()) {
+                interrupted = true;
+                return false;
+            }
+            out << entry.path;
+            if (entry.isDir && entry.path != "/") out << "/";
+            out << "\n";
+            return true;
+        });
+        if (interrupted) {
+            err << "find: interrupted\n";
+            return 1;
+        }
+        if (res != SysResult::OK) {
+            err << "find: " << path << ": " << shell::toString(res) << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    const char* getName() const override { return "find"; }
+    const char* getDescription() const override { return "Search for files and directories by name, size or age"; }
+    int getCpuCost() const override { return 3; }
+    const char* getUsage() const override {
+        return "find [path] [-name GLOB] [-type f|d] [-size [+|-]N[k|M]] [-mmin [+|-]N]";
+    }
+
+private:
+    // "+N" more than, "-N" less than, "N" exactly
+    static bool parseBound(const std::string& value, char& sign, long long& number, std::string& suffix) {
+        size_t pos = 0;
+        sign = 0;
+        if (!value.empty() && (value[0] == '+' || value[0] == '-')) sign = value[pos++];
+        if (pos >= value.size() || !isdigit(static_cast<unsigned char>(value[pos]))) return false;
+        try {
+            size_t used = 0;
+            number = std::stoll(value.substr(pos), &used);
+            suffix = value.substr(pos + used);
+        } catch (...) {
+            return false;
+        }
+        return true;
+    }
+
+    static bool parseSize(const std::string& value, SysApi::FindQuery& query) {
+        char sign;
+        long long number;
+        std::string suffix;
+        if (!parseBound(value, sign, number, suffix)) return false;
+        size_t unit = 1;
+        if (suffix == "k") unit = 1024;
+        else if (suffix == "M") unit = 1024 * 1024;
+        else if (!suffix.empty()) return false;
+        size_t bytes = static_cast<size_t>(number) * unit;
+        if (sign == '+') query.minSize = bytes + 1;
+        else if (sign == '-') query.maxSize = bytes > 0 ? bytes - 1 : 0;
+        else query.minSize = query.maxSize = bytes;
+        return true;
+    }
+
+    static bool parseMinutes(const std::string& value, SysApi::FindQuery& query) {
+        char sign;
+        long long minutes;
+        std::string suffix;
+        if (!parseBound(value, sign, minutes, suffix) || !suffix.empty()) return false;
+        long long now = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        long long mark = now - minutes * 60;
+        if (sign == '+') {
+            query.modifiedBefore = mark - 1;
+        } else if (sign == '-') {
+            query.modifiedAfter = mark + 1;
+        } else {
+            query.modifiedAfter = mark - 59;
+            query.modifiedBefore = mark;
+        }
+        return true;
+    }
+};
+
+std::unique_ptr<ICommand> createFindCommand() {
+    return std::make_unique<FindCommand>();
+}
+
+} // namespace shell
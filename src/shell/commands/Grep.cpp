@@ -0,0 +1,103 @@
+#include "shell/CommandAPI.h"
+#include <memory>
+#include <regex>
+#include <sstream>
+
+namespace shell {
+
+class GrepCommand : public ICommand {
+public:
+    int execute(const std::vector<std::string>& args,
+                const std::string& input,
+                std::ostream& out,
+                std::ostream& err,
+                SysApi& sys) override
+    {
+        SysApi::GrepQuery query;
+        std::vector<std::string> operands;
+        for (const auto& arg : args) {
+            if (operands.empty() && arg == "-E") query.regex = true;
+            else if (operands.empty() && arg == "-i") query.ignoreCase = true;
+            else operands.push_back(arg);
+        }
+        if (!requireArgs(operands, 1, err, 2)) return 1;
+        query.pattern = operands[0];
+
+        // with nothing to search but piped input, search that
+        if (operands.size() == 1 && !input.empty()) {
+            return grepInput(query, input, out, err);
+        }
+
+        std::string path = operands.size() > 1 ? operands[1] : ".";
+        bool interrupted = false;
+        size_t matches = 0;
+        auto res = sys.grepFiles(path, query, [&](const SysApi::GrepMatch& match) {
+            if (interruptRequested.load()) {
+                interrupted = true;
+                return false;
+            }
+            out << match.path << ":" << match.lineNumber << ":" << match.line << "\n";
+            ++matches;
+            return true;
+        });
+        if (interrupted) {
+            err << "grep: interrupted\n";
+            return 1;
+        }
+        if (res != SysResult::OK) {
+            err << "grep: " << (res == SysResult::InvalidArgument ? query.pattern : path) << ": "
+                << shell::toString(res) << "\n";
+            return 1;
+        }
+        return matches > 0 ? 0 : 1;
+    }
+
+    const char* getName() const override { return "grep"; }
+    const char* getDescription() const override { return "Search file contents for a pattern"; }
+    int getCpuCost() const override { return 3; }
+    const char* getUsage() const override { return "grep [-E] [-i] <pattern> [path]"; }
+
+private:
+    static int grepInput(const SysApi::GrepQuery& query, const std::string& input, std::ostream& out,
+                         std::ostream& err) {
+        std::regex re;
+        bool useRegex = query.regex || query.ignoreCase;
+        if (useRegex) {
+            auto flags = std::regex::ECMAScript;
+            if (query.ignoreCase) flags |= std::regex::icase;
+            try {
+                re = std::regex(query.regex ? query.pattern : escape(query.pattern), flags);
+            } catch (const std::regex_error&) {
+                err << "grep: " << query.pattern << ": " << shell::toString(SysResult::InvalidArgument) << "\n";
+                return 1;
+            }
+        }
+
+        std::istringstream lines(input);
+        std::string line;
+        size_t matches = 0;
+        while (std::getline(lines, line)) {
+            bool hit = useRegex ? std::regex_search(line, re) : line.find(query.pattern) != std::string::npos;
+            if (hit) {
+                out << line << "\n";
+                ++matches;
+            }
+        }
+        return matches > 0 ? 0 : 1;
+    }
+
+    static std::string escape(const std::string& literal) {
+        std::string escaped;
+        for (char c : literal) {
+            if (std::string_view("\\^$.|?*+()[]{}").find(c) != std::string_view::npos) escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+};
+
+std::unique_ptr<ICommand> createGrepCommand() {
+    return std::make_unique<GrepCommand>();
+}
+
+} // namespace shell
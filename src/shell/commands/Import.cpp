@@ -0,0 +1,43 @@
+#include "shell/CommandAPI.h"
+#include <filesystem>
+#include <memory>
+
+namespace shell {
+
+class ImportCommand : public ICommand {
+public:
+    int execute(const std::vector<std::string>& args,
+                const std::string& /*input*/,
+                std::ostream& out,
+                std::ostream& err,
+                SysApi& sys) override
+    {
+        if (!requireArgs(args, 1, err, 2)) return 1;
+
+        // defaults to the host directory's own name, in the current directory
+        std::string target = args.size() > 1 ? args[1]
+                                             : std::filesystem::path(args[0]).lexically_normal().filename().string();
+        if (target.empty()) target = std::filesystem::path(args[0]).lexically_normal().parent_path().filename().string();
+
+        SysApi::ImportStats stats;
+        auto res = sys.importTree(args[0], target, stats);
+        if (res != SysResult::OK) {
+            err << "import: " << args[0] << " -> " << target << ": " << shell::toString(res) << "\n";
+            return 1;
+        }
+
+        out << "Imported " << args[0] << " -> " << target << ": " << toString(stats) << "\n";
+        if (stats.skipped > 0) out << "Skipped " << stats.skipped << " links, special files or unreadable entries\n";
+        return 0;
+    }
+
+    const char* getName() const override { return "import"; }
+    const char* getDescription() const override { return "Copy a host directory tree into the virtual filesystem"; }
+    const char* getUsage() const override { return "import <hostDir> [dir]"; }
+};
+
+std::unique_ptr<ICommand> createImportCommand() {
+    return std::make_unique<ImportCommand>();
+}
+
+} // namespace shell
@@ -0,0 +1,79 @@
+#include "shell/CommandAPI.h"
+#include <chrono>
+#include <memory>
+
+namespace shell {
+
+class IndexCommand : public ICommand {
+public:
+    int execute(const std::vector<std::string>& args,
+                const std::string& /*input*/,
+                std::ostream& out,
+                std::ostream& err,
+                SysApi& sys) override
+    {
+        std::string action = args.empty() ? "status" : args[0];
+
+        if (action == "on" || action == "off") {
+            if (!requireArgs(args, 1, err, 1)) return 1;
+            sys.setFileIndex(action == "on");
+            printStatus(sys, out);
+            return 0;
+        }
+        if (action == "status") {
+            if (!requireArgs(args, 0, err, 1)) return 1;
+            printStatus(sys, out);
+            return 0;
+        }
+        if (action != "search" || args.size() < 2) {
+            err << "Usage: " << getUsage() << "\n";
+            return 1;
+        }
+
+        std::string query;
+        for (size_t i = 1; i < args.size(); ++i) {
+            if (i > 1) query += ' ';
+            query += args[i];
+        }
+        size_t files = 0;
+        auto started = std::chrono::steady_clock::now();
+        auto res = sys.searchFileIndex(query, [&](const SysApi::IndexHit& hit) {
+            out << hit.path << ": " << hit.offsets.size() << (hit.offsets.size() == 1 ? " match" : " matches")
+                << ", first at byte " << hit.offsets.front() << "\n";
+            ++files;
+            return !interruptRequested.load();
+        });
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+        if (res == SysResult::Error) {
+            err << "index: the index is off, turn it on with 'index on'\n";
+            return 1;
+        }
+        if (res != SysResult::OK) {
+            err << "index: nothing to search for in: " << query << "\n";
+            return 1;
+        }
+        out << files << (files == 1 ? " file" : " files") << " in " << elapsed.count() << " us\n";
+        return files > 0 ? 0 : 1;
+    }
+
+    const char* getName() const override { return "index"; }
+    const char* getDescription() const override { return "Search file contents through the full-text index"; }
+    const char* getUsage() const override { return "index [on|off|status] | index search <term> [term...]"; }
+
+private:
+    static void printStatus(SysApi& sys, std::ostream& out) {
+        auto stats = sys.getFileIndexStats();
+        if (!stats.enabled) {
+            out << "Index: off\n";
+            return;
+        }
+        out << "Index: on, " << stats.files << " files, " << stats.terms << " terms, " << stats.postings
+            << " occurrences\n";
+    }
+};
+
+std::unique_ptr<ICommand> createIndexCommand() {
+    return std::make_unique<IndexCommand>();
+}
+
+} // namespace shell
@@ -11,17 +11,28 @@ public:
                 std::ostream& err,
                 SysApi& sys) override
     {
-        if (!requireArgs(args, 1, err)) return 1;
+        if (!requireArgs(args, 1, err, 2)) return 1;
         
         auto fileName = args[0];
-        auto res = sys.loadFromDisk(fileName);
+        bool lazy = false;
+        if (args.size() == 2) {
+            if (args[1] != "--lazy") {
+                err << "Usage: " << getUsage() << "\n";
+                return 1;
+            }
+            lazy = true;
+        }
+        auto res = sys.loadFromDisk(fileName, lazy);
         out << "Load result: " << toString(res) << "\n";
+        if (res == SysResult::OK) {
+            out << "Snapshot: " << toString(sys.getSnapshotStats()) << "\n";
+        }
         return res == SysResult::OK ? 0 : 1;
     }
     
     const char* getName() const override { return "loadstate"; }
     const char* getDescription() const override { return "Load entire filesystem state from disk"; }
-    const char* getUsage() const override { return "loadstate <name>"; }
+    const char* getUsage() const override { return "loadstate <name> [--lazy]"; }
 };
 
 std::unique_ptr<ICommand> createLoadStateCommand() {
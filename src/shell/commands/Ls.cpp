@@ -1,4 +1,6 @@
 #include "shell/CommandAPI.h"
+#include "common/TimeUtils.h"
+#include <algorithm>
 #include <memory>
 
 namespace shell {
@@ -11,9 +13,33 @@ public:
                 std::ostream& err,
                 SysApi& sys) override
     {
-        std::string path = args.empty() ? "." : args[0];
-        std::vector<std::string> entries;
-        auto res = sys.listDir(path, entries);
+        std::string path = ".";
+        bool longFormat = false;
+        bool reverse = false;
+        char sortBy = 'n';  // n name, t modified, S size, U as stored
+        bool havePath = false;
+        for (const auto& arg : args) {
+            if (arg.size() > 1 && arg[0] == '-') {
+                for (char flag : arg.substr(1)) {
+                    if (flag == 'l') longFormat = true;
+                    else if (flag == 'r') reverse = true;
+                    else if (flag == 't' || flag == 'S' || flag == 'U') sortBy = flag;
+                    else {
+                        err << "Usage: " << getUsage() << "\n";
+                        return 1;
+                    }
+                }
+            } else if (!havePath) {
+                path = arg;
+                havePath = true;
+            } else {
+                err << "Usage: " << getUsage() << "\n";
+                return 1;
+            }
+        }
+
+        std::vector<SysApi::DirEntry> entries;
+        auto res = sys.listDirEntries(path, entries);
         
         if (res != SysResult::OK) {
             err << "ls: " << path << ": " << toString(res) << "\n";
@@ -22,10 +48,46 @@ public:
 
         if (entries.empty()) {
             out << "(empty)\n";
-        } else {
-            for (const auto& e : entries) {
-                out << e << "\n";
+            return 0;
+        }
+
+        // directories stay ahead of files; ties fall back to the name
+        auto byName = [](const SysApi::DirEntry& a, const SysApi::DirEntry& b) {
+            if (a.isDir != b.isDir) return a.isDir;
+            return a.name < b.name;
+        };
+        if (sortBy == 'n') {
+            std::sort(entries.begin(), entries.end(), byName);
+        } else if (sortBy == 't') {
+            std::sort(entries.begin(), entries.end(), [&](const SysApi::DirEntry& a, const SysApi::DirEntry& b) {
+                if (a.isDir != b.isDir) return a.isDir;
+                if (a.modifiedAt != b.modifiedAt) return a.modifiedAt > b.modifiedAt;
+                return byName(a, b);
+            });
+        } else if (sortBy == 'S') {
+            std::sort(entries.begin(), entries.end(), [&](const SysApi::DirEntry& a, const SysApi::DirEntry& b) {
+                if (a.isDir != b.isDir) return a.isDir;
+                if (a.size != b.size) return a.size > b.size;
+                return byName(a, b);
+            });
+        }
+        if (reverse) std::reverse(entries.begin(), entries.end());
+
+        // times are formatted only for long listings, each second once
+        common::TimeFormatCache times;
+        for (const auto& e : entries) {
+            if (interruptRequested.load()) {
+                err << "ls: interrupted\n";
+                return 1;
+            }
+            out << (e.isDir ? "[D] " : "[F] ") << e.name;
+            if (longFormat) {
+                out << " | created: " << times.format(static_cast<std::time_t>(e.createdAt))
+                    << " | modified: " << times.format(static_cast<std::time_t>(e.modifiedAt));
+                out << " | size: " << e.size << " bytes";
+                if (e.isDir) out << " | files: " << e.files;
             }
+            out << "\n";
         }
 
         return 0;
@@ -33,7 +95,7 @@ public:
     
     const char* getName() const override { return "ls"; }
     const char* getDescription() const override { return "List contents of directory"; }
-    const char* getUsage() const override { return "ls [dirName|..]"; }
+    const char* getUsage() const override { return "ls [-l] [-t|-S|-U] [-r] [dirName|..]"; }
     int getCpuCost() const override { return 2; }
 };
 
@@ -24,6 +24,12 @@ public:
             << "Total: " << totalKb << " KB\n"
             << "Used : " << usedKb  << " KB\n"
             << "Free : " << freeKb  << " KB\n";
+        if (info.fileBytes > 0) {
+            double filesKb = static_cast<double>(info.fileBytes) / 1024.0;
+            double savedKb = static_cast<double>(info.fileBytes - info.uniqueFileBytes) / 1024.0;
+            oss << "Files: " << filesKb << " KB, " << savedKb << " KB saved by dedup ("
+                << (100.0 * savedKb / filesKb) << "%)\n";
+        }
 
         out << oss.str();
         return 0;
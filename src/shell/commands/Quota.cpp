@@ -0,0 +1,93 @@
+#include "shell/CommandAPI.h"
+#include <charconv>
+#include <cstdint>
+#include <memory>
+
+namespace shell {
+
+class QuotaCommand : public ICommand {
+public:
+    int execute(const std::vector<std::string>& args,
+                const std::string& /*input*/,
+                std::ostream& out,
+                std::ostream& err,
+                SysApi& sys) override
+    {
+        if (args.empty() || (args[0] != "set" && args[0] != "clear")) {
+            if (!requireArgs(args, 0, err, 1)) return 1;
+            return printQuota(args.empty() ? "." : args[0], sys, out, err);
+        }
+
+        SysApi::DirQuota quota;
+        if (args[0] == "set") {
+            if (!requireArgs(args, 3, err, 4)) return 1;
+            if (!parseBytes(args[2], quota.bytes) || (args.size() == 4 && !parseCount(args[3], quota.inodes))) {
+                err << "Usage: " << getUsage() << "\n";
+                return 1;
+            }
+        } else if (!requireArgs(args, 2, err, 2)) {
+            return 1;
+        }
+
+        const std::string& path = args[1];
+        auto res = sys.setDirQuota(path, quota);
+        if (res != SysResult::OK) {
+            err << "quota: " << path << ": " << toString(res) << "\n";
+            return 1;
+        }
+        return printQuota(path, sys, out, err);
+    }
+    
+    const char* getName() const override { return "quota"; }
+    const char* getDescription() const override { return "Show or limit the bytes and entries below a directory"; }
+    const char* getUsage() const override {
+        return "quota [dirName] | quota set <dirName> <bytes[k|M|G]|0> [inodes] | quota clear <dirName>";
+    }
+    int getCpuCost() const override { return 1; }
+
+private:
+    static int printQuota(const std::string& path, SysApi& sys, std::ostream& out, std::ostream& err) {
+        SysApi::DirQuota quota;
+        SysApi::DirUsage usage;
+        auto res = sys.getDirQuota(path, quota);
+        if (res == SysResult::OK) res = sys.dirUsage(path, usage);
+        if (res != SysResult::OK) {
+            err << "quota: " << path << ": " << toString(res) << "\n";
+            return 1;
+        }
+        out << path << ": bytes " << usage.bytes << " / " << limitText(quota.bytes) << ", inodes "
+            << usage.folders - 1 + usage.files << " / " << limitText(quota.inodes) << "\n";
+        return 0;
+    }
+
+    static std::string limitText(size_t limit) {
+        return limit == 0 ? "unlimited" : std::to_string(limit);
+    }
+
+    static bool parseCount(const std::string& text, size_t& value) {
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && end == text.data() + text.size();
+    }
+
+    static bool parseBytes(const std::string& text, size_t& value) {
+        if (text.empty()) return false;
+        size_t unit = 1;
+        std::string digits = text;
+        switch (text.back()) {
+            case 'k': unit = size_t{1} << 10; break;
+            case 'M': unit = size_t{1} << 20; break;
+            case 'G': unit = size_t{1} << 30; break;
+            default: break;
+        }
+        if (unit != 1) digits.pop_back();
+        if (!parseCount(digits, value) || value > SIZE_MAX / unit) return false;
+        value *= unit;
+        return true;
+    }
+};
+
+std::unique_ptr<ICommand> createQuotaCommand() {
+    return std::make_unique<QuotaCommand>();
+}
+
+} // namespace shell
@@ -11,17 +11,59 @@ public:
                 std::ostream& err,
                 SysApi& sys) override
     {
-        if (!requireArgs(args, 1, err)) return 1;
+        if (!requireArgs(args, 1, err, 5)) return 1;
         
         auto fileName = args[0];
-        auto res = sys.saveToDisk(fileName);
+        std::string format;
+        bool incremental = false;
+        bool async = false;
+        bool compress = false;
+        for (size_t i = 1; i < args.size(); ++i) {
+            if (args[i] == "--incremental") {
+                incremental = true;
+            } else if (args[i] == "--async") {
+                async = true;
+            } else if (args[i] == "--compress") {
+                compress = true;
+            } else if (args[i] == "--format" && i + 1 < args.size() &&
+                       (args[i + 1] == "json" || args[i + 1] == "bin")) {
+                format = args[++i];
+            } else {
+                err << "Usage: " << getUsage() << "\n";
+                return 1;
+            }
+        }
+        if (incremental && format == "json") {
+            err << "savestate: incremental saves use the binary format\n";
+            return 1;
+        }
+        if (incremental && async) {
+            err << "savestate: --async writes a full snapshot, it cannot be incremental\n";
+            return 1;
+        }
+        // the storage picks the format from the extension
+        if (!format.empty()) {
+            std::string ext = "." + format;
+            if (!fileName.ends_with(ext)) fileName += ext;
+        }
+        if (async) {
+            // the result shows up in the log once the worker is done
+            auto res = sys.saveToDiskAsync(fileName, compress);
+            out << (res == SysResult::OK ? "Saving in the background" : "Save result: " + toString(res)) << "\n";
+            return res == SysResult::OK ? 0 : 1;
+        }
+        auto res = sys.saveToDisk(fileName, incremental, compress);
         out << "Save result: " << toString(res) << "\n";
+        // an incremental save that only appended a delta has no snapshot figures
+        if (res == SysResult::OK && !incremental) {
+            out << "Snapshot: " << toString(sys.getSnapshotStats()) << "\n";
+        }
         return res == SysResult::OK ? 0 : 1;
     }
     
     const char* getName() const override { return "savestate"; }
     const char* getDescription() const override { return "Save entire filesystem state to disk"; }
-    const char* getUsage() const override { return "savestate <name>"; }
+    const char* getUsage() const override { return "savestate <name> [--format json|bin] [--incremental | --async] [--compress]"; }
 };
 
 std::unique_ptr<ICommand> createSaveStateCommand() {
@@ -0,0 +1,64 @@
+#include "shell/CommandAPI.h"
+#include "common/TimeUtils.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+namespace shell {
+
+class StatCommand : public ICommand {
+public:
+    int execute(const std::vector<std::string>& args,
+                const std::string& /*input*/,
+                std::ostream& out,
+                std::ostream& err,
+                SysApi& sys) override
+    {
+        if (!requireArgs(args, 1, err)) return 1;
+
+        int rc = 0;
+        for (const auto& name : args) {
+            SysApi::FileStat st;
+            auto res = sys.statFile(name, st);
+            if (res != SysResult::OK) {
+                err << "stat: " << name << ": " << toString(res) << "\n";
+                rc = 1;
+                continue;
+            }
+            char mode[8];
+            std::snprintf(mode, sizeof(mode), "%04o", static_cast<unsigned>(st.mode));
+            out << name << ": " << st.size << " bytes, version " << st.version << "\n"
+                << "  mode " << mode << " (" << permissionText(st.mode) << "), links " << st.links
+                << ", owner uid " << st.ownerUid << " pid " << st.ownerPid << "\n"
+                << "  created " << timeText(st.createdAt) << ", modified " << timeText(st.modifiedAt) << "\n";
+        }
+        return rc;
+    }
+
+    const char* getName() const override { return "stat"; }
+    const char* getDescription() const override { return "Show a file's size, times, mode, owner and version"; }
+    const char* getUsage() const override { return "stat <fileName> [fileName...]"; }
+    int getCpuCost() const override { return 1; }
+
+private:
+    // rwxr-xr-x for 0755; special bits are left to the octal form
+    static std::string permissionText(uint16_t mode) {
+        std::string text;
+        for (int shift = 6; shift >= 0; shift -= 3) {
+            text += (mode >> shift) & 4 ? 'r' : '-';
+            text += (mode >> shift) & 2 ? 'w' : '-';
+            text += (mode >> shift) & 1 ? 'x' : '-';
+        }
+        return text;
+    }
+
+    static std::string timeText(long long seconds) {
+        return common::TimeUtils::format(std::chrono::system_clock::from_time_t(static_cast<std::time_t>(seconds)));
+    }
+};
+
+std::unique_ptr<ICommand> createStatCommand() {
+    return std::make_unique<StatCommand>();
+}
+
+} // namespace shell
@@ -24,6 +24,8 @@ constexpr ::shell::SysResult SYS_OK = static_cast<::shell::SysResult>(0);
 constexpr ::shell::SysResult SYS_NOTFOUND = static_cast<::shell::SysResult>(2);
 
 struct Editor {
+    static constexpr size_t LOAD_CHUNK_SIZE = 64 * 1024;
+
     std::vector<std::string> lines{1, ""};
     std::string fileName;
     std::string statusMsg;
@@ -50,8 +52,8 @@ struct Editor {
             return;
         }
 
-        std::string content;
-        auto res = sys.readFile(fileName, content);
+        ::sys::SysApi::FileStat st;
+        auto res = sys.statFile(fileName, st);
         if (res != SYS_OK) {
             lines.assign(1, "");
             isFileChanged = false;
@@ -59,13 +61,28 @@ struct Editor {
             return;
         }
 
+        // Page the file in and split lines as chunks arrive
         lines.clear();
-        std::istringstream iss(content);
+        std::string chunk;
         std::string line;
-        while (std::getline(iss, line)) {
-            if (!line.empty() && line.back() == '\r')
+        for (size_t offset = 0; offset < st.size; offset += chunk.size()) {
+            if (sys.readFileRange(fileName, offset, LOAD_CHUNK_SIZE, chunk) != SYS_OK || chunk.empty())
+                break;
+            size_t start = 0;
+            for (size_t nl = chunk.find('\n'); nl != std::string::npos; nl = chunk.find('\n', start)) {
+                line.append(chunk, start, nl - start);
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                lines.push_back(std::move(line));
+                line.clear();
+                start = nl + 1;
+            }
+            line.append(chunk, start, std::string::npos);
+        }
+        if (!line.empty()) {
+            if (line.back() == '\r')
                 line.pop_back();
-            lines.push_back(line);
+            lines.push_back(std::move(line));
         }
 
         if (lines.empty())
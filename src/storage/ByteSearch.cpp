@@ -0,0 +1,133 @@
+#include "storage/ByteSearch.h"
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define S3AL_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace storage::search {
+
+namespace {
+
+const char* findScalar(const char* data, size_t size, const char* needle, size_t length) {
+    const char* end = data + size;
+    const char* pos = data;
+    while (static_cast<size_t>(end - pos) >= length) {
+        pos = static_cast<const char*>(std::memchr(pos, needle[0], static_cast<size_t>(end - pos) - length + 1));
+        if (!pos) return nullptr;
+        if (std::memcmp(pos + 1, needle + 1, length - 1) == 0) return pos;
+        ++pos;
+    }
+    return nullptr;
+}
+
+size_t countScalar(const char* data, size_t size, char byte) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i) count += data[i] == byte;
+    return count;
+}
+
+#ifdef S3AL_X86_SIMD
+
+bool hasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+// Needles of two or more bytes; candidates are positions where both the
+// first and the last byte match
+__attribute__((target("avx2")))
+const char* findAvx2(const char* data, size_t size, const char* needle, size_t length) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[length - 1]);
+    size_t i = 0;
+    for (; i + length - 1 + 32 <= size; i += 32) {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + length - 1));
+        auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast))));
+        while (mask != 0) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+            if (std::memcmp(data + i + bit + 1, needle + 1, length - 2) == 0) return data + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(data + i, size - i, needle, length);
+}
+
+__attribute__((target("avx2")))
+size_t countAvx2(const char* data, size_t size, char byte) {
+    const __m256i target = _mm256_set1_epi8(byte);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        count += static_cast<size_t>(__builtin_popcount(
+            static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, target)))));
+    }
+    return count + countScalar(data + i, size - i, byte);
+}
+
+#ifdef __SSE2__
+
+const char* findSse2(const char* data, size_t size, const char* needle, size_t length) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[length - 1]);
+    size_t i = 0;
+    for (; i + length - 1 + 16 <= size; i += 16) {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + length - 1));
+        auto mask = static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast))));
+        while (mask != 0) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+            if (std::memcmp(data + i + bit + 1, needle + 1, length - 2) == 0) return data + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(data + i, size - i, needle, length);
+}
+
+size_t countSse2(const char* data, size_t size, char byte) {
+    const __m128i target = _mm_set1_epi8(byte);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        count += static_cast<size_t>(
+            __builtin_popcount(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, target)))));
+    }
+    return count + countScalar(data + i, size - i, byte);
+}
+
+#endif  // __SSE2__
+#endif  // S3AL_X86_SIMD
+
+}  // namespace
+
+const char* findBytes(const char* data, size_t size, std::string_view needle) {
+    if (needle.empty()) return data;
+    if (needle.size() > size) return nullptr;
+    if (needle.size() == 1) return static_cast<const char*>(std::memchr(data, needle[0], size));
+#ifdef S3AL_X86_SIMD
+    if (hasAvx2()) return findAvx2(data, size, needle.data(), needle.size());
+#ifdef __SSE2__
+    return findSse2(data, size, needle.data(), needle.size());
+#endif
+#endif
+    return findScalar(data, size, needle.data(), needle.size());
+}
+
+size_t countByte(const char* data, size_t size, char byte) {
+#ifdef S3AL_X86_SIMD
+    if (hasAvx2()) return countAvx2(data, size, byte);
+#ifdef __SSE2__
+    return countSse2(data, size, byte);
+#endif
+#endif
+    return countScalar(data, size, byte);
+}
+
+}  // namespace storage::search
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Substring and byte scans used by content search. Internal to the storage
+// library.
+//
+// On x86 both run 32 bytes at a time with AVX2 when the CPU has it, else 16
+// at a time with SSE2; other targets use memchr and plain loops. The
+// substring scan compares the needle's first and last bytes against a whole
+// block at once and only checks the bytes in between at the positions where
+// both match, so its speed on ordinary text is close to memchr's.
+
+namespace storage::search {
+
+// First occurrence of needle in [data, data + size), or nullptr
+const char* findBytes(const char* data, size_t size, std::string_view needle);
+
+// Number of bytes in [data, data + size) equal to byte
+size_t countByte(const char* data, size_t size, char byte);
+
+}  // namespace storage::search
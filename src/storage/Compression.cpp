@@ -0,0 +1,288 @@
+#include "storage/Compression.h"
+#include "storage/SnapshotEncoding.h"
+#include "common/WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+namespace storage::compression {
+
+using namespace snapshot;
+
+namespace {
+
+constexpr char FRAME_MAGIC[8] = {'S', '3', 'A', 'L', 'C', 'M', 'P', 'R'};
+constexpr uint32_t FRAME_VERSION = 1;
+constexpr size_t FRAME_HEADER_SIZE = 8 + 4 + 4;
+constexpr uint32_t STORED_RAW = 0x80000000u;
+// bounds what a corrupt header can make the reader allocate per block
+constexpr uint32_t MAX_BLOCK_SIZE = 64u << 20;
+
+// LZ4 block format limits: matches are at least 4 bytes, the last 5 bytes
+// are always literals and no match starts in the last 12
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MATCH_START_LIMIT = 12;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_BITS = 14;
+
+common::WorkerPool& pool() {
+    return common::WorkerPool::shared();
+}
+
+uint32_t read32(const char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t hashOf(uint32_t value) {
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths of 15 and more continue in bytes of 255 and a final remainder
+char* writeLength(char* out, size_t length) {
+    for (; length >= 255; length -= 255) *out++ = static_cast<char>(255);
+    *out++ = static_cast<char>(length);
+    return out;
+}
+
+bool readLength(const char* src, size_t size, size_t& pos, size_t& length) {
+    unsigned char byte;
+    do {
+        if (pos >= size) return false;
+        byte = static_cast<unsigned char>(src[pos++]);
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+char* writeSequence(char* out, const char* literals, size_t literalCount, size_t offset, size_t matchLength) {
+    char* token = out++;
+    size_t matchCode = matchLength - MIN_MATCH;
+    *token = static_cast<char>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15));
+    if (literalCount >= 15) out = writeLength(out, literalCount - 15);
+    std::memcpy(out, literals, literalCount);
+    out += literalCount;
+    *out++ = static_cast<char>(offset & 0xFF);
+    *out++ = static_cast<char>(offset >> 8);
+    if (matchCode >= 15) out = writeLength(out, matchCode - 15);
+    return out;
+}
+
+// u32 raw size, u32 stored size | flag, then the payload
+std::string packBlock(const std::string& rawBlock) {
+    std::string framed(8 + compressBound(rawBlock.size()), '\0');
+    size_t packed = compressBlock(rawBlock.data(), rawBlock.size(), framed.data() + 8);
+    uint32_t storedSize = static_cast<uint32_t>(packed);
+    if (packed >= rawBlock.size()) {
+        std::memcpy(framed.data() + 8, rawBlock.data(), rawBlock.size());
+        packed = rawBlock.size();
+        storedSize = static_cast<uint32_t>(packed) | STORED_RAW;
+    }
+    framed.resize(8 + packed);
+    std::string sizes;
+    put32(sizes, static_cast<uint32_t>(rawBlock.size()));
+    put32(sizes, storedSize);
+    framed.replace(0, 8, sizes);
+    return framed;
+}
+
+}  // namespace
+
+size_t compressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t compressBlock(const char* src, size_t size, char* dst) {
+    char* out = dst;
+    size_t anchor = 0;
+
+    if (size > MATCH_START_LIMIT) {
+        thread_local std::vector<uint32_t> table;
+        table.assign(size_t{1} << HASH_BITS, 0);
+
+        size_t matchEndLimit = size - LAST_LITERALS;
+        size_t lastStart = size - MATCH_START_LIMIT;
+        size_t pos = 1;
+        size_t misses = 0;
+        table[hashOf(read32(src))] = 0;
+
+        while (pos <= lastStart) {
+            uint32_t sequence = read32(src + pos);
+            uint32_t& slot = table[hashOf(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(pos);
+            if (pos - candidate > MAX_OFFSET || read32(src + candidate) != sequence) {
+                // skip ahead faster through data that does not compress
+                pos += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+
+            while (pos > anchor && candidate > 0 && src[pos - 1] == src[candidate - 1]) {
+                --pos;
+                --candidate;
+            }
+            size_t length = MIN_MATCH;
+            while (pos + length < matchEndLimit && src[candidate + length] == src[pos + length]) {
+                ++length;
+            }
+
+            out = writeSequence(out, src + anchor, pos - anchor, pos - candidate, length);
+            pos += length;
+            anchor = pos;
+            table[hashOf(read32(src + pos - 2))] = static_cast<uint32_t>(pos - 2);
+        }
+    }
+
+    // the last sequence is literals only
+    size_t literalCount = size - anchor;
+    *out++ = static_cast<char>(std::min<size_t>(literalCount, 15) << 4);
+    if (literalCount >= 15) out = writeLength(out, literalCount - 15);
+    std::memcpy(out, src + anchor, literalCount);
+    out += literalCount;
+    return static_cast<size_t>(out - dst);
+}
+
+bool decompressBlock(const char* src, size_t size, char* dst, size_t rawSize) {
+    size_t in = 0;
+    size_t written = 0;
+    while (in < size) {
+        auto token = static_cast<unsigned char>(src[in++]);
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !readLength(src, size, in, literalCount)) return false;
+        if (literalCount > size - in || literalCount > rawSize - written) return false;
+        std::memcpy(dst + written, src + in, literalCount);
+        in += literalCount;
+        written += literalCount;
+        if (in == size) break;  // the last sequence has no match
+
+        if (size - in < 2) return false;
+        size_t offset = static_cast<unsigned char>(src[in]) |
+                        static_cast<size_t>(static_cast<unsigned char>(src[in + 1])) << 8;
+        in += 2;
+        size_t length = token & 15;
+        if (length == 15 && !readLength(src, size, in, length)) return false;
+        length += MIN_MATCH;
+        if (offset == 0 || offset > written || length > rawSize - written) return false;
+
+        char* target = dst + written;
+        const char* from = target - offset;
+        if (offset >= length) {
+            std::memcpy(target, from, length);
+        } else {
+            // overlapping copy repeats the last offset bytes
+            for (size_t i = 0; i < length; ++i) target[i] = from[i];
+        }
+        written += length;
+    }
+    return written == rawSize;
+}
+
+bool isCompressed(const char* data, size_t size) {
+    return size >= sizeof(FRAME_MAGIC) && std::memcmp(data, FRAME_MAGIC, sizeof(FRAME_MAGIC)) == 0;
+}
+
+bool decompress(const char* data, size_t size, std::string& out) {
+    if (size < FRAME_HEADER_SIZE || !isCompressed(data, size) || get32(data + 8) != FRAME_VERSION) {
+        return false;
+    }
+    uint32_t blockSize = get32(data + 12);
+    if (blockSize == 0 || blockSize > MAX_BLOCK_SIZE) return false;
+
+    struct Block {
+        const char* src;
+        uint32_t storedSize;
+        bool storedRaw;
+        uint32_t rawSize;
+        size_t rawOffset;
+    };
+    std::vector<Block> blocks;
+    size_t pos = FRAME_HEADER_SIZE;
+    size_t total = 0;
+    while (true) {
+        if (size - pos < 4) return false;
+        uint32_t rawSize = get32(data + pos);
+        pos += 4;
+        if (rawSize == 0) break;
+        if (size - pos < 4) return false;
+        uint32_t stored = get32(data + pos);
+        pos += 4;
+        Block block{data + pos, stored & ~STORED_RAW, (stored & STORED_RAW) != 0, rawSize, total};
+        if (rawSize > blockSize || block.storedSize > size - pos ||
+            (block.storedRaw && block.storedSize != rawSize)) {
+            return false;
+        }
+        pos += block.storedSize;
+        total += rawSize;
+        blocks.push_back(block);
+    }
+    if (pos != size) return false;
+
+    out.resize(total);
+    std::atomic<bool> ok{true};
+    pool().parallelFor(blocks.size(), [&](size_t i) {
+        const Block& block = blocks[i];
+        char* target = out.data() + block.rawOffset;
+        if (block.storedRaw) {
+            std::memcpy(target, block.src, block.rawSize);
+        } else if (!decompressBlock(block.src, block.storedSize, target, block.rawSize)) {
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+CompressingStreamBuf::CompressingStreamBuf(std::ostream& out, size_t blockSize)
+    : out(out), blockSize(blockSize), block(blockSize, '\0') {
+    setp(block.data(), block.data() + block.size());
+
+    std::string header(FRAME_MAGIC, sizeof(FRAME_MAGIC));
+    put32(header, FRAME_VERSION);
+    put32(header, static_cast<uint32_t>(blockSize));
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    stored = header.size();
+}
+
+CompressingStreamBuf::int_type CompressingStreamBuf::overflow(int_type ch) {
+    submitBlock();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return out.good() ? traits_type::not_eof(ch) : traits_type::eof();
+}
+
+bool CompressingStreamBuf::finish() {
+    submitBlock();
+    while (!inflight.empty()) writeOldest();
+    std::string end;
+    put32(end, 0);
+    out.write(end.data(), static_cast<std::streamsize>(end.size()));
+    stored += end.size();
+    return out.good();
+}
+
+void CompressingStreamBuf::submitBlock() {
+    size_t used = static_cast<size_t>(pptr() - pbase());
+    if (used == 0) return;
+    block.resize(used);
+    raw += used;
+    inflight.push_back(pool().submit([data = std::move(block)] { return packBlock(data); }));
+    if (inflight.size() >= 2 * pool().size()) writeOldest();
+
+    block.assign(blockSize, '\0');
+    setp(block.data(), block.data() + block.size());
+}
+
+void CompressingStreamBuf::writeOldest() {
+    std::string framed = inflight.front().get();
+    inflight.pop_front();
+    out.write(framed.data(), static_cast<std::streamsize>(framed.size()));
+    stored += framed.size();
+}
+
+}  // namespace storage::compression
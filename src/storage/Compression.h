@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+// Block compression for snapshot files. Internal to the storage library.
+//
+// A compressed file is a frame:
+//
+//   header   magic "S3ALCMPR", u32 version, u32 block size
+//   blocks   u32 raw size, u32 stored size (top bit set: stored as is), bytes
+//   end      u32 0
+//
+// Blocks are compressed independently in the LZ4 block format, so both
+// directions run block-parallel on a shared worker pool. A block that does
+// not shrink is stored as is.
+
+namespace storage::compression {
+
+inline constexpr size_t BLOCK_SIZE = 1 << 20;
+
+// Largest output compressBlock can produce for size input bytes
+size_t compressBound(size_t size);
+// Compresses into dst (compressBound(size) bytes), returns the bytes written
+size_t compressBlock(const char* src, size_t size, char* dst);
+// False unless src decodes to exactly rawSize bytes
+bool decompressBlock(const char* src, size_t size, char* dst, size_t rawSize);
+
+// True when data starts like a compressed frame
+bool isCompressed(const char* data, size_t size);
+// Decompresses a whole frame into out; false if it is corrupt or truncated
+bool decompress(const char* data, size_t size, std::string& out);
+
+// Output buffer that compresses what is written through it block by block
+// and writes the frame to out. Up to two blocks per pool thread are in
+// flight; finished blocks are written in order by the writing thread.
+class CompressingStreamBuf : public std::streambuf {
+public:
+    explicit CompressingStreamBuf(std::ostream& out, size_t blockSize = BLOCK_SIZE);
+    CompressingStreamBuf(const CompressingStreamBuf&) = delete;
+    CompressingStreamBuf& operator=(const CompressingStreamBuf&) = delete;
+
+    // Writes the remaining blocks and the end marker; false if out failed
+    bool finish();
+
+    uint64_t rawBytes() const { return raw; }
+    uint64_t storedBytes() const { return stored; }
+
+protected:
+    int_type overflow(int_type ch) override;
+
+private:
+    void submitBlock();
+    void writeOldest();
+
+    std::ostream& out;
+    size_t blockSize;
+    std::string block;
+    std::deque<std::future<std::string>> inflight;
+    uint64_t raw = 0;
+    uint64_t stored = 0;
+};
+
+}  // namespace storage::compression
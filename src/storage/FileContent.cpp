@@ -0,0 +1,413 @@
+#include "storage/FileContent.h"
+#include "kernel/SysCallsAPI.h"
+#include <algorithm>
+#include <cstring>
+
+namespace storage {
+
+void* ContentAllocator::allocate(size_t size) {
+    if (!sysApi || size == 0) return nullptr;
+    std::lock_guard<std::mutex> guard(mutex);
+    return sysApi->allocateMemory(size, 0);
+}
+
+void ContentAllocator::deallocate(void* ptr) {
+    if (!sysApi || !ptr) return;
+    std::lock_guard<std::mutex> guard(mutex);
+    if (!batching) {
+        sysApi->deallocateMemory(ptr);
+        return;
+    }
+    pendingFrees.push_back(ptr);
+    if (pendingFrees.size() >= FREE_BATCH) flush();
+}
+
+void ContentAllocator::endBatch() {
+    std::lock_guard<std::mutex> guard(mutex);
+    batching = false;
+    flush();
+}
+
+void ContentAllocator::flush() {
+    if (pendingFrees.empty()) return;
+    if (sysApi) sysApi->deallocateMemoryBatch(pendingFrees);
+    pendingFrees.clear();
+}
+
+namespace {
+
+// Calls fn(extentBytes, count) for every piece of [offset, offset + len),
+// which must lie inside the content
+template <typename Fn>
+void forEachPiece(const std::vector<FileContent::Extent>& extents, size_t offset, size_t len, Fn fn) {
+    size_t index = offset / FileContent::EXTENT_SIZE;
+    size_t within = offset % FileContent::EXTENT_SIZE;
+    while (len > 0) {
+        const auto& extent = extents[index];
+        size_t count = std::min(len, extent.size - within);
+        fn(static_cast<char*>(extent.memoryToken) + within, count);
+        len -= count;
+        within = 0;
+        ++index;
+    }
+}
+
+// Segments of the content as views, see forEachSegment
+std::vector<std::string_view> segmentsOf(const FileContent& content) {
+    std::vector<std::string_view> segments;
+    content.forEachSegment([&segments](const char* bytes, size_t count) { segments.emplace_back(bytes, count); });
+    return segments;
+}
+
+// Compares two byte sequences of the same total length given as pieces
+bool samePieces(const std::vector<std::string_view>& a, const std::vector<std::string_view>& b) {
+    size_t i = 0, j = 0, offsetA = 0, offsetB = 0;
+    while (i < a.size() && j < b.size()) {
+        size_t count = std::min(a[i].size() - offsetA, b[j].size() - offsetB);
+        if (std::memcmp(a[i].data() + offsetA, b[j].data() + offsetB, count) != 0) return false;
+        offsetA += count;
+        offsetB += count;
+        if (offsetA == a[i].size()) { ++i; offsetA = 0; }
+        if (offsetB == b[j].size()) { ++j; offsetB = 0; }
+    }
+    return true;
+}
+
+constexpr uint64_t HASH_PRIME_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t HASH_PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+
+}  // namespace
+
+void ContentHasher::mix(uint64_t word) {
+    state ^= word * HASH_PRIME_2;
+    state = ((state << 31) | (state >> 33)) * HASH_PRIME_1;
+}
+
+void ContentHasher::update(const char* data, size_t size) {
+    total += size;
+    if (pendingSize > 0) {
+        size_t count = std::min(size, sizeof(pending) - pendingSize);
+        std::memcpy(pending + pendingSize, data, count);
+        pendingSize += count;
+        data += count;
+        size -= count;
+        if (pendingSize < sizeof(pending)) return;
+        uint64_t word;
+        std::memcpy(&word, pending, sizeof(word));
+        mix(word);
+        pendingSize = 0;
+    }
+    for (; size >= 8; data += 8, size -= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        mix(word);
+    }
+    std::memcpy(pending, data, size);
+    pendingSize = size;
+}
+
+uint64_t ContentHasher::digest() const {
+    uint64_t h = state ^ total;
+    for (size_t i = 0; i < pendingSize; ++i) {
+        h = (h ^ pending[i]) * HASH_PRIME_1;
+    }
+    // final avalanche so every input bit reaches every output bit
+    h ^= h >> 33;
+    h *= HASH_PRIME_2;
+    h ^= h >> 29;
+    h *= HASH_PRIME_1;
+    h ^= h >> 32;
+    return h;
+}
+
+FileContent::~FileContent() {
+    clear();
+}
+
+FileContent::FileContent(FileContent&& other) noexcept
+    : allocator(other.allocator),
+      extents(std::move(other.extents)),
+      contentSize(other.contentSize),
+      mappedPin(std::move(other.mappedPin)),
+      mappedBytes(other.mappedBytes) {
+    other.extents.clear();
+    other.contentSize = 0;
+    other.mappedBytes = nullptr;
+}
+
+FileContent& FileContent::operator=(FileContent&& other) noexcept {
+    if (this != &other) {
+        clear();
+        allocator = other.allocator;
+        extents = std::move(other.extents);
+        contentSize = other.contentSize;
+        mappedPin = std::move(other.mappedPin);
+        mappedBytes = other.mappedBytes;
+        other.extents.clear();
+        other.contentSize = 0;
+        other.mappedBytes = nullptr;
+    }
+    return *this;
+}
+
+FileContent FileContent::mapped(ContentAllocator* allocator, std::shared_ptr<const void> pin,
+                                const char* bytes, size_t size) {
+    FileContent content(allocator);
+    if (size > 0) {
+        content.mappedPin = std::move(pin);
+        content.mappedBytes = bytes;
+        content.contentSize = size;
+    }
+    return content;
+}
+
+bool FileContent::materialize() {
+    if (!mappedBytes) return true;
+
+    const char* src = mappedBytes;
+    FileContent resident(allocator);
+    bool filled = resident.fill(contentSize, [&src](char* dest, size_t count) {
+        std::memcpy(dest, src, count);
+        src += count;
+        return true;
+    });
+    if (!filled) return false;
+    *this = std::move(resident);
+    return true;
+}
+
+void FileContent::clear() {
+    if (allocator) {
+        for (auto& extent : extents) {
+            allocator->deallocate(extent.memoryToken);
+        }
+    }
+    extents.clear();
+    contentSize = 0;
+    mappedPin.reset();
+    mappedBytes = nullptr;
+}
+
+bool FileContent::grow(size_t newSize) {
+    if (!allocator) return false;
+
+    // Allocate everything first so a failure leaves the content untouched
+    size_t tailStart = extents.empty() ? 0 : (extents.size() - 1) * EXTENT_SIZE;
+    size_t tailNeeded = extents.empty() ? 0 : std::min(EXTENT_SIZE, newSize - tailStart);
+    void* newTail = nullptr;
+    size_t newTailCapacity = 0;
+    if (!extents.empty() && tailNeeded > extents.back().capacity) {
+        size_t oldCapacity = extents.back().capacity;
+        newTailCapacity = (newSize - tailStart > EXTENT_SIZE)
+            ? EXTENT_SIZE
+            : std::min(EXTENT_SIZE, std::max({tailNeeded, oldCapacity * 2, MIN_TAIL_CAPACITY}));
+        newTail = allocator->allocate(newTailCapacity);
+        if (!newTail && newTailCapacity > tailNeeded) {
+            newTailCapacity = tailNeeded;
+            newTail = allocator->allocate(newTailCapacity);
+        }
+        if (!newTail) return false;
+    }
+
+    std::vector<Extent> added;
+    size_t covered = extents.empty() ? 0 : tailStart + EXTENT_SIZE;
+    while (covered < newSize) {
+        size_t need = std::min(EXTENT_SIZE, newSize - covered);
+        size_t capacity = std::max(need, MIN_TAIL_CAPACITY);
+        void* block = allocator->allocate(capacity);
+        if (!block) {
+            for (auto& extent : added) allocator->deallocate(extent.memoryToken);
+            allocator->deallocate(newTail);
+            return false;
+        }
+        added.push_back({block, need, capacity});
+        covered += EXTENT_SIZE;
+    }
+
+    if (!extents.empty()) {
+        Extent& tail = extents.back();
+        if (newTail) {
+            std::memcpy(newTail, tail.memoryToken, tail.size);
+            allocator->deallocate(tail.memoryToken);
+            tail.memoryToken = newTail;
+            tail.capacity = newTailCapacity;
+        }
+        tail.size = tailNeeded;
+    }
+    extents.insert(extents.end(), added.begin(), added.end());
+    contentSize = newSize;
+    return true;
+}
+
+void FileContent::shrink(size_t newSize) {
+    size_t keep = (newSize + EXTENT_SIZE - 1) / EXTENT_SIZE;
+    for (size_t i = keep; i < extents.size(); ++i) {
+        allocator->deallocate(extents[i].memoryToken);
+    }
+    extents.resize(keep);
+    contentSize = newSize;
+    if (keep == 0) return;
+
+    // Hand back most of an oversized tail, keeping the old block if memory is tight
+    Extent& tail = extents.back();
+    tail.size = newSize - (keep - 1) * EXTENT_SIZE;
+    if (tail.capacity > MIN_TAIL_CAPACITY && tail.size < tail.capacity / 4) {
+        size_t capacity = std::max(tail.size, MIN_TAIL_CAPACITY);
+        if (void* block = allocator->allocate(capacity)) {
+            std::memcpy(block, tail.memoryToken, tail.size);
+            allocator->deallocate(tail.memoryToken);
+            tail.memoryToken = block;
+            tail.capacity = capacity;
+        }
+    }
+}
+
+bool FileContent::resize(size_t newSize) {
+    if (!materialize()) return false;
+    if (newSize < contentSize) {
+        shrink(newSize);
+        return true;
+    }
+    if (newSize > contentSize) {
+        size_t oldSize = contentSize;
+        if (!grow(newSize)) return false;
+        forEachPiece(extents, oldSize, newSize - oldSize,
+                     [](char* dest, size_t count) { std::memset(dest, 0, count); });
+    }
+    return true;
+}
+
+bool FileContent::writeAt(size_t offset, const void* data, size_t len) {
+    if (len == 0) return true;
+    if (!materialize()) return false;
+
+    size_t end = offset + len;
+    if (end > contentSize) {
+        size_t oldSize = contentSize;
+        if (!grow(end)) return false;
+        if (offset > oldSize) {
+            forEachPiece(extents, oldSize, offset - oldSize,
+                         [](char* dest, size_t count) { std::memset(dest, 0, count); });
+        }
+    }
+
+    const char* src = static_cast<const char*>(data);
+    forEachPiece(extents, offset, len, [&src](char* dest, size_t count) {
+        std::memcpy(dest, src, count);
+        src += count;
+    });
+    return true;
+}
+
+bool FileContent::append(const void* data, size_t len) {
+    return writeAt(contentSize, data, len);
+}
+
+bool FileContent::assign(const void* data, size_t len) {
+    if (len == 0) {
+        clear();
+        return true;
+    }
+    if (mappedBytes) {
+        // nothing of the old bytes survives, so drop them instead of copying in
+        FileContent replacement(allocator);
+        if (!replacement.assign(data, len)) return false;
+        *this = std::move(replacement);
+        return true;
+    }
+    if (len > contentSize) {
+        if (!grow(len)) return false;
+    } else {
+        shrink(len);
+    }
+    return writeAt(0, data, len);
+}
+
+bool FileContent::copyFrom(const FileContent& other) {
+    if (this == &other) return true;
+
+    FileContent copy(allocator);
+    if (other.mappedBytes) {
+        // still mapped: copy straight from the mapping
+        const char* src = other.mappedBytes;
+        bool filled = copy.fill(other.contentSize, [&src](char* dest, size_t count) {
+            std::memcpy(dest, src, count);
+            src += count;
+            return true;
+        });
+        if (!filled) return false;
+    } else {
+        if (other.contentSize > 0 && !copy.grow(other.contentSize)) {
+            return false;
+        }
+        // both sides use the same extent layout for the same size
+        for (size_t i = 0; i < other.extents.size(); ++i) {
+            std::memcpy(copy.extents[i].memoryToken, other.extents[i].memoryToken, other.extents[i].size);
+        }
+    }
+    *this = std::move(copy);
+    return true;
+}
+
+bool FileContent::fill(size_t len, const std::function<bool(char*, size_t)>& producer) {
+    FileContent filled(allocator);
+    if (len > 0 && !filled.grow(len)) {
+        return false;
+    }
+    for (auto& extent : filled.extents) {
+        if (!producer(static_cast<char*>(extent.memoryToken), extent.size)) {
+            return false;
+        }
+    }
+    *this = std::move(filled);
+    return true;
+}
+
+bool FileContent::allocateUninitialized(size_t len) {
+    FileContent allocated(allocator);
+    if (len > 0 && !allocated.grow(len)) {
+        return false;
+    }
+    *this = std::move(allocated);
+    return true;
+}
+
+size_t FileContent::readAt(size_t offset, size_t len, void* out) const {
+    if (offset >= contentSize) return 0;
+    len = std::min(len, contentSize - offset);
+    if (mappedBytes) {
+        std::memcpy(out, mappedBytes + offset, len);
+        return len;
+    }
+
+    char* dest = static_cast<char*>(out);
+    forEachPiece(extents, offset, len, [&dest](char* src, size_t count) {
+        std::memcpy(dest, src, count);
+        dest += count;
+    });
+    return len;
+}
+
+void FileContent::appendTo(std::string& out) const {
+    out.reserve(out.size() + contentSize);
+    forEachSegment([&out](const char* bytes, size_t count) { out.append(bytes, count); });
+}
+
+uint64_t FileContent::hash() const {
+    ContentHasher hasher;
+    forEachSegment([&hasher](const char* bytes, size_t count) { hasher.update(bytes, count); });
+    return hasher.digest();
+}
+
+bool FileContent::equals(const FileContent& other) const {
+    if (this == &other) return true;
+    return contentSize == other.contentSize && samePieces(segmentsOf(*this), segmentsOf(other));
+}
+
+bool FileContent::equals(std::initializer_list<std::string_view> pieces) const {
+    size_t total = 0;
+    for (auto piece : pieces) total += piece.size();
+    return total == contentSize && samePieces(segmentsOf(*this), std::vector<std::string_view>(pieces));
+}
+
+}  // namespace storage
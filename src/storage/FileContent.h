@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sys { struct SysApi; }
+
+namespace storage {
+
+// Hands out simulated memory for file contents. StorageManager owns one and
+// every FileContent points at it, so detaching the SysApi (setSysApi(nullptr))
+// reaches all contents at once. Safe to use from any thread: a content
+// pinned by a reader may be freed on whichever thread drops it last.
+struct ContentAllocator {
+    // blocks handed back per bulk free while batching
+    static constexpr size_t FREE_BATCH = 4096;
+
+    sys::SysApi* sysApi = nullptr;
+
+    void* allocate(size_t size);
+    void deallocate(void* ptr);
+
+    // Between these, deallocate() queues blocks and returns them FREE_BATCH
+    // at a time through one bulk free; endBatch() returns the rest
+    void beginBatch() {
+        std::lock_guard<std::mutex> guard(mutex);
+        batching = true;
+    }
+    void endBatch();
+
+private:
+    void flush();
+
+    std::mutex mutex;
+    bool batching = false;
+    std::vector<void*> pendingFrees;
+};
+
+// Streaming 64-bit hash of file bytes, used to find identical contents.
+// The digest depends only on the bytes fed in, not on how they were split
+// across update() calls. Not cryptographic: equal digests still need a
+// byte comparison.
+class ContentHasher {
+public:
+    void update(const char* data, size_t size);
+    uint64_t digest() const;
+
+private:
+    void mix(uint64_t word);
+
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    uint64_t total = 0;
+    unsigned char pending[8] = {};
+    size_t pendingSize = 0;
+};
+
+// File bytes stored as a list of extents allocated through MemoryManager.
+// Every extent except the last one is exactly EXTENT_SIZE bytes, so the extent
+// holding an offset is found by division and a change only touches the
+// extents it covers. The last extent grows geometrically up to EXTENT_SIZE,
+// which keeps small files small and appends amortized O(appended bytes).
+//
+// Content can also start out mapped: its bytes then live in a read-only
+// snapshot mapping (kept alive through pin) and take no simulated memory
+// until materialize() copies them in. Mutators materialize on their own.
+class FileContent {
+public:
+    static constexpr size_t EXTENT_SIZE = 64 * 1024;
+    static constexpr size_t MIN_TAIL_CAPACITY = 64;
+
+    struct Extent {
+        void* memoryToken = nullptr;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+    FileContent() = default;
+    explicit FileContent(ContentAllocator* allocator) : allocator(allocator) {}
+    ~FileContent();
+
+    FileContent(const FileContent&) = delete;
+    FileContent& operator=(const FileContent&) = delete;
+    FileContent(FileContent&& other) noexcept;
+    FileContent& operator=(FileContent&& other) noexcept;
+
+    static FileContent mapped(ContentAllocator* allocator, std::shared_ptr<const void> pin,
+                              const char* bytes, size_t size);
+
+    size_t size() const { return contentSize; }
+    bool empty() const { return contentSize == 0; }
+    bool isResident() const { return !mappedBytes; }
+    // Empty while the content is still mapped, see forEachSegment
+    const std::vector<Extent>& getExtents() const { return extents; }
+
+    // Calls fn(bytes, count) for each stored piece in order, wherever the
+    // bytes currently live
+    template <typename Fn>
+    void forEachSegment(Fn&& fn) const {
+        if (mappedBytes) {
+            if (contentSize > 0) fn(mappedBytes, contentSize);
+            return;
+        }
+        for (const auto& extent : extents) {
+            fn(static_cast<const char*>(extent.memoryToken), extent.size);
+        }
+    }
+
+    // Moves mapped bytes into simulated memory; false if memory runs out
+    bool materialize();
+
+    // All mutators return false when simulated memory runs out and leave
+    // the content unchanged in that case
+    bool assign(const void* data, size_t len);
+    bool append(const void* data, size_t len);
+    bool writeAt(size_t offset, const void* data, size_t len);
+    bool resize(size_t newSize);
+    bool copyFrom(const FileContent& other);
+    // Replaces the content with len bytes written by producer straight into
+    // the extents, one call per extent; returning false from it aborts
+    bool fill(size_t len, const std::function<bool(char* dest, size_t count)>& producer);
+    // Replaces the content with len bytes of unspecified value, for callers
+    // that write the extents themselves (see getExtents)
+    bool allocateUninitialized(size_t len);
+    void clear();
+
+    // Copies up to len bytes starting at offset, returns the number copied
+    size_t readAt(size_t offset, size_t len, void* out) const;
+    void appendTo(std::string& out) const;
+
+    // ContentHasher digest of the bytes
+    uint64_t hash() const;
+    // Byte-for-byte comparison with another content, or with the
+    // concatenation of pieces
+    bool equals(const FileContent& other) const;
+    bool equals(std::initializer_list<std::string_view> pieces) const;
+
+private:
+    bool grow(size_t newSize);
+    void shrink(size_t newSize);
+
+    ContentAllocator* allocator = nullptr;
+    std::vector<Extent> extents;
+    size_t contentSize = 0;
+    std::shared_ptr<const void> mappedPin;
+    const char* mappedBytes = nullptr;
+};
+
+}  // namespace storage
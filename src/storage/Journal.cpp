@@ -0,0 +1,233 @@
+#include "storage/Journal.h"
+#include "storage/SnapshotEncoding.h"
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace storage {
+
+using namespace snapshot;
+
+namespace {
+
+constexpr char JOURNAL_MAGIC[8] = {'S', '3', 'A', 'L', 'J', 'R', 'N', 'L'};
+constexpr uint32_t JOURNAL_VERSION = 1;
+constexpr size_t RECORD_HEADER_SIZE = 4 + 4;
+
+// CRC-32 (IEEE), the one zlib and most tools compute
+uint32_t crc32(std::string_view data) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (unsigned char byte : data) crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+bool syncFile(std::FILE* file) {
+    if (std::fflush(file) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return ::fsync(::fileno(file)) == 0;
+#endif
+}
+
+// Header (and any records carried over) goes to a temporary file first so
+// an existing journal is only replaced by a complete one
+bool writeHeaderFile(const std::string& path, const std::string& snapshotName, std::string_view records = {}) {
+    std::string header(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    put32(header, JOURNAL_VERSION);
+    putString(header, snapshotName);
+    header.append(records);
+
+    std::string tmpPath = path + ".tmp";
+    std::FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size() && syncFile(file);
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::filesystem::remove(tmpPath);
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(tmpPath, path, error);
+    return !error;
+}
+
+bool readRange(const std::string& path, uint64_t from, uint64_t to, std::string& out) {
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    out.resize(to - from);
+    in.seekg(static_cast<std::streamoff>(from));
+    in.read(out.data(), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(in);
+}
+
+}  // namespace
+
+Journal::Journal(std::string path, const JournalOptions& options)
+    : filePath(std::move(path)), options(options) {}
+
+Journal::~Journal() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (flusher.joinable()) flusher.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    commitLocked();
+    if (file) std::fclose(file);
+}
+
+std::unique_ptr<Journal> Journal::create(const std::string& path, const std::string& snapshotName,
+                                         const JournalOptions& options) {
+    if (!writeHeaderFile(path, snapshotName)) return nullptr;
+    std::unique_ptr<Journal> journal(new Journal(path, options));
+    if (!journal->openForAppend()) return nullptr;
+    return journal;
+}
+
+std::unique_ptr<Journal> Journal::resume(const std::string& path, uint64_t validBytes,
+                                         const JournalOptions& options) {
+    std::error_code error;
+    if (std::filesystem::file_size(path, error) > validBytes && !error) {
+        // a torn record at the end would hide everything appended after it
+        std::filesystem::resize_file(path, validBytes, error);
+        if (error) return nullptr;
+    }
+    std::unique_ptr<Journal> journal(new Journal(path, options));
+    if (!journal->openForAppend()) return nullptr;
+    return journal;
+}
+
+bool Journal::openForAppend() {
+    file = std::fopen(filePath.c_str(), "ab");
+    if (!file) return false;
+    std::error_code error;
+    fileBytes = std::filesystem::file_size(filePath, error);
+    if (error) return false;
+    if (options.sync != JournalSync::Always && !flusher.joinable()) {
+        flusher = std::thread([this] { flusherLoop(); });
+    }
+    return true;
+}
+
+bool Journal::readHeader(const char* data, uint64_t size, std::string& outSnapshot, uint64_t& outHeaderBytes) {
+    Reader reader(data, size);
+    const char* magic = reader.bytes(sizeof(JOURNAL_MAGIC));
+    if (!magic || std::memcmp(magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+        reader.u32() != JOURNAL_VERSION) {
+        return false;
+    }
+    std::string_view name = reader.string();
+    if (!reader.ok()) return false;
+    outSnapshot = name;
+    outHeaderBytes = reader.position();
+    return true;
+}
+
+bool Journal::readRecord(const char* data, uint64_t size, uint64_t offset, std::string_view& outPayload,
+                         uint64_t& outNext) {
+    if (offset > size || size - offset < RECORD_HEADER_SIZE) return false;
+    uint32_t length = get32(data + offset);
+    uint32_t checksum = get32(data + offset + 4);
+    if (length > size - offset - RECORD_HEADER_SIZE) return false;
+    std::string_view payload(data + offset + RECORD_HEADER_SIZE, length);
+    if (crc32(payload) != checksum) return false;
+    outPayload = payload;
+    outNext = offset + RECORD_HEADER_SIZE + length;
+    return true;
+}
+
+bool Journal::append(std::string_view payload) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending.empty()) {
+        pendingSince = std::chrono::steady_clock::now();
+        wake.notify_one();
+    }
+    put32(pending, static_cast<uint32_t>(payload.size()));
+    put32(pending, crc32(payload));
+    pending.append(payload);
+    ++pendingRecords;
+
+    if (options.sync == JournalSync::Always || pendingRecords >= options.groupRecords) {
+        return commitLocked();
+    }
+    return healthy;
+}
+
+bool Journal::commit() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return commitLocked();
+}
+
+bool Journal::commitLocked() {
+    if (pending.empty() || !file) return healthy;
+    bool ok = std::fwrite(pending.data(), 1, pending.size(), file) == pending.size();
+    ok = ok && (options.sync == JournalSync::Never ? std::fflush(file) == 0 : syncFile(file));
+    healthy = healthy && ok;
+    fileBytes += pending.size();
+    pending.clear();
+    pendingRecords = 0;
+    return healthy;
+}
+
+bool Journal::restart(const std::string& snapshotName, uint64_t keepFrom) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool keptAll = true;
+    std::string kept;
+    if (keepFrom < fileBytes + pending.size()) {
+        keptAll = commitLocked();
+    }
+    pending.clear();
+    pendingRecords = 0;
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    if (keepFrom < fileBytes) {
+        keptAll = readRange(filePath, keepFrom, fileBytes, kept) && keptAll;
+    }
+    healthy = writeHeaderFile(filePath, snapshotName, kept) && openForAppend();
+    // records that never reached the file are lost with the old journal
+    healthy = healthy && keptAll;
+    return healthy;
+}
+
+uint64_t Journal::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fileBytes + pending.size();
+}
+
+void Journal::flusherLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (pending.empty()) {
+            wake.wait(lock);
+            continue;
+        }
+        auto deadline = pendingSince + options.groupWindow;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            commitLocked();
+            continue;
+        }
+        wake.wait_until(lock, deadline);
+    }
+}
+
+}  // namespace storage
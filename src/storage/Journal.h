@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace storage {
+
+// When appended records reach the disk
+enum class JournalSync {
+    Always,  // write and fsync every record before the operation returns
+    Batch,   // group commit: one write + fsync per group of records
+    Never    // group writes, leave flushing to the OS
+};
+
+struct JournalOptions {
+    JournalSync sync = JournalSync::Batch;
+    // a group is committed when it holds this many records, or when its
+    // oldest record has waited this long
+    size_t groupRecords = 128;
+    std::chrono::milliseconds groupWindow{20};
+};
+
+// Append-only write-ahead journal file:
+//
+//   header   magic "S3ALJRNL", u32 version, u32 length + snapshot name
+//   records  u32 payload length, u32 CRC-32 of the payload, payload
+//
+// The snapshot name is what the records apply on top of; empty means an
+// empty tree. Record payloads are opaque here, StorageManager encodes them.
+// Reading stops at the first short or corrupt record, which is where a
+// crash mid-append leaves the file.
+class Journal {
+public:
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Starts a new journal on top of snapshotName, replacing any file at path
+    static std::unique_ptr<Journal> create(const std::string& path, const std::string& snapshotName,
+                                           const JournalOptions& options);
+    // Continues an existing journal, cutting it to its first validBytes
+    static std::unique_ptr<Journal> resume(const std::string& path, uint64_t validBytes,
+                                           const JournalOptions& options);
+
+    // Parses the header; outHeaderBytes is where the records start
+    static bool readHeader(const char* data, uint64_t size, std::string& outSnapshot, uint64_t& outHeaderBytes);
+    // Reads the record at offset; false at the end of the valid records
+    static bool readRecord(const char* data, uint64_t size, uint64_t offset, std::string_view& outPayload,
+                           uint64_t& outNext);
+
+    // Returns once the record is as durable as the sync policy promises
+    bool append(std::string_view payload);
+    // Writes (and syncs, unless the policy is Never) everything pending
+    bool commit();
+    // Drops the records before keepFrom, a size() taken earlier (all of
+    // them by default): the state they described is now in snapshotName
+    bool restart(const std::string& snapshotName, uint64_t keepFrom = UINT64_MAX);
+    // Length of the journal including records not written out yet
+    uint64_t size();
+
+    const std::string& path() const { return filePath; }
+
+private:
+    Journal(std::string path, const JournalOptions& options);
+    bool openForAppend();
+    bool commitLocked();
+    void flusherLoop();
+
+    std::string filePath;
+    JournalOptions options;
+    std::FILE* file = nullptr;
+    uint64_t fileBytes = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread flusher;
+    bool stopping = false;
+    bool healthy = true;
+    std::string pending;
+    size_t pendingRecords = 0;
+    std::chrono::steady_clock::time_point pendingSince;
+};
+
+}  // namespace storage
@@ -0,0 +1,68 @@
+#include "storage/MappedFile.h"
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace storage {
+
+#ifdef _WIN32
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path) {
+    std::ifstream in(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!in.is_open()) return nullptr;
+
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->buffer.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0, std::ios::beg);
+    if (!in.read(file->buffer.data(), static_cast<std::streamsize>(file->buffer.size()))) {
+        return nullptr;
+    }
+    file->bytes = file->buffer.data();
+    file->length = file->buffer.size();
+    return file;
+}
+
+MappedFile::~MappedFile() = default;
+
+#else
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->length = static_cast<size_t>(st.st_size);
+    if (file->length > 0) {
+        void* addr = ::mmap(nullptr, file->length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            return nullptr;
+        }
+        file->bytes = static_cast<const char*>(addr);
+    }
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (bytes) {
+        ::munmap(const_cast<char*>(bytes), length);
+    }
+}
+
+#endif
+
+}  // namespace storage
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace storage {
+
+// Read-only image of a whole host file. Uses mmap where available, so pages
+// are only read from disk when touched; elsewhere the file is read in once.
+class MappedFile {
+public:
+    // nullptr if the file cannot be opened or mapped
+    static std::shared_ptr<MappedFile> open(const std::string& path);
+
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    MappedFile() = default;
+
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+};
+
+}  // namespace storage
@@ -0,0 +1,140 @@
+#include "storage/NodeName.h"
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace storage {
+
+// Names go into detail::namePages, which readers holding an id use without
+// the lock; their bytes are packed one after another into blocks. Ids are
+// found by text through an open addressing table that lookups also probe
+// without the lock: slots are only ever filled, and a grown table is
+// published whole while the old one stays readable.
+class NameTable {
+public:
+    static constexpr uint32_t PAGE_SIZE = detail::NAME_PAGE_SIZE;
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    using Entry = detail::NameEntry;
+
+    static NameTable& instance() {
+        // never destroyed: trees in static objects may still be dropping names
+        static NameTable* table = new NameTable;
+        return *table;
+    }
+
+    // 0 (the empty name) when text was never interned
+    uint32_t find(std::string_view text) const {
+        if (text.empty()) return 0;
+        const Slots* slots = current.load(std::memory_order_acquire);
+        for (size_t i = std::hash<std::string_view>{}(text) & slots->mask;; i = (i + 1) & slots->mask) {
+            uint32_t id = slots->ids[i].load(std::memory_order_acquire);
+            if (id == 0 || NodeName::fromId(id).view() == text) return id;
+        }
+    }
+
+    uint32_t intern(std::string_view text) {
+        if (text.empty()) return 0;
+        std::lock_guard<std::mutex> guard(mutex);
+        Slots& slots = *tables.back();
+        size_t i = std::hash<std::string_view>{}(text) & slots.mask;
+        for (uint32_t id; (id = slots.ids[i].load(std::memory_order_relaxed)) != 0; i = (i + 1) & slots.mask) {
+            if (entryText(id) == text) return id;
+        }
+
+        if (count == UINT32_MAX) throw std::length_error("name table full");
+        uint32_t id = count++;
+        if (id % PAGE_SIZE == 0) addPage();
+        pageStore.back()[id % PAGE_SIZE] = {copyText(text), static_cast<uint32_t>(text.size())};
+        slots.ids[i].store(id, std::memory_order_release);
+        if (size_t(count) * 2 > slots.mask + 1) grow();
+        return id;
+    }
+
+    NameTableStats stats() {
+        std::lock_guard<std::mutex> guard(mutex);
+        uint64_t bytes = pageStore.size() * PAGE_SIZE * sizeof(Entry);
+        for (const auto& slots : tables) bytes += (slots->mask + 1) * sizeof(uint32_t);
+        for (const auto& block : blocks) bytes += block.second;
+        return {count - 1, bytes};
+    }
+
+private:
+    struct Slots {
+        explicit Slots(size_t capacity) : mask(capacity - 1), ids(new std::atomic<uint32_t>[capacity]()) {}
+        size_t mask;
+        std::unique_ptr<std::atomic<uint32_t>[]> ids;  // 0 is empty
+    };
+
+    NameTable() {
+        // id 0 is the empty name; it never goes into the slots
+        addPage();
+        pageStore.back()[0] = {"", 0};
+        tables.push_back(std::make_unique<Slots>(1024));
+        current.store(tables.back().get(), std::memory_order_release);
+    }
+
+    std::string_view entryText(uint32_t id) const {
+        const Entry& entry = pageStore[id / PAGE_SIZE][id % PAGE_SIZE];
+        return {entry.data, entry.size};
+    }
+
+    void addPage() {
+        // left uninitialized: only the entries in use take host memory
+        pageStore.emplace_back(new Entry[PAGE_SIZE]);
+        detail::namePages[pageStore.size() - 1].store(pageStore.back().get(), std::memory_order_release);
+    }
+
+    const char* copyText(std::string_view text) {
+        if (text.size() > BLOCK_SIZE / 4) {
+            blocks.emplace_back(new char[text.size()], text.size());
+            std::memcpy(blocks.back().first.get(), text.data(), text.size());
+            return blocks.back().first.get();
+        }
+        if (!tail || blockUsed + text.size() > BLOCK_SIZE) {
+            blocks.emplace_back(new char[BLOCK_SIZE], BLOCK_SIZE);
+            blockUsed = 0;
+            tail = blocks.back().first.get();
+        }
+        char* out = tail + blockUsed;
+        std::memcpy(out, text.data(), text.size());
+        blockUsed += text.size();
+        return out;
+    }
+
+    void grow() {
+        auto grown = std::make_unique<Slots>((tables.back()->mask + 1) * 2);
+        for (uint32_t id = 1; id < count; ++id) {
+            size_t i = std::hash<std::string_view>{}(entryText(id)) & grown->mask;
+            while (grown->ids[i].load(std::memory_order_relaxed) != 0) i = (i + 1) & grown->mask;
+            grown->ids[i].store(id, std::memory_order_relaxed);
+        }
+        tables.push_back(std::move(grown));
+        current.store(tables.back().get(), std::memory_order_release);
+    }
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Entry[]>> pageStore;
+    // every table so far, kept at most half full; the last is current.
+    // Older ones stay for lookups that started on them (they add up to
+    // less than the current one).
+    std::vector<std::unique_ptr<Slots>> tables;
+    std::atomic<const Slots*> current{nullptr};
+    uint32_t count = 1;  // ids handed out so far, the empty name included
+    std::vector<std::pair<std::unique_ptr<char[]>, size_t>> blocks;
+    char* tail = nullptr;
+    size_t blockUsed = 0;
+};
+
+NodeName::NodeName(std::string_view text) : id(NameTable::instance().intern(text)) {}
+
+NodeName NodeName::lookup(std::string_view text) {
+    return fromId(NameTable::instance().find(text));
+}
+
+NameTableStats nameTableStats() {
+    return NameTable::instance().stats();
+}
+
+}  // namespace storage
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace storage {
+
+namespace detail {
+
+struct NameEntry {
+    const char* data;
+    uint32_t size;
+};
+
+constexpr uint32_t NAME_PAGE_BITS = 16;
+constexpr uint32_t NAME_PAGE_SIZE = 1u << NAME_PAGE_BITS;
+// The name table's entries by id, NAME_PAGE_SIZE to a page. A page is
+// published once and never moves.
+inline constinit std::atomic<const NameEntry*> namePages[size_t(1) << (32 - NAME_PAGE_BITS)] = {};
+
+}  // namespace detail
+
+// A file or folder name, held as a 32-bit id into one table of every name
+// the process has used. Trees repeat names all the time (README, src,
+// part-00001.log), and each distinct one is stored once however many nodes
+// carry it. Text is looked up without locking, so names read as cheaply as
+// strings; making one from text takes the table's lock. Names are never
+// removed from the table.
+class NodeName {
+public:
+    NodeName() = default;  // ""
+    explicit NodeName(std::string_view text);
+
+    NodeName& operator=(std::string_view text) { return *this = NodeName(text); }
+    // The name text already has, without adding it; the empty name if
+    // text was never used, which no file or folder carries
+    static NodeName lookup(std::string_view text);
+
+    std::string_view view() const {
+        if (id == 0) return {};
+        const detail::NameEntry* page = detail::namePages[id >> detail::NAME_PAGE_BITS].load(std::memory_order_acquire);
+        const detail::NameEntry& entry = page[id & (detail::NAME_PAGE_SIZE - 1)];
+        return {entry.data, entry.size};
+    }
+    std::string str() const { return std::string(view()); }
+    operator std::string_view() const { return view(); }
+    bool empty() const { return id == 0; }
+
+    friend bool operator==(NodeName a, NodeName b) { return a.id == b.id; }
+    friend bool operator==(NodeName a, std::string_view b) { return a.view() == b; }
+    // Orders by text, not by id
+    friend bool operator<(NodeName a, NodeName b) { return a.view() < b.view(); }
+
+private:
+    friend class NameTable;
+    static NodeName fromId(uint32_t id) {
+        NodeName name;
+        name.id = id;
+        return name;
+    }
+
+    uint32_t id = 0;
+};
+
+inline std::string operator+(const std::string& a, NodeName b) { return std::string(a).append(b.view()); }
+inline std::string operator+(const char* a, NodeName b) { return std::string(a).append(b.view()); }
+inline std::string operator+(NodeName a, const std::string& b) { return a.str() + b; }
+inline std::string operator+(NodeName a, const char* b) { return a.str() + b; }
+inline std::ostream& operator<<(std::ostream& out, NodeName name) { return out << name.view(); }
+
+// Distinct names held and the bytes the table takes for them
+struct NameTableStats {
+    uint64_t names = 0;
+    uint64_t bytes = 0;
+};
+NameTableStats nameTableStats();
+
+}  // namespace storage
@@ -0,0 +1,41 @@
+#include "storage/NodePool.h"
+#include <algorithm>
+#include <new>
+
+namespace storage {
+
+NodePool::NodePool(size_t slotSize, size_t alignment)
+    : slotSize((std::max(slotSize, sizeof(FreeSlot)) + alignment - 1) / alignment * alignment) {}
+
+void* NodePool::allocate() {
+    std::lock_guard<std::mutex> guard(mutex);
+    ++inUse;
+    if (freeList) {
+        FreeSlot* slot = freeList;
+        freeList = slot->next;
+        return slot;
+    }
+    if (next == end) {
+        // left uninitialized: a slab takes host memory as nodes fill it
+        slabs.emplace_back(new char[SLAB_SIZE / slotSize * slotSize]);
+        next = slabs.back().get();
+        end = next + SLAB_SIZE / slotSize * slotSize;
+    }
+    void* slot = next;
+    next += slotSize;
+    return slot;
+}
+
+void NodePool::release(void* slot) {
+    if (!slot) return;
+    std::lock_guard<std::mutex> guard(mutex);
+    --inUse;
+    freeList = new (slot) FreeSlot{freeList};
+}
+
+NodePool::Stats NodePool::stats() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return {inUse, slabs.size() * (SLAB_SIZE / slotSize * slotSize)};
+}
+
+}  // namespace storage
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace storage {
+
+// Fixed-size slots for tree nodes, carved out of 256KB slabs. Nodes made
+// one after another sit next to each other, with no allocator header
+// between them, and a freed slot goes on a list for the next node. Slabs
+// are kept for reuse rather than handed back. Safe to use from any thread.
+class NodePool {
+public:
+    NodePool(size_t slotSize, size_t alignment);
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    void* allocate();
+    void release(void* slot);
+
+    // Nodes in use and the bytes the slabs take
+    struct Stats {
+        uint64_t nodes = 0;
+        uint64_t slabBytes = 0;
+    };
+    Stats stats();
+
+private:
+    static constexpr size_t SLAB_SIZE = 256 * 1024;
+
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    std::mutex mutex;
+    const size_t slotSize;
+    FreeSlot* freeList = nullptr;
+    char* next = nullptr;
+    char* end = nullptr;
+    uint64_t inUse = 0;
+    std::vector<std::unique_ptr<char[]>> slabs;
+};
+
+// The process's pool for nodes of type T, never destroyed: trees in static
+// objects may still be freeing nodes while the process exits
+template <typename T>
+NodePool& nodePool() {
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "slabs are only aligned like operator new");
+    static NodePool* pool = new NodePool(sizeof(T), alignof(T));
+    return *pool;
+}
+
+}  // namespace storage
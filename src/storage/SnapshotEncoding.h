@@ -0,0 +1,156 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "storage/FileContent.h"
+
+// Little-endian integer and timestamp encoding and the blob section shared
+// by the binary snapshot and its delta segments. Internal to the storage
+// library.
+
+namespace storage::snapshot {
+
+// Delta segments for "<name>.bin" are appended to "<name>.bin.delta"
+inline constexpr std::string_view DELTA_SUFFIX = ".delta";
+
+// Fresh id for every full binary save
+inline uint32_t newSnapshotId() {
+    static std::mt19937 generator{std::random_device{}()};
+    return static_cast<uint32_t>(generator());
+}
+
+inline void put32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+inline void put64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+// Seven bits per byte, low bits first; the top bit marks that more follow
+inline void putVar(std::string& out, uint64_t value) {
+    for (; value >= 0x80; value >>= 7) out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    out.push_back(static_cast<char>(value));
+}
+
+inline void putString(std::string& out, std::string_view value) {
+    put32(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+inline uint32_t get32(const char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    return value;
+}
+
+inline uint64_t get64(const char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    return value;
+}
+
+// Timestamps are stored as nanoseconds since the epoch
+inline uint64_t toNanos(std::chrono::system_clock::time_point t) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count());
+}
+
+inline std::chrono::system_clock::time_point fromNanos(uint64_t nanos) {
+    return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::nanoseconds(static_cast<int64_t>(nanos))));
+}
+
+// Bounds-checked sequential reads over a mapped buffer; any read past the
+// end clears ok() and returns zeroes from then on
+class Reader {
+public:
+    Reader(const char* data, uint64_t size) : data(data), size(size) {}
+
+    bool ok() const { return good; }
+    uint64_t position() const { return pos; }
+    uint64_t remaining() const { return size - pos; }
+
+    uint8_t u8() { return take(1) ? static_cast<uint8_t>(data[pos - 1]) : 0; }
+    uint32_t u32() { return take(4) ? get32(data + pos - 4) : 0; }
+    uint64_t u64() { return take(8) ? get64(data + pos - 8) : 0; }
+
+    uint64_t var() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = u8();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        good = false;
+        return 0;
+    }
+
+    const char* bytes(uint64_t count) { return take(count) ? data + pos - count : nullptr; }
+
+    std::string_view string() {
+        uint32_t length = u32();
+        const char* start = bytes(length);
+        return start ? std::string_view(start, length) : std::string_view();
+    }
+
+private:
+    bool take(uint64_t count) {
+        if (!good || count > size - pos) {
+            good = false;
+            return false;
+        }
+        pos += count;
+        return true;
+    }
+
+    const char* data;
+    uint64_t size;
+    uint64_t pos = 0;
+    bool good = true;
+};
+
+// Blob section of a snapshot or delta segment. Each distinct content goes
+// in once, found by identity and then by hash and bytes, and every file
+// record points at that one copy.
+class BlobTable {
+public:
+    // Offset of the content's bytes in the section, adding them if new
+    uint64_t add(const FileContent& content) {
+        auto known = offsets.find(&content);
+        if (known != offsets.end()) return known->second;
+
+        uint64_t hash = content.hash();
+        auto [it, end] = byHash.equal_range(hash);
+        for (; it != end; ++it) {
+            if (it->second.first->equals(content)) {
+                offsets.emplace(&content, it->second.second);
+                return it->second.second;
+            }
+        }
+        uint64_t offset = totalBytes;
+        offsets.emplace(&content, offset);
+        byHash.emplace(hash, std::make_pair(&content, offset));
+        stored.push_back(&content);
+        totalBytes += content.size();
+        return offset;
+    }
+
+    // What to write, in offset order
+    const std::vector<const FileContent*>& contents() const { return stored; }
+    uint64_t bytes() const { return totalBytes; }
+
+private:
+    std::unordered_map<const FileContent*, uint64_t> offsets;
+    std::unordered_multimap<uint64_t, std::pair<const FileContent*, uint64_t>> byHash;
+    std::vector<const FileContent*> stored;
+    uint64_t totalBytes = 0;
+};
+
+}  // namespace storage::snapshot
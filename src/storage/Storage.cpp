@@ -1,23 +1,52 @@
 #include "storage/Storage.h"
 #include "kernel/SysCallsAPI.h"
+#include "storage/NodePool.h"
 #include <iostream>
 
 namespace storage {
 
-StorageManager::StorageManager() {
+namespace {
+std::atomic<uint64_t> nextInstanceId{1};
+}  // namespace
+
+void* StorageManager::File::operator new(size_t) {
+    return nodePool<File>().allocate();
+}
+
+void StorageManager::File::operator delete(void* node, size_t) {
+    nodePool<File>().release(node);
+}
+
+void* StorageManager::Folder::operator new(size_t) {
+    return nodePool<Folder>().allocate();
+}
+
+void StorageManager::Folder::operator delete(void* node, size_t) {
+    nodePool<Folder>().release(node);
+}
+
+StorageManager::StorageManager() : instanceId(nextInstanceId.fetch_add(1, std::memory_order_relaxed)) {
     root = std::make_unique<Folder>();
     root->name = "/";
     root->parent = nullptr;
-    currentFolder = root.get();
+}
+
+StorageManager::~StorageManager() {
+    // the worker logs through this object and the copy frees through its allocator
+    finishBackgroundSave();
 }
 
 StorageManager::StorageResponse StorageManager::reset() {
+    TreeLock lock(*this, TreeLock::Exclusive);
     try {
+        finishBackgroundSave();
         recursiveDelete(*root);
         root = std::make_unique<Folder>();
         root->name = "/";
         root->parent = nullptr;
-        currentFolder = root.get();
+        relocateWorkingDirs(nullptr, nullptr);
+        deltaBasePath.clear();
+        journalCheckpoint("");
         logInfo("Storage reset to empty state");
         return StorageResponse::OK;
     } catch (...) {
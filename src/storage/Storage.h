@@ -1,13 +1,25 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include <functional>
 #include <chrono>
 #include <filesystem>
+#include <span>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
 #include "json.hpp"
 #include "common/LoggingMixin.h"
+#include "storage/FileContent.h"
+#include "storage/Journal.h"
+#include "storage/NodeName.h"
+#include "storage/TextIndex.h"
 
 namespace sys { struct SysApi; }
 
@@ -22,52 +34,251 @@ public:
         NotFound,
         AtRoot,
         InvalidArgument,
-        Error
+        Error,
+        QuotaExceeded
     };
 
     // STRUCTURES
+    // rw-r--r--: what new files get
+    static constexpr uint16_t DEFAULT_FILE_MODE = 0644;
+    static constexpr uint16_t MAX_FILE_MODE = 07777;
+
+    // Files and folders are laid out small, since trees hold millions of
+    // them: names are ids into the name table, flags fill the space beside
+    // them, and the nodes come from one pool per type (see NodePool).
     struct File {
-        std::string name;
-        void* memoryToken = nullptr;
-        size_t contentSize = 0;
+        NodeName name;
+        // permission bits, kept and reported but not enforced
+        uint16_t mode = DEFAULT_FILE_MODE;
+        // changed since the tracked binary snapshot was saved or loaded
+        bool dirty = true;
+        // who created the file; 0 for both is the kernel
+        uint32_t ownerUid = 0;
+        int32_t ownerPid = 0;
+        // Taken from one counter for the whole process whenever the file is
+        // made or its bytes, times or metadata change, so a file showing the
+        // version it had earlier has not changed since. Not saved: a load
+        // gives every file a new one.
+        uint64_t version = nextFileVersion();
+        // shared with open read views; writers copy it first while it is pinned
+        std::shared_ptr<FileContent> content;
         std::chrono::system_clock::time_point createdAt;
         std::chrono::system_clock::time_point modifiedAt;
+
+        static void* operator new(size_t size);
+        static void operator delete(void* node, size_t size);
+    };
+
+    // Totals for a folder and everything below it
+    struct DirUsage {
+        uint64_t folders = 0;
+        uint64_t files = 0;
+        uint64_t bytes = 0;
+    };
+
+    // Limits on a folder's subtree, 0 for none. inodes counts the files and
+    // folders below the folder, not the folder itself.
+    struct DirQuota {
+        uint64_t bytes = 0;
+        uint64_t inodes = 0;
     };
 
     struct Folder {
-        std::string name;
+        NodeName name;
+        // dirty: own timestamps, listing or a file changed; subtreeDirty:
+        // this folder or something below it is dirty. Ancestors of a
+        // subtreeDirty folder are always subtreeDirty too.
+        bool dirty = true;
+        bool subtreeDirty = true;
         Folder* parent = nullptr;
         std::vector<std::unique_ptr<File>> files;
         std::vector<std::unique_ptr<Folder>> subfolders;
         std::chrono::system_clock::time_point createdAt;
         std::chrono::system_clock::time_point modifiedAt;
+        // This folder (counted in folders) and everything below it, kept
+        // current by every operation that adds, removes, moves or resizes
+        DirUsage usage{1, 0, 0};
+        DirQuota quota;
+
+        static void* operator new(size_t size);
+        static void operator delete(void* node, size_t size);
+    };
+
+    // A folder entry as listDirEntries returns it: plain values, nothing
+    // formatted. name points into the tree and is only valid until the
+    // folder changes.
+    struct DirEntry {
+        std::string_view name;
+        bool isFolder = false;
+        uint64_t size = 0;   // bytes; a folder's is everything below it
+        uint64_t files = 0;  // files below a folder; 0 for files
+        std::chrono::system_clock::time_point createdAt;
+        std::chrono::system_clock::time_point modifiedAt;
+    };
+
+    // A file's inode-style record; filling it never touches the content
+    struct FileStat {
+        size_t size = 0;
+        std::chrono::system_clock::time_point createdAt;
+        std::chrono::system_clock::time_point modifiedAt;
+        uint16_t mode = 0;
+        uint32_t links = 0;  // always 1, the tree has no hard links
+        uint32_t ownerUid = 0;
+        int32_t ownerPid = 0;
+        uint64_t version = 0;
     };
 
+    // What the last full snapshot save or load moved: storedBytes is the
+    // file's size, rawBytes the snapshot's before compression
+    struct SnapshotStats {
+        uint64_t rawBytes = 0;
+        uint64_t storedBytes = 0;
+        std::chrono::nanoseconds elapsed{0};
+        bool compressed = false;
+    };
+
+    // find: every test that is set must hold. Size bounds only apply to
+    // files, so setting one leaves folders out.
+    struct FindQuery {
+        enum class Type { Any, File, Folder };
+        std::string nameGlob;  // '*' and '?' wildcards; empty matches any name
+        Type type = Type::Any;
+        uint64_t minSize = 0;
+        uint64_t maxSize = UINT64_MAX;
+        std::chrono::system_clock::time_point modifiedAfter = std::chrono::system_clock::time_point::min();
+        std::chrono::system_clock::time_point modifiedBefore = std::chrono::system_clock::time_point::max();
+    };
+
+    // path is absolute and only valid during the callback
+    struct FoundEntry {
+        std::string_view path;
+        bool isFolder = false;
+        uint64_t size = 0;
+        std::chrono::system_clock::time_point modifiedAt;
+    };
+
+    // grep: a literal pattern is found with a SIMD scan straight over the
+    // stored bytes, a regex (ECMAScript) is run line by line. ignoreCase
+    // turns a literal into a case-insensitive regex.
+    struct GrepQuery {
+        std::string pattern;
+        bool regex = false;
+        bool ignoreCase = false;
+        std::string nameGlob;  // only files whose name matches
+    };
+
+    // path and line are only valid during the callback; lines count from 1
+    // and exclude their newline
+    struct GrepMatch {
+        std::string_view path;
+        uint64_t lineNumber = 0;
+        std::string_view line;
+    };
+
+    // Search callbacks return false to stop the search
+    using FindCallback = std::function<bool(const FoundEntry&)>;
+    using GrepCallback = std::function<bool(const GrepMatch&)>;
+
+    // A file holding every searched term; offsets are where they start,
+    // sorted. Both are only valid during the callback.
+    struct IndexHit {
+        std::string_view path;
+        std::span<const uint64_t> offsets;
+    };
+    using IndexCallback = std::function<bool(const IndexHit&)>;
+
+    struct IndexStats {
+        bool enabled = false;
+        uint64_t files = 0;
+        uint64_t terms = 0;
+        uint64_t postings = 0;  // term occurrences
+    };
+
+    // What importTree brought in; skipped counts host entries left out
+    // (links, devices, unreadable entries and names the tree cannot hold)
+    struct ImportStats {
+        uint64_t folders = 0;
+        uint64_t files = 0;
+        uint64_t bytes = 0;
+        uint64_t skipped = 0;
+        std::chrono::nanoseconds elapsed{0};
+    };
+
+    // What exportTree wrote out
+    struct ExportStats {
+        uint64_t folders = 0;
+        uint64_t files = 0;
+        uint64_t bytes = 0;
+        std::chrono::nanoseconds elapsed{0};
+    };
+
+    // files/logicalBytes count every file, contents/storedBytes each
+    // distinct content once; the difference is what sharing saves
+    struct DedupStats {
+        uint64_t files = 0;
+        uint64_t logicalBytes = 0;
+        uint64_t contents = 0;
+        uint64_t storedBytes = 0;
+    };
+
+    // name points into the path passed to parsePath and is only valid while it is
+    // key is name's id for comparing against nodes: the empty name, which
+    // no node has, when name was never used
     struct PathInfo {
         Folder* folder;
-        std::string name;
+        std::string_view name;
+        NodeName key;
     };
 
 public:
     // CONSTRUCTOR
     StorageManager();
+    ~StorageManager();
     
     // Set system API (must be called before using storage)
-    void setSysApi(sys::SysApi* sys) { sysApi = sys; }
+    // Pass nullptr before the SysApi goes away; contents then stop returning memory to it
+    void setSysApi(sys::SysApi* sys) {
+        sysApi = sys;
+        contentAllocator.sysApi = sys;
+    }
+
+    // CONCURRENCY
+    // Any number of threads may use one StorageManager. Every public call
+    // holds the tree for its whole duration: calls that only look share it
+    // and run side by side, calls that change anything hold it alone. A
+    // call made from inside another on the same thread runs under the hold
+    // already taken, so search callbacks must not change the tree. The
+    // working directory is kept per thread: each starts out at "/", and
+    // changeDir only moves the calling thread's.
 
     // UTILITIES
     static std::string toString(StorageResponse status);
-    static bool isNameInvalid(const std::string& s);
+    static bool isNameInvalid(std::string_view s);
 
     // FILE OPERATIONS
     StorageResponse fileExists(const std::string& name) const;
     StorageResponse createFile(const std::string& name);
     StorageResponse touchFile(const std::string& name);
     StorageResponse deleteFile(const std::string& name);
-    StorageResponse deleteFile(Folder& folder, const std::string& name);
+    StorageResponse deleteFile(Folder& folder, std::string_view name);
     StorageResponse writeFile(const std::string& name, const std::string& content);
     StorageResponse readFile(const std::string& name, std::string& outContent) const;
     StorageResponse editFile(const std::string& name, const std::string& newContent);
+    StorageResponse appendFile(const std::string& name, const std::string& content);
+    // Ranged access: reading past the end yields fewer (or zero) bytes,
+    // writing past the end zero-fills the gap
+    StorageResponse readFileRange(const std::string& name, size_t offset, size_t length, std::string& outContent) const;
+    StorageResponse writeFileAt(const std::string& name, size_t offset, const std::string& data);
+    StorageResponse statFile(const std::string& name, FileStat& outStat) const;
+    // mode is permission bits as chmod takes them, MAX_FILE_MODE at most
+    StorageResponse setFileMode(const std::string& name, uint16_t mode);
+    // Files the calling thread creates from now on belong to uid and pid
+    // (0 and 0 for the kernel); copies keep their source's owner
+    void setCaller(uint32_t uid, int32_t pid);
+    // Zero-copy read access: outContent keeps the bytes alive and unchanged
+    // until released, later writes to the file go to a fresh copy.
+    // Must be released before the StorageManager is destroyed.
+    StorageResponse pinFile(const std::string& name, std::shared_ptr<const FileContent>& outContent) const;
     StorageResponse copyFile(const std::string& srcName, const std::string& destName);
     StorageResponse moveFile(const std::string& oldName, const std::string& newName);
 
@@ -75,33 +286,347 @@ public:
     StorageResponse makeDir(const std::string& name);
     StorageResponse removeDir(const std::string& name);
     StorageResponse changeDir(const std::string& path);
+    // Display lines, "[D] name | created: ... | modified: ..." (files add
+    // their size); listDirEntries gives the same entries unformatted,
+    // folders first, each group in creation order
     StorageResponse listDir(const std::string& path, std::vector<std::string>& outEntries) const;
+    StorageResponse listDirEntries(const std::string& path, std::vector<DirEntry>& outEntries) const;
     std::string getWorkingDir() const;
     StorageResponse copyDir(const std::string& srcName, const std::string& destName);
     StorageResponse moveDir(const std::string& oldName, const std::string& newName);
     static bool isDescendantOrSame(const Folder* ancestor, const Folder* descendant);
+    // Whole-subtree operations (removeDir, copyDir, moveDir) walk the
+    // subtree once; removal returns memory through bulk frees. dirUsage
+    // reads the folder's running totals and walks nothing.
+    StorageResponse dirUsage(const std::string& path, DirUsage& outUsage) const;
+
+    // QUOTAS
+    // Checked against the running totals of the target folder and its
+    // ancestors before anything is created, written, copied or moved below
+    // them: an operation that would take one past its quota fails with
+    // QuotaExceeded and changes nothing. Costs the folder's depth. Setting
+    // a quota below current use only blocks further growth. Snapshots and
+    // the journal keep quotas.
+    StorageResponse setQuota(const std::string& path, const DirQuota& quota);
+    StorageResponse getQuota(const std::string& path, DirQuota& outQuota) const;
+
+    // SEARCH
+    // Both walk the tree below path (or just path, when it is a file) once,
+    // in preorder, and hand each match over as soon as it is found instead
+    // of collecting them. Lazily loaded contents are searched in place.
+    StorageResponse find(const std::string& path, const FindQuery& query, const FindCallback& onMatch) const;
+    StorageResponse grep(const std::string& path, const GrepQuery& query, const GrepCallback& onMatch) const;
+    static bool globMatch(std::string_view pattern, std::string_view name);
+
+    // FULL-TEXT INDEX
+    // Off by default. While on, every change to a file's content updates an
+    // inverted index of its terms (see TextIndex.h): whole-file writes and
+    // ranged writes index the file again, appends only the appended bytes,
+    // copies take their source's terms. Turning it on indexes the whole
+    // tree. Binary snapshots carry the index, so loading one does not read
+    // the contents again unless delta segments changed them.
+    void setIndexing(bool enabled);
+    bool isIndexing() const { return textIndex != nullptr; }
+    // Files holding every term of query, by path; InvalidArgument when
+    // query has no terms, Error while indexing is off
+    StorageResponse searchIndex(const std::string& query, const IndexCallback& onHit) const;
+    IndexStats indexStats() const;
 
     // DISK IO OPERATIONS
-    StorageResponse saveToDisk(const std::string& fileName) const;
-    StorageResponse loadFromDisk(const std::string& fileName);
+    // Snapshots live in data/. Names ending in ".bin" use the binary snapshot
+    // format, anything else is JSON (".json" is added when missing). Loading
+    // a bare name falls back to "<name>.bin" when there is no JSON snapshot.
+    // A lazy load of a binary snapshot maps the file and builds only the tree;
+    // each file's bytes are copied into memory the first time it is used.
+    // An incremental save appends only what changed since the binary
+    // snapshot was last saved or loaded to "<name>.bin.delta"; it falls back
+    // to a full save when this tree was not saved to or loaded from <name>.
+    // Loading a binary snapshot replays its deltas, compacting folds them
+    // into the base file.
+    // A compressed save writes either format as a block-compressed frame
+    // (see Compression.h), which loading recognizes on its own. Delta
+    // segments are never compressed.
+    StorageResponse saveToDisk(const std::string& fileName, bool incremental = false, bool compress = false);
+    StorageResponse loadFromDisk(const std::string& fileName, bool lazy = false);
+    StorageResponse compactSnapshot(const std::string& fileName);
+    // Saves in full on a worker thread: the tree is copied as it is now
+    // (sharing file contents, which later writes copy before changing) and
+    // the copy is written while this tree keeps changing. Returns once the
+    // worker is started; progress and the result go to the log. Another
+    // save, a load, reset or compaction first waits for it to finish.
+    StorageResponse saveToDiskAsync(const std::string& fileName, bool compress = false);
+    // Waits for a background save, if any, and releases its copy
+    void finishBackgroundSave();
+    // Background saves count once they have been waited for
+    const SnapshotStats& lastSnapshotStats() const { return snapshotStats; }
     StorageResponse readFileFromHost(const std::string& hostFileName, std::string& outContent);
+    // Copies the host directory hostDir and everything below it into a new
+    // folder at path, byte for byte (no newline is added) and keeping the
+    // host modification times. The subtree is built apart from the tree:
+    // its memory is taken up front, the shared worker pool reads the files
+    // straight into it, and the tree is only held to attach the finished
+    // subtree. AlreadyExists if path names anything, NotFound if hostDir is
+    // not a directory. Relative host names are looked up like
+    // readFileFromHost's. Journaled as the folders and writes it amounts to.
+    StorageResponse importTree(const std::string& hostDir, const std::string& path, ImportStats& outStats);
+    // Writes the folder at path and everything below it out to the host
+    // directory hostDir, creating it as needed and overwriting files of the
+    // same name, with the tree's modification times. The contents are
+    // pinned and the tree let go before anything is written, so the export
+    // is the subtree as it stood; the shared worker pool then writes the
+    // files straight from their memory. NotFound if path is not a folder,
+    // Error if any host file or directory could not be written.
+    StorageResponse exportTree(const std::string& path, const std::string& hostDir, ExportStats& outStats);
     StorageResponse listDataFiles(std::vector<std::string>& outFiles) const;
 
     // RESET
     StorageResponse reset();
 
+    // DEDUPLICATION
+    // With dedup on (the default) identical file contents share one copy:
+    // copies share their source's content, and whole-file writes and eager
+    // loads reuse a content already holding the same bytes. Writing to a
+    // shared content first gives that file its own copy. Binary snapshots
+    // store each distinct content once either way.
+    void setDedup(bool enabled);
+    bool isDedupEnabled() const { return dedupEnabled; }
+    DedupStats dedupStats() const;
+
+    // WRITE-AHEAD JOURNAL
+    // Every successful mutation is appended to the journal at path, with
+    // paths made absolute. Saving, loading or resetting restarts it on top
+    // of the resulting snapshot. Opening an existing journal first rebuilds
+    // the tree from it: its snapshot is loaded and the records replayed.
+    // A new journal on a non-empty tree starts from a checkpoint snapshot.
+    StorageResponse openJournal(const std::string& path, const JournalOptions& options = {});
+    void closeJournal();
+    bool isJournaling() const { return journal != nullptr; }
+
 private:
     // INTERNAL HELPERS
-    PathInfo parsePath(const std::string& path) const;
-    int findFolderIndex(const std::string& name) const;
+    PathInfo parsePath(std::string_view path) const;
+    Folder* resolveDirectory(std::string_view dirPath, bool isAbsolute) const;
+    Folder* walkPath(Folder* start, std::string_view dirPath, bool strict, StorageResponse& outStatus) const;
+    static Folder* findSubfolder(const Folder& folder, std::string_view name);
+    static Folder* findSubfolder(const Folder& folder, NodeName name);
+    // The folder path names, "/", "." and ".." included; null if none
+    Folder* findFolder(const std::string& path) const;
+    const std::string& workingDirKey() const;
+    void invalidateDentryCache();
+    // The calling thread's working directory
+    Folder* workingFolder() const;
+    // Moves every thread whose working directory is inside gone to
+    // replacement; with gone null, moves all of them back to root
+    void relocateWorkingDirs(const Folder* gone, Folder* replacement);
+    // Finds path's file for a read and runs read on it. A file still mapped
+    // from a lazy snapshot is copied in first, which takes the tree
+    // exclusively: the lookup is redone under that hold.
+    StorageResponse readResident(const std::string& path, const std::function<void(const File&)>& read) const;
     StorageResponse recursiveDelete(Folder& folder);
-    void recursiveCopyDir(const Folder& src, Folder& destParent);
-    StorageResponse allocateFileMemory(File& file, const void* data, size_t size);
+    // Copies src below destParent as name, filling contents on the shared
+    // worker pool and attaching the copy once it is complete. The whole
+    // copy carries one timestamp, taken when it started.
+    StorageResponse copySubtree(const Folder& src, Folder& destParent, std::string_view name);
+    struct CopyPlan;
+    std::unique_ptr<Folder> buildCopy(const Folder& src, Folder* parent, CopyPlan& plan);
+    struct ImportPlan;
+    // Fills folder with what host directory dir holds, files sized but not read
+    bool buildImport(const std::filesystem::path& dir, Folder& folder, ImportPlan& plan);
+    // Relative names are looked up in the current directory, then the
+    // container data path, then the local data folder
+    static std::string findHostPath(const std::string& name, bool directory);
+    // Calls fn(folder, file, path) for path's entry and, for a folder, every
+    // entry below it in preorder (file is null for folders) until fn returns false
+    StorageResponse walkEntries(const std::string& path,
+                                const std::function<bool(const Folder&, const File*, std::string_view)>& fn) const;
+    // Owned by the calling thread's caller (see setCaller)
+    std::unique_ptr<File> makeFile(NodeName name,
+                                   std::chrono::system_clock::time_point stamp = std::chrono::system_clock::now());
+    static uint64_t nextFileVersion();
+    // Mode and owner, as copies keep them
+    static void copyFileMeta(const File& src, File& dest);
+    // Applies change to path's file and stamps it with a new version
+    StorageResponse updateFileMeta(const std::string& path, const std::function<void(File&)>& change);
+    void journalFileMeta(const std::string& path, const File& file);
+    StorageResponse copyFileContent(const File& src, File& dest);
+    FileContent* writableContent(File& file, bool keepBytes);
+    StorageResponse saveJsonSnapshot(const std::string& path, bool compress);
+    StorageResponse loadJsonSnapshot(const std::string& path);
+    StorageResponse saveBinarySnapshot(const std::string& path, uint32_t snapshotId, bool compress,
+                                       const std::string& indexSection);
+    StorageResponse loadBinarySnapshot(const std::string& path, bool lazy);
+    StorageResponse saveDeltaSegment(const std::string& path);
+    StorageResponse applyDeltaSegments(Folder& base, const std::string& deltaPath, uint32_t snapshotId, bool lazy);
+    void trackDeltaBase(const std::string& path, uint32_t snapshotId, bool clearFlags = true);
+    bool isDeltaBase(const std::string& path) const;
+    enum class JournalOp : uint8_t {
+        CreateFile, TouchFile, DeleteFile, WriteFile, EditFile, AppendFile, WriteFileAt,
+        CopyFile, MoveFile, MakeDir, RemoveDir, CopyDir, MoveDir, SetQuota, SetFileMeta
+    };
+    std::string absolutePath(const std::string& path) const;
+    void journalOp(JournalOp op, const std::string& path, const std::string& arg = {}, uint64_t offset = 0);
+    void journalCheckpoint(const std::string& snapshotName);
+    StorageResponse replayJournal(const std::string& path, uint64_t& outValidBytes);
+    // Stamp a change and flag it for the next incremental save
+    static void markModified(Folder& folder);
+    static void markModified(Folder& folder, File& file);
+    static void markDirty(Folder& folder);
+    static void markSubtreeDirty(Folder& folder);
+    static void clearDirty(Folder& folder);
+    static void ensureResident(const File& file);
+    // Adds the deltas to folder's totals and those of every folder above it
+    static void adjustUsage(Folder& folder, int64_t folders, int64_t files, int64_t bytes);
+    static void addUsage(Folder& folder, const DirUsage& usage);
+    static void subtractUsage(Folder& folder, const DirUsage& usage);
+    // Accounts for file's content having been oldSize bytes
+    static void contentResized(Folder& folder, const File& file, uint64_t oldSize);
+    // Recomputes every total below top from scratch, after a load
+    static void recountUsage(Folder& top);
+    // Whether inodes more entries and bytes more bytes fit below folder.
+    // For a move out of from, folders holding both are left out: their
+    // totals do not change.
+    static bool withinQuota(const Folder& folder, uint64_t inodes, uint64_t bytes, const Folder* from = nullptr);
+    StorageResponse quotaExceeded(const std::string& path);
+    void recordSnapshotStats(const std::string& action, const std::string& path, uint64_t rawBytes,
+                             uint64_t storedBytes, bool compressed, std::chrono::steady_clock::time_point started);
+    void reapBackgroundSave();
+    // Live content registered under hash for which matches() holds, or null
+    std::shared_ptr<FileContent> findDuplicate(uint64_t hash,
+                                               const std::function<bool(const FileContent&)>& matches);
+    void registerContent(uint64_t hash, const std::shared_ptr<FileContent>& content);
+    // With dedup on, points file at a content already holding exactly the
+    // concatenated pieces and returns true. Otherwise returns false and sets
+    // outHash for registering the content once the file holds the pieces.
+    bool shareDuplicate(File& file, std::initializer_list<std::string_view> pieces, uint64_t& outHash);
+    // Swaps a just loaded content for an identical one, or registers it
+    void dedupLoaded(std::shared_ptr<FileContent>& content);
+    // Content for a snapshot blob; files pointing at the same blob share it.
+    // Null when an eager load runs out of memory.
+    using BlobCache = std::unordered_map<const char*, std::shared_ptr<FileContent>>;
+    std::shared_ptr<FileContent> loadBlob(const std::shared_ptr<const void>& pin, const char* bytes, uint64_t size,
+                                          bool lazy, BlobCache& loaded);
+
+    // Keep the index in step with the tree; all do nothing while it is off
+    struct IndexedFile {
+        const File* file = nullptr;
+        const Folder* folder = nullptr;
+    };
+    void indexFile(Folder& folder, const File& file);
+    void indexAppended(Folder& folder, const File& file, uint64_t oldSize);
+    void indexCopy(const File& src, Folder& folder, const File& copy);
+    void indexCopiedSubtree(const Folder& src, Folder& copy);
+    void indexMoved(const File& file, Folder& folder);
+    void unindexFile(const File& file);
+    void rebuildIndex();
+    // Snapshot section for the index, files keyed by their position in the
+    // snapshot's preorder walk; empty while indexing is off
+    std::string encodeIndex() const;
+    // Takes over a section encodeIndex() wrote for files (in snapshot order)
+    bool decodeIndex(const char* data, uint64_t size, std::vector<IndexedFile> files);
+    TextIndex::DocId indexIdFor(Folder& folder, const File& file);
 
     // DATA MEMBERS
     std::unique_ptr<Folder> root;
-    Folder* currentFolder;
     sys::SysApi* sysApi = nullptr;
+    ContentAllocator contentAllocator;
+
+    // Binary snapshot the dirty flags are relative to (normalized absolute
+    // path, empty when there is none) and its snapshot id
+    std::string deltaBasePath;
+    uint32_t deltaBaseId = 0;
+
+    std::unique_ptr<Journal> journal;
+
+    // Dedup store: content hash -> contents registered with it. Entries do
+    // not keep contents alive, and one may have changed since it was added,
+    // so candidates are always compared byte for byte. Expired entries are
+    // swept out whenever the store doubles.
+    static constexpr size_t DEDUP_MIN_SWEEP = 1024;
+    bool dedupEnabled = true;
+    std::unordered_multimap<uint64_t, std::weak_ptr<FileContent>> dedupIndex;
+    size_t dedupSweepAt = DEDUP_MIN_SWEEP;
+
+    // Full-text index, null while indexing is off. indexIds numbers the
+    // indexed files; indexedFiles maps the numbers back to each file and the
+    // folder holding it (file is null for a number free for reuse).
+    std::unique_ptr<TextIndex> textIndex;
+    std::unordered_map<const File*, TextIndex::DocId> indexIds;
+    std::vector<IndexedFile> indexedFiles;
+    std::vector<TextIndex::DocId> freeIndexIds;
+
+    // Save running on a worker thread (see saveToDiskAsync). The worker only
+    // reads the copied tree; joining, tracking the result and freeing the
+    // copy happen on the thread that uses this StorageManager.
+    struct BackgroundSave {
+        std::thread worker;
+        std::unique_ptr<StorageManager> snapshot;  // holds the copied tree
+        std::string path;
+        bool binary = false;
+        bool compress = false;
+        uint32_t snapshotId = 0;
+        std::string indexSection;
+        std::atomic<bool> done{false};
+        StorageResponse result = StorageResponse::Error;
+    };
+    std::unique_ptr<BackgroundSave> backgroundSave;
+    SnapshotStats snapshotStats;
+    // Called by the snapshot writers with the content bytes written so far
+    std::function<void(uint64_t)> saveProgress;
+
+    // Holds the tree for one public call (see CONCURRENCY). Shared holds
+    // nest on a thread, and anything nests inside an exclusive hold;
+    // asking for an exclusive hold inside a shared one is a bug.
+    class TreeLock {
+    public:
+        enum Mode { Shared, Exclusive };
+        TreeLock(const StorageManager& owner, Mode mode);
+        ~TreeLock();
+        TreeLock(const TreeLock&) = delete;
+        TreeLock& operator=(const TreeLock&) = delete;
+
+        // Whether the calling thread has the tree to itself
+        bool exclusive() const;
+        // Whether this runs inside an outer hold, which it then leaves alone
+        bool nested() const { return !taken; }
+
+    private:
+        const StorageManager& owner;
+        Mode mode;
+        bool taken = false;
+    };
+
+    // What each thread keeps for itself. Only its own thread touches the
+    // caches; other threads change cwd only while holding the tree alone.
+    // Dentry cache: normalized absolute folder path ("" is root, "/a/b") ->
+    // Folder*. Only holds folders reached without "..", and is dropped when
+    // treeGeneration moves on, which happens whenever folders are removed,
+    // moved or the whole tree is replaced.
+    static constexpr size_t DENTRY_CACHE_CAPACITY = 4096;
+    struct ThreadView {
+        Folder* cwd = nullptr;  // null is root
+        int sharedDepth = 0;
+        uint64_t generation = 0;
+        std::unordered_map<std::string, Folder*> dentryCache;
+        std::string pathKeyBuffer;
+        std::string cwdKey;
+        bool cwdKeyValid = false;
+        // owner of the files this thread creates
+        uint32_t callerUid = 0;
+        int32_t callerPid = 0;
+    };
+    // The calling thread's view, created on first use. Views of threads
+    // that have exited stay until the StorageManager goes away.
+    ThreadView& threadView() const;
+
+    mutable std::shared_mutex treeMutex;
+    mutable std::atomic<std::thread::id> exclusiveOwner;
+    // New shared holds wait while this is set, so a stream of readers
+    // cannot keep a writer out (the library lock may prefer readers)
+    mutable std::atomic<int> writersWaiting{0};
+    uint64_t treeGeneration = 1;
+    const uint64_t instanceId;
+    mutable std::mutex viewsMutex;
+    mutable std::unordered_map<uint64_t, std::unique_ptr<ThreadView>> threadViews;
 
 protected:
     std::string getModuleName() const override { return "STORAGE"; }
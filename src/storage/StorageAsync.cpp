@@ -0,0 +1,153 @@
+#include "storage/Storage.h"
+#include "storage/SnapshotEncoding.h"
+
+namespace storage {
+
+using Response = StorageManager::StorageResponse;
+
+// A background save copies only the tree's skeleton (folders, files, names,
+// timestamps and metadata) on the calling thread. Contents are shared with the copy
+// rather than duplicated: a writer copies a content that someone else holds
+// before changing it, so the live tree can keep changing while the worker
+// streams the bytes the copy was taken with. The copy is dropped on the
+// calling thread, which is then the only one ever freeing simulated memory.
+
+namespace {
+
+std::unique_ptr<StorageManager::Folder> copySkeleton(const StorageManager::Folder& src,
+                                                     StorageManager::Folder* parent) {
+    auto copy = std::make_unique<StorageManager::Folder>();
+    copy->name = src.name;
+    copy->parent = parent;
+    copy->createdAt = src.createdAt;
+    copy->modifiedAt = src.modifiedAt;
+    copy->usage = src.usage;
+    copy->quota = src.quota;
+
+    copy->files.reserve(src.files.size());
+    for (const auto& file : src.files) {
+        auto fileCopy = std::make_unique<StorageManager::File>();
+        fileCopy->name = file->name;
+        fileCopy->content = file->content;
+        fileCopy->createdAt = file->createdAt;
+        fileCopy->modifiedAt = file->modifiedAt;
+        fileCopy->mode = file->mode;
+        fileCopy->ownerUid = file->ownerUid;
+        fileCopy->ownerPid = file->ownerPid;
+        fileCopy->version = file->version;
+        copy->files.push_back(std::move(fileCopy));
+    }
+
+    copy->subfolders.reserve(src.subfolders.size());
+    for (const auto& sub : src.subfolders) {
+        copy->subfolders.push_back(copySkeleton(*sub, copy.get()));
+    }
+    return copy;
+}
+
+}  // namespace
+
+Response StorageManager::saveToDiskAsync(const std::string& fileName, bool compress) {
+    TreeLock lock(*this, TreeLock::Exclusive);
+    try {
+        // one save at a time, so they land in the order they were asked for
+        finishBackgroundSave();
+
+        std::filesystem::create_directories("data");
+        auto save = std::make_unique<BackgroundSave>();
+        save->path = "data/" + fileName;
+        save->binary = fileName.ends_with(".bin");
+        if (!save->binary && save->path.find(".json") == std::string::npos) {
+            save->path += ".json";
+        }
+        save->compress = compress;
+        if (save->binary) {
+            save->snapshotId = snapshot::newSnapshotId();
+            // the copy is not indexed; its file records come out in the
+            // same order as this tree's, so the section still fits
+            save->indexSection = encodeIndex();
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        const DirUsage stats = root->usage;
+        save->snapshot = std::make_unique<StorageManager>();
+        save->snapshot->root = copySkeleton(*root, nullptr);
+        save->snapshot->setLogCallback([this](const std::string& level, const std::string&, const std::string& message) {
+            log(level, message);
+        });
+        // log each quarter of the contents as it goes out
+        int firstQuarter = stats.bytes > 0 ? 1 : 4;
+        save->snapshot->saveProgress = [this, path = save->path, total = stats.bytes,
+                                        quarter = firstQuarter](uint64_t written) mutable {
+            for (; quarter < 4 && written * 4 >= total * quarter; ++quarter) {
+                logInfo("Background save of " + path + ": " + std::to_string(quarter * 25) + "% written");
+            }
+        };
+
+        // Journal records from here on are not in the copy; the worker keeps
+        // them when it restarts the journal on top of the new snapshot
+        Journal* saveJournal = journal.get();
+        uint64_t journalMark = journal ? journal->size() : 0;
+
+        if (save->binary) {
+            // the dirty flags now count from the copy; the copy becomes the
+            // tracked base once it is on disk
+            deltaBasePath.clear();
+            clearDirty(*root);
+        }
+
+        auto copyTime = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started);
+        logInfo("Saving " + save->path + " in the background: " + std::to_string(stats.folders) + " folders, " +
+                std::to_string(stats.files) + " files, " + std::to_string(stats.bytes) + " bytes (tree copied in " +
+                std::to_string(copyTime.count()) + " us)");
+
+        BackgroundSave* state = save.get();
+        state->worker = std::thread([this, state, fileName, saveJournal, journalMark, started] {
+            StorageManager& copy = *state->snapshot;
+            Response result = state->binary ? copy.saveBinarySnapshot(state->path, state->snapshotId, state->compress,
+                                                                        state->indexSection)
+                                            : copy.saveJsonSnapshot(state->path, state->compress);
+            if (result == Response::OK) {
+                if (saveJournal && !saveJournal->restart(fileName, journalMark)) {
+                    logError("Failed to restart journal " + saveJournal->path());
+                }
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - started);
+                logInfo("Background save of " + state->path + " finished in " + std::to_string(elapsed.count()) +
+                        " ms");
+            } else {
+                logError("Background save of " + state->path + " failed");
+            }
+            state->result = result;
+            state->done.store(true, std::memory_order_release);
+        });
+        backgroundSave = std::move(save);
+        return Response::OK;
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+void StorageManager::finishBackgroundSave() {
+    TreeLock lock(*this, TreeLock::Exclusive);
+    if (!backgroundSave) return;
+    backgroundSave->worker.join();
+    if (backgroundSave->result == Response::OK && backgroundSave->binary) {
+        // changes made while it ran are still flagged, so keep them
+        trackDeltaBase(backgroundSave->path, backgroundSave->snapshotId, false);
+    }
+    if (backgroundSave->result == Response::OK) {
+        snapshotStats = backgroundSave->snapshot->snapshotStats;
+    }
+    // the copy may hold the last reference to contents replaced meanwhile
+    backgroundSave.reset();
+}
+
+void StorageManager::reapBackgroundSave() {
+    if (backgroundSave && backgroundSave->done.load(std::memory_order_acquire)) {
+        finishBackgroundSave();
+    }
+}
+
+}  // namespace storage
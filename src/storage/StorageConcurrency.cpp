@@ -0,0 +1,123 @@
+#include "storage/Storage.h"
+#include <cassert>
+
+namespace storage {
+
+using Response = StorageManager::StorageResponse;
+
+namespace {
+
+std::atomic<uint64_t> nextThreadId{1};
+
+// Numbers threads for the views; unlike std::thread::id, never reused
+uint64_t currentThreadId() {
+    thread_local const uint64_t id = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+}  // namespace
+
+StorageManager::TreeLock::TreeLock(const StorageManager& owner, Mode mode) : owner(owner), mode(mode) {
+    if (exclusive()) return;
+    ThreadView& view = owner.threadView();
+    if (view.sharedDepth > 0) {
+        assert(mode == Shared && "exclusive hold asked for inside a shared one");
+        return;
+    }
+    if (mode == Shared) {
+        while (owner.writersWaiting.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+        owner.treeMutex.lock_shared();
+        view.sharedDepth = 1;
+    } else {
+        owner.writersWaiting.fetch_add(1, std::memory_order_acq_rel);
+        owner.treeMutex.lock();
+        owner.writersWaiting.fetch_sub(1, std::memory_order_acq_rel);
+        owner.exclusiveOwner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    }
+    taken = true;
+}
+
+StorageManager::TreeLock::~TreeLock() {
+    if (!taken) return;
+    if (mode == Shared) {
+        owner.threadView().sharedDepth = 0;
+        owner.treeMutex.unlock_shared();
+    } else {
+        owner.exclusiveOwner.store(std::thread::id(), std::memory_order_relaxed);
+        owner.treeMutex.unlock();
+    }
+}
+
+bool StorageManager::TreeLock::exclusive() const {
+    // only this thread ever stores its own id there
+    return owner.exclusiveOwner.load(std::memory_order_relaxed) == std::this_thread::get_id();
+}
+
+StorageManager::ThreadView& StorageManager::threadView() const {
+    // each thread remembers the view it used last
+    thread_local struct {
+        uint64_t instance = 0;
+        ThreadView* view = nullptr;
+    } last;
+    if (last.instance == instanceId) return *last.view;
+
+    std::lock_guard<std::mutex> guard(viewsMutex);
+    auto& view = threadViews[currentThreadId()];
+    if (!view) view = std::make_unique<ThreadView>();
+    last.instance = instanceId;
+    last.view = view.get();
+    return *view;
+}
+
+StorageManager::Folder* StorageManager::workingFolder() const {
+    Folder* cwd = threadView().cwd;
+    return cwd ? cwd : root.get();
+}
+
+void StorageManager::relocateWorkingDirs(const Folder* gone, Folder* replacement) {
+    // their cached working directory keys go stale
+    invalidateDentryCache();
+    std::lock_guard<std::mutex> guard(viewsMutex);
+    for (auto& [thread, view] : threadViews) {
+        if (!gone) {
+            view->cwd = nullptr;
+            continue;
+        }
+        for (const Folder* f = view->cwd; f; f = f->parent) {
+            if (f == gone) {
+                view->cwd = replacement;
+                break;
+            }
+        }
+    }
+}
+
+Response StorageManager::readResident(const std::string& path, const std::function<void(const File&)>& read) const {
+    if (path.empty() || isNameInvalid(path)) {
+        return Response::InvalidArgument;
+    }
+    for (TreeLock::Mode mode : {TreeLock::Shared, TreeLock::Exclusive}) {
+        TreeLock lock(*this, mode);
+        PathInfo info = parsePath(path);
+        if (!info.folder) return Response::NotFound;
+        if (isNameInvalid(info.name)) return Response::InvalidArgument;
+
+        bool upgrade = false;
+        for (const auto& file : info.folder->files) {
+            if (file->name != info.key) continue;
+            if (lock.exclusive()) {
+                ensureResident(*file);
+            } else if (!file->content->isResident() && file->content.use_count() == 1 && !lock.nested()) {
+                // copying in swaps the bytes out from under other readers
+                upgrade = true;
+                break;
+            }
+            read(*file);
+            return Response::OK;
+        }
+        if (!upgrade) break;
+    }
+    return Response::NotFound;
+}
+
+}  // namespace storage
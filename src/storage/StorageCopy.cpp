@@ -0,0 +1,122 @@
+#include "storage/Storage.h"
+#include "common/WorkerPool.h"
+#include <iomanip>
+#include <sstream>
+
+namespace storage {
+
+using Response = StorageManager::StorageResponse;
+
+// A directory copy runs in three steps. The calling thread builds the new
+// subtree's skeleton and takes all the simulated memory it needs, since
+// allocations go through the memory manager one at a time. With dedup on
+// the copies share their sources' contents and that is all. Otherwise
+// every extent to fill becomes a block copy, and the blocks are spread
+// over the shared worker pool. The subtree is attached to its parent only
+// after that, so nobody sees it half-filled.
+
+namespace {
+
+// Smaller copies fill their blocks on the calling thread
+constexpr uint64_t PARALLEL_COPY_MIN_BYTES = 1 << 20;
+
+struct BlockCopy {
+    const FileContent* src;
+    char* dest;
+    size_t offset;
+    size_t size;
+};
+
+}  // namespace
+
+struct StorageManager::CopyPlan {
+    std::chrono::system_clock::time_point stamp;
+    std::vector<BlockCopy> blocks;
+    uint64_t folders = 0;
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+};
+
+std::unique_ptr<StorageManager::Folder> StorageManager::buildCopy(const Folder& src, Folder* parent,
+                                                                  CopyPlan& plan) {
+    auto copy = std::make_unique<Folder>();
+    copy->name = src.name;
+    copy->parent = parent;
+    copy->createdAt = plan.stamp;
+    copy->modifiedAt = plan.stamp;
+    copy->files.reserve(src.files.size());
+    copy->subfolders.reserve(src.subfolders.size());
+    ++plan.folders;
+
+    for (const auto& file : src.files) {
+        auto fileCopy = makeFile(file->name, plan.stamp);
+        copyFileMeta(*file, *fileCopy);
+        if (dedupEnabled) {
+            fileCopy->content = file->content;
+        } else {
+            if (!fileCopy->content->allocateUninitialized(file->content->size())) {
+                logError("Out of memory for file: " + file->name);
+                return nullptr;
+            }
+            size_t offset = 0;
+            for (const auto& extent : fileCopy->content->getExtents()) {
+                plan.blocks.push_back({file->content.get(), static_cast<char*>(extent.memoryToken), offset,
+                                       extent.size});
+                offset += extent.size;
+            }
+        }
+        ++plan.files;
+        plan.bytes += file->content->size();
+        copy->files.push_back(std::move(fileCopy));
+    }
+
+    for (const auto& sub : src.subfolders) {
+        auto subCopy = buildCopy(*sub, copy.get(), plan);
+        if (!subCopy) return nullptr;
+        copy->subfolders.push_back(std::move(subCopy));
+    }
+    copy->usage = src.usage;
+    return copy;
+}
+
+Response StorageManager::copySubtree(const Folder& src, Folder& destParent, std::string_view name) {
+    try {
+        auto started = std::chrono::steady_clock::now();
+        CopyPlan plan;
+        plan.stamp = std::chrono::system_clock::now();
+
+        // a failed build drops the partial copy, freeing what it took
+        auto copy = buildCopy(src, &destParent, plan);
+        if (!copy) return Response::Error;
+        copy->name = name;
+
+        auto copyBlock = [&plan](size_t i) {
+            const BlockCopy& block = plan.blocks[i];
+            block.src->readAt(block.offset, block.size, block.dest);
+        };
+        if (plan.bytes >= PARALLEL_COPY_MIN_BYTES && plan.blocks.size() > 1) {
+            common::WorkerPool::shared().parallelFor(plan.blocks.size(), copyBlock);
+        } else {
+            for (size_t i = 0; i < plan.blocks.size(); ++i) copyBlock(i);
+        }
+
+        indexCopiedSubtree(src, *copy);
+        addUsage(destParent, copy->usage);
+        destParent.subfolders.push_back(std::move(copy));
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        std::ostringstream summary;
+        summary << "Copied " << plan.files << " files in " << plan.folders << " folders (" << plan.bytes
+                << " bytes) in " << std::fixed << std::setprecision(3) << seconds * 1000.0 << " ms";
+        if (seconds > 0) {
+            summary << ": " << std::setprecision(0) << plan.files / seconds << " files/s, " << std::setprecision(1)
+                    << plan.bytes / seconds / (1024.0 * 1024.0) << " MB/s";
+        }
+        logInfo(summary.str());
+        return Response::OK;
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+}  // namespace storage
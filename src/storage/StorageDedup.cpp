@@ -0,0 +1,102 @@
+#include "storage/Storage.h"
+#include <unordered_set>
+
+namespace storage {
+
+void StorageManager::setDedup(bool enabled) {
+    TreeLock lock(*this, TreeLock::Exclusive);
+    dedupEnabled = enabled;
+    if (!enabled) {
+        // contents shared so far stay shared until written
+        dedupIndex.clear();
+        dedupSweepAt = DEDUP_MIN_SWEEP;
+    }
+    logInfo(std::string("Content deduplication ") + (enabled ? "enabled" : "disabled"));
+}
+
+std::shared_ptr<FileContent> StorageManager::findDuplicate(uint64_t hash,
+                                                           const std::function<bool(const FileContent&)>& matches) {
+    auto [it, end] = dedupIndex.equal_range(hash);
+    while (it != end) {
+        auto candidate = it->second.lock();
+        if (!candidate) {
+            it = dedupIndex.erase(it);
+            continue;
+        }
+        if (matches(*candidate)) {
+            return candidate;
+        }
+        ++it;
+    }
+    return nullptr;
+}
+
+void StorageManager::registerContent(uint64_t hash, const std::shared_ptr<FileContent>& content) {
+    if (dedupIndex.size() >= dedupSweepAt) {
+        std::erase_if(dedupIndex, [](const auto& entry) { return entry.second.expired(); });
+        dedupSweepAt = std::max(DEDUP_MIN_SWEEP, dedupIndex.size() * 2);
+    }
+    dedupIndex.emplace(hash, content);
+}
+
+bool StorageManager::shareDuplicate(File& file, std::initializer_list<std::string_view> pieces, uint64_t& outHash) {
+    if (!dedupEnabled) return false;
+    ContentHasher hasher;
+    for (auto piece : pieces) hasher.update(piece.data(), piece.size());
+    outHash = hasher.digest();
+    auto duplicate = findDuplicate(outHash, [pieces](const FileContent& candidate) { return candidate.equals(pieces); });
+    if (!duplicate) return false;
+    file.content = std::move(duplicate);
+    return true;
+}
+
+void StorageManager::dedupLoaded(std::shared_ptr<FileContent>& content) {
+    if (!dedupEnabled) return;
+    uint64_t hash = content->hash();
+    const FileContent& loaded = *content;
+    auto duplicate = findDuplicate(hash, [&loaded](const FileContent& candidate) { return candidate.equals(loaded); });
+    if (duplicate) {
+        content = std::move(duplicate);
+    } else {
+        registerContent(hash, content);
+    }
+}
+
+std::shared_ptr<FileContent> StorageManager::loadBlob(const std::shared_ptr<const void>& pin, const char* bytes,
+                                                      uint64_t size, bool lazy, BlobCache& loaded) {
+    auto known = loaded.find(bytes);
+    if (known != loaded.end() && known->second->size() == size) {
+        return known->second;
+    }
+    auto content = std::make_shared<FileContent>(FileContent::mapped(&contentAllocator, pin, bytes, size));
+    if (!lazy) {
+        // compare on the mapping, so a duplicate never takes memory at all
+        dedupLoaded(content);
+        if (!content->materialize()) return nullptr;
+    }
+    loaded.emplace(bytes, content);
+    return content;
+}
+
+StorageManager::DedupStats StorageManager::dedupStats() const {
+    TreeLock lock(*this, TreeLock::Shared);
+    DedupStats stats;
+    std::unordered_set<const FileContent*> seen;
+    std::vector<const Folder*> pending{root.get()};
+    while (!pending.empty()) {
+        const Folder* folder = pending.back();
+        pending.pop_back();
+        for (const auto& file : folder->files) {
+            ++stats.files;
+            stats.logicalBytes += file->content->size();
+            if (seen.insert(file->content.get()).second) {
+                ++stats.contents;
+                stats.storedBytes += file->content->size();
+            }
+        }
+        for (const auto& sub : folder->subfolders) pending.push_back(sub.get());
+    }
+    return stats;
+}
+
+}  // namespace storage
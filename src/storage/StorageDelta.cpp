@@ -0,0 +1,366 @@
+#include "storage/Storage.h"
+#include "storage/MappedFile.h"
+#include "storage/SnapshotEncoding.h"
+#include <cstring>
+#include <fstream>
+
+namespace storage {
+
+using Response = StorageManager::StorageResponse;
+using namespace snapshot;
+
+// Delta segments are appended to "<base>.delta", one per incremental save:
+//
+//   header   magic "S3ALDLTA", u32 version, u32 base snapshot id,
+//            u64 record count, u64 record bytes, u64 blob bytes
+//   records  one per dirty folder, parents before children:
+//            u32 depth + that many path components below the root,
+//            i64 created, i64 modified, u64 quota bytes, u64 quota inodes,
+//            u64 subfolder count + names, in order,
+//            u64 file count, then per file: name, i64 created, i64 modified,
+//            u32 mode, u32 owner uid, i32 owner pid,
+//            u8 has data, and when set u64 blob offset + u64 size
+//   blobs    contents of the files that changed, each distinct one once
+//
+// A record lists the folder's complete contents. Subfolders not listed are
+// removed, new ones start empty and get their own record. Files without
+// data keep the bytes they had before the segment.
+//
+// Version 1 segments have no quotas in their records; versions 1 and 2
+// have no mode or owner for their files.
+//
+// Segments whose base id does not match the snapshot are stale (the base
+// was rewritten) and are ignored, as is a torn segment at the end.
+
+namespace {
+
+constexpr char DELTA_MAGIC[8] = {'S', '3', 'A', 'L', 'D', 'L', 'T', 'A'};
+constexpr uint32_t DELTA_VERSION = 3;
+constexpr uint32_t DELTA_VERSION_NO_META = 2;
+constexpr uint32_t DELTA_VERSION_NO_QUOTA = 1;
+constexpr size_t DELTA_HEADER_SIZE = 8 + 4 + 4 + 3 * 8;
+
+std::string normalizedPath(const std::string& path) {
+    return std::filesystem::absolute(path).lexically_normal().string();
+}
+
+struct DeltaWriter {
+    std::string records;
+    BlobTable blobs;
+    std::vector<std::string_view> path;
+    uint64_t recordCount = 0;
+    uint64_t dataFiles = 0;
+
+    void writeRecord(const StorageManager::Folder& folder) {
+        put32(records, static_cast<uint32_t>(path.size()));
+        for (auto component : path) putString(records, component);
+        put64(records, toNanos(folder.createdAt));
+        put64(records, toNanos(folder.modifiedAt));
+        put64(records, folder.quota.bytes);
+        put64(records, folder.quota.inodes);
+
+        put64(records, folder.subfolders.size());
+        for (const auto& sub : folder.subfolders) putString(records, sub->name);
+
+        put64(records, folder.files.size());
+        for (const auto& file : folder.files) {
+            putString(records, file->name);
+            put64(records, toNanos(file->createdAt));
+            put64(records, toNanos(file->modifiedAt));
+            put32(records, file->mode);
+            put32(records, file->ownerUid);
+            put32(records, static_cast<uint32_t>(file->ownerPid));
+            records.push_back(file->dirty ? 1 : 0);
+            if (file->dirty) {
+                put64(records, blobs.add(*file->content));
+                put64(records, file->content->size());
+                ++dataFiles;
+            }
+        }
+        ++recordCount;
+    }
+
+    // Preorder over dirty subtrees only
+    void walk(const StorageManager::Folder& folder) {
+        if (folder.dirty) writeRecord(folder);
+        for (const auto& sub : folder.subfolders) {
+            if (!sub->subtreeDirty) continue;
+            path.push_back(sub->name);
+            walk(*sub);
+            path.pop_back();
+        }
+    }
+};
+
+}  // namespace
+
+void StorageManager::markModified(Folder& folder) {
+    folder.modifiedAt = std::chrono::system_clock::now();
+    markDirty(folder);
+}
+
+void StorageManager::markModified(Folder& folder, File& file) {
+    file.modifiedAt = std::chrono::system_clock::now();
+    file.version = nextFileVersion();
+    file.dirty = true;
+    markModified(folder);
+}
+
+void StorageManager::markDirty(Folder& folder) {
+    folder.dirty = true;
+    folder.subtreeDirty = true;
+    for (Folder* up = folder.parent; up && !up->subtreeDirty; up = up->parent) {
+        up->subtreeDirty = true;
+    }
+}
+
+void StorageManager::markSubtreeDirty(Folder& folder) {
+    folder.dirty = true;
+    folder.subtreeDirty = true;
+    for (auto& file : folder.files) file->dirty = true;
+    for (auto& sub : folder.subfolders) markSubtreeDirty(*sub);
+}
+
+void StorageManager::clearDirty(Folder& folder) {
+    if (!folder.subtreeDirty) return;
+    folder.dirty = false;
+    folder.subtreeDirty = false;
+    for (auto& file : folder.files) file->dirty = false;
+    for (auto& sub : folder.subfolders) clearDirty(*sub);
+}
+
+void StorageManager::trackDeltaBase(const std::string& path, uint32_t snapshotId, bool clearFlags) {
+    deltaBasePath = normalizedPath(path);
+    deltaBaseId = snapshotId;
+    if (clearFlags) clearDirty(*root);
+}
+
+bool StorageManager::isDeltaBase(const std::string& path) const {
+    return !deltaBasePath.empty() && normalizedPath(path) == deltaBasePath &&
+           std::filesystem::is_regular_file(path);
+}
+
+Response StorageManager::saveDeltaSegment(const std::string& path) {
+    try {
+        if (!root->subtreeDirty) {
+            logInfo("No changes since the last save of " + path);
+            return Response::OK;
+        }
+
+        DeltaWriter writer;
+        writer.walk(*root);
+
+        std::string header(DELTA_MAGIC, sizeof(DELTA_MAGIC));
+        put32(header, DELTA_VERSION);
+        put32(header, deltaBaseId);
+        put64(header, writer.recordCount);
+        put64(header, writer.records.size());
+        put64(header, writer.blobs.bytes());
+
+        std::string deltaPath = path + std::string(DELTA_SUFFIX);
+        uint64_t previousSize = std::filesystem::exists(deltaPath) ? std::filesystem::file_size(deltaPath) : 0;
+        {
+            std::ofstream out(deltaPath, std::ios::out | std::ios::binary | std::ios::app);
+            if (!out.is_open()) {
+                return Response::Error;
+            }
+            out.write(header.data(), static_cast<std::streamsize>(header.size()));
+            out.write(writer.records.data(), static_cast<std::streamsize>(writer.records.size()));
+            for (const FileContent* content : writer.blobs.contents()) {
+                content->forEachSegment([&out](const char* bytes, size_t count) {
+                    out.write(bytes, static_cast<std::streamsize>(count));
+                });
+            }
+            out.flush();
+            if (!out) {
+                out.close();
+                // drop the partial segment so later appends stay readable
+                std::filesystem::resize_file(deltaPath, previousSize);
+                return Response::Error;
+            }
+        }
+
+        clearDirty(*root);
+        logInfo("Saved delta to " + deltaPath + " (" + std::to_string(writer.recordCount) + " folders, " +
+                std::to_string(writer.dataFiles) + " files, " + std::to_string(writer.blobs.bytes()) + " bytes)");
+        return Response::OK;
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+Response StorageManager::applyDeltaSegments(Folder& base, const std::string& deltaPath, uint32_t snapshotId,
+                                            bool lazy) {
+    auto mapping = MappedFile::open(deltaPath);
+    if (!mapping) {
+        return Response::OK;  // no deltas on top of this snapshot
+    }
+    std::shared_ptr<const void> pin = mapping;
+    Reader segments(mapping->data(), mapping->size());
+    size_t applied = 0;
+    BlobCache loadedBlobs;
+
+    while (segments.remaining() > 0) {
+        if (segments.remaining() < DELTA_HEADER_SIZE) {
+            logWarn("Ignoring torn delta segment at the end of " + deltaPath);
+            break;
+        }
+        const char* header = segments.bytes(DELTA_HEADER_SIZE);
+        uint32_t version = get32(header + 8);
+        if (std::memcmp(header, DELTA_MAGIC, sizeof(DELTA_MAGIC)) != 0 ||
+            version < DELTA_VERSION_NO_QUOTA || version > DELTA_VERSION) {
+            logError("Corrupt delta segment in " + deltaPath);
+            return Response::Error;
+        }
+        if (get32(header + 12) != snapshotId) {
+            logWarn("Ignoring delta segments written for an older snapshot: " + deltaPath);
+            break;
+        }
+        uint64_t recordCount = get64(header + 16);
+        uint64_t recordBytes = get64(header + 24);
+        uint64_t blobBytes = get64(header + 32);
+        if (recordBytes > segments.remaining() || blobBytes > segments.remaining() - recordBytes) {
+            logWarn("Ignoring torn delta segment at the end of " + deltaPath);
+            break;
+        }
+        Reader records(segments.bytes(recordBytes), recordBytes);
+        const char* blobs = segments.bytes(blobBytes);
+
+        for (uint64_t r = 0; r < recordCount; ++r) {
+            Folder* folder = &base;
+            uint32_t depth = records.u32();
+            for (uint32_t i = 0; i < depth && folder; ++i) {
+                folder = findSubfolder(*folder, records.string());
+            }
+            if (!folder || !records.ok()) {
+                logError("Delta record for a missing folder in " + deltaPath);
+                return Response::Error;
+            }
+            folder->createdAt = fromNanos(records.u64());
+            folder->modifiedAt = fromNanos(records.u64());
+            if (version > DELTA_VERSION_NO_QUOTA) {
+                folder->quota.bytes = records.u64();
+                folder->quota.inodes = records.u64();
+            }
+
+            // rebuild the listing, reusing the children that are still there
+            uint64_t subfolderCount = records.u64();
+            if (subfolderCount > records.remaining()) return Response::Error;
+            std::unordered_map<std::string_view, std::unique_ptr<Folder>*> oldSubfolders;
+            for (auto& sub : folder->subfolders) oldSubfolders.emplace(sub->name, &sub);
+            std::vector<std::unique_ptr<Folder>> subfolders;
+            subfolders.reserve(subfolderCount);
+            for (uint64_t i = 0; i < subfolderCount; ++i) {
+                std::string_view name = records.string();
+                auto it = oldSubfolders.find(name);
+                if (it != oldSubfolders.end() && *it->second) {
+                    subfolders.push_back(std::move(*it->second));
+                } else {
+                    auto sub = std::make_unique<Folder>();
+                    sub->name = name;
+                    sub->parent = folder;
+                    subfolders.push_back(std::move(sub));
+                }
+            }
+
+            uint64_t fileCount = records.u64();
+            if (fileCount > records.remaining()) return Response::Error;
+            std::unordered_map<std::string_view, std::unique_ptr<File>*> oldFiles;
+            for (auto& file : folder->files) oldFiles.emplace(file->name, &file);
+            std::vector<std::unique_ptr<File>> files;
+            files.reserve(fileCount);
+            for (uint64_t i = 0; i < fileCount; ++i) {
+                std::string_view name = records.string();
+                auto createdAt = fromNanos(records.u64());
+                auto modifiedAt = fromNanos(records.u64());
+                bool hasMeta = version > DELTA_VERSION_NO_META;
+                uint32_t mode = hasMeta ? records.u32() : DEFAULT_FILE_MODE;
+                uint32_t ownerUid = hasMeta ? records.u32() : 0;
+                int32_t ownerPid = hasMeta ? static_cast<int32_t>(records.u32()) : 0;
+                std::unique_ptr<File> file;
+                if (records.u8() != 0) {
+                    uint64_t offset = records.u64();
+                    uint64_t size = records.u64();
+                    if (offset > blobBytes || size > blobBytes - offset) {
+                        logError("Corrupt file record in " + deltaPath);
+                        return Response::Error;
+                    }
+                    file = makeFile(NodeName(name));
+                    file->content = loadBlob(pin, blobs + offset, size, lazy, loadedBlobs);
+                    if (!file->content) {
+                        logError("Failed to load content for file: " + file->name);
+                        return Response::Error;
+                    }
+                } else {
+                    auto it = oldFiles.find(name);
+                    if (it == oldFiles.end() || !*it->second) {
+                        logError("Delta keeps a file the snapshot does not have: " + std::string(name));
+                        return Response::Error;
+                    }
+                    file = std::move(*it->second);
+                }
+                file->createdAt = createdAt;
+                file->modifiedAt = modifiedAt;
+                file->mode = static_cast<uint16_t>(mode & MAX_FILE_MODE);
+                file->ownerUid = ownerUid;
+                file->ownerPid = ownerPid;
+                file->version = nextFileVersion();
+                files.push_back(std::move(file));
+            }
+            if (!records.ok()) {
+                logError("Corrupt delta record in " + deltaPath);
+                return Response::Error;
+            }
+
+            // the maps point into the old vectors, replace them only now
+            folder->subfolders = std::move(subfolders);
+            folder->files = std::move(files);
+        }
+        ++applied;
+    }
+
+    if (applied > 0) {
+        logInfo("Applied " + std::to_string(applied) + " delta segment(s) from " + deltaPath);
+    }
+    return Response::OK;
+}
+
+Response StorageManager::compactSnapshot(const std::string& fileName) {
+    TreeLock lock(*this, TreeLock::Exclusive);
+    try {
+        finishBackgroundSave();
+        std::string name = fileName.ends_with(".bin") ? fileName : fileName + ".bin";
+        std::string path = "data/" + name;
+        if (!std::filesystem::is_regular_file(path)) {
+            return Response::NotFound;
+        }
+        if (!std::filesystem::exists(path + std::string(DELTA_SUFFIX))) {
+            logInfo("Nothing to compact for " + path);
+            return Response::OK;
+        }
+
+        // Replay the deltas on a mapped copy of the base and write it back
+        // under the same id, so a tree tracking this snapshot stays in step
+        StorageManager merged;
+        merged.setLogCallback([this](const std::string& level, const std::string&, const std::string& message) {
+            log(level, message);
+        });
+        // the deltas change files, so an index has to be built anew
+        merged.setIndexing(isIndexing());
+        Response result = merged.loadBinarySnapshot(path, true);
+        if (result != Response::OK) {
+            return result;
+        }
+        // a compressed base stays compressed
+        result = merged.saveBinarySnapshot(path, merged.deltaBaseId, merged.snapshotStats.compressed,
+                                           merged.encodeIndex());
+        if (result == Response::OK) {
+            logInfo("Compacted snapshot " + path);
+        }
+        return result;
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+}  // namespace storage
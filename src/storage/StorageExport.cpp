@@ -0,0 +1,132 @@
+#include "storage/Storage.h"
+#include "common/WorkerPool.h"
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+namespace storage {
+
+using Response = StorageManager::StorageResponse;
+
+// An export pins every file's content under a shared hold and lets go of
+// the tree; writes made meanwhile go to fresh copies, so the export sees
+// the subtree as it was. The host directories are created up front, then
+// the worker pool writes the files, each straight from its extents with
+// unbuffered writes, and stamps them. Directory times are set last,
+// deepest first, since writing a file changes its directory's.
+
+namespace {
+
+std::filesystem::file_time_type fileTime(std::chrono::system_clock::time_point time) {
+    return std::chrono::file_clock::from_sys(time);
+}
+
+struct HostDir {
+    std::filesystem::path path;
+    std::chrono::system_clock::time_point modifiedAt;
+};
+
+struct HostFile {
+    std::filesystem::path path;
+    std::shared_ptr<const FileContent> content;
+    std::chrono::system_clock::time_point modifiedAt;
+    bool written = false;
+};
+
+bool writeHostFile(HostFile& file) {
+    std::FILE* out = std::fopen(file.path.string().c_str(), "wb");
+    if (!out) return false;
+    // the extents go out as they are, past the stdio buffer
+    std::setvbuf(out, nullptr, _IONBF, 0);
+    bool ok = true;
+    file.content->forEachSegment([&](const char* bytes, size_t count) {
+        if (ok && count > 0 && std::fwrite(bytes, 1, count, out) != count) ok = false;
+    });
+    ok = std::fclose(out) == 0 && ok;
+    std::error_code error;
+    if (ok) std::filesystem::last_write_time(file.path, fileTime(file.modifiedAt), error);
+    return ok && !error;
+}
+
+}  // namespace
+
+Response StorageManager::exportTree(const std::string& path, const std::string& hostDir, ExportStats& outStats) {
+    if (path.empty() || hostDir.empty()) {
+        return Response::InvalidArgument;
+    }
+    auto started = std::chrono::steady_clock::now();
+    std::vector<HostDir> dirs;
+    std::vector<HostFile> files;
+    ExportStats stats;
+    {
+        TreeLock lock(*this, TreeLock::Shared);
+        const Folder* top = findFolder(path);
+        if (!top) {
+            logError("Directory not found: " + path);
+            return Response::NotFound;
+        }
+        std::vector<std::pair<const Folder*, std::filesystem::path>> pending{{top, hostDir}};
+        while (!pending.empty()) {
+            auto [folder, dirPath] = pending.back();
+            pending.pop_back();
+            for (const auto& file : folder->files) {
+                files.push_back({dirPath / file->name.view(), file->content, file->modifiedAt});
+            }
+            for (auto it = folder->subfolders.rbegin(); it != folder->subfolders.rend(); ++it) {
+                pending.emplace_back(it->get(), dirPath / (*it)->name.view());
+            }
+            dirs.push_back({std::move(dirPath), folder->modifiedAt});
+        }
+        stats.folders = top->usage.folders;
+        stats.files = top->usage.files;
+        stats.bytes = top->usage.bytes;
+    }
+
+    try {
+        std::error_code error;
+        for (const auto& dir : dirs) {
+            std::filesystem::create_directories(dir.path, error);
+            if (error) {
+                logError("Cannot create host directory " + dir.path.string() + ": " + error.message());
+                return Response::Error;
+            }
+        }
+
+        common::WorkerPool::shared().parallelFor(files.size(), [&files](size_t i) {
+            files[i].written = writeHostFile(files[i]);
+        });
+        size_t failed = 0;
+        for (auto& file : files) {
+            if (!file.written) {
+                ++failed;
+                logError("Cannot write host file " + file.path.string());
+            }
+            // the pins go here, on this thread, not at the end of the export
+            file.content.reset();
+        }
+
+        // preorder reversed puts every directory after those below it
+        for (auto it = dirs.rbegin(); it != dirs.rend(); ++it) {
+            std::filesystem::last_write_time(it->path, fileTime(it->modifiedAt), error);
+        }
+        if (failed > 0) return Response::Error;
+
+        stats.elapsed = std::chrono::steady_clock::now() - started;
+        outStats = stats;
+        double seconds = std::chrono::duration<double>(stats.elapsed).count();
+        std::ostringstream summary;
+        summary << "Exported " << path << " to " << hostDir << ": " << stats.files << " files in " << stats.folders
+                << " folders (" << stats.bytes << " bytes) in " << std::fixed << std::setprecision(3)
+                << seconds * 1000.0 << " ms";
+        if (seconds > 0) {
+            summary << ", " << std::setprecision(0) << stats.files / seconds << " files/s, " << std::setprecision(1)
+                    << stats.bytes / seconds / (1024.0 * 1024.0) << " MB/s";
+        }
+        logInfo(summary.str());
+        return Response::OK;
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+}  // namespace storage
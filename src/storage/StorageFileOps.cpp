@@ -1,51 +1,92 @@
 #include "storage/Storage.h"
 #include "kernel/SysCallsAPI.h"
 #include <iostream>
-#include <cstring>
+#include <algorithm>
 
 namespace storage {
 
 using Response = StorageManager::StorageResponse;
 
-Response StorageManager::allocateFileMemory(File& file, const void* data, size_t size) {
-    // Free old memory if exists
-    if (file.memoryToken && sysApi) {
-        auto result = sysApi->deallocateMemory(file.memoryToken);
-        if (result != sys::SysResult::OK) {
-            logError("Failed to deallocate memory for file: " + file.name);
-            return Response::Error;
-        }
-        file.memoryToken = nullptr;
-        file.contentSize = 0;
+std::unique_ptr<StorageManager::File> StorageManager::makeFile(NodeName name,
+                                                                std::chrono::system_clock::time_point stamp) {
+    auto file = std::make_unique<File>();
+    file->name = name;
+    file->content = std::make_shared<FileContent>(&contentAllocator);
+    file->createdAt = stamp;
+    file->modifiedAt = stamp;
+    const ThreadView& view = threadView();
+    file->ownerUid = view.callerUid;
+    file->ownerPid = view.callerPid;
+    return file;
+}
+
+uint64_t StorageManager::nextFileVersion() {
+    static std::atomic<uint64_t> versions{0};
+    return versions.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void StorageManager::copyFileMeta(const File& src, File& dest) {
+    dest.mode = src.mode;
+    dest.ownerUid = src.ownerUid;
+    dest.ownerPid = src.ownerPid;
+}
+
+void StorageManager::setCaller(uint32_t uid, int32_t pid) {
+    ThreadView& view = threadView();
+    view.callerUid = uid;
+    view.callerPid = pid;
+}
+
+Response StorageManager::copyFileContent(const File& src, File& dest) {
+    if (dedupEnabled) {
+        // same bytes, one copy: whichever file is written first splits off
+        dest.content = src.content;
+        return Response::OK;
     }
-    
-    // Allocate new memory if size > 0
-    if (size > 0 && sysApi) {
-        file.memoryToken = sysApi->allocateMemory(size, 0);
-        if (!file.memoryToken) {
-            logError("Out of memory for file: " + file.name);
-            return Response::Error;
-        }
-        
-        if (data) {
-            std::memcpy(file.memoryToken, data, size);
-        }
-        file.contentSize = size;
-    } else {
-        file.memoryToken = nullptr;
-        file.contentSize = 0;
+    if (!dest.content->copyFrom(*src.content)) {
+        logError("Out of memory for file: " + dest.name);
+        return Response::Error;
     }
-    
     return Response::OK;
 }
 
+void StorageManager::ensureResident(const File& file) {
+    // Contents shared with open views stay put, since views may point into
+    // the mapping. If memory runs out the mapping keeps serving reads.
+    if (!file.content->isResident() && file.content.use_count() == 1) {
+        file.content->materialize();
+    }
+}
+
+FileContent* StorageManager::writableContent(File& file, bool keepBytes) {
+    // a finished background save no longer needs the contents it shares
+    reapBackgroundSave();
+
+    // nobody else holds the content, modify it in place (unless it is
+    // still mapped and about to be replaced whole anyway)
+    if (file.content.use_count() == 1 && (keepBytes || file.content->isResident())) {
+        return file.content.get();
+    }
+
+    // pinned by an open view: give the file its own copy so the view
+    // keeps seeing the bytes it was opened on
+    auto fresh = std::make_shared<FileContent>(&contentAllocator);
+    if (keepBytes && !fresh->copyFrom(*file.content)) {
+        logError("Out of memory for file: " + file.name);
+        return nullptr;
+    }
+    file.content = std::move(fresh);
+    return file.content.get();
+}
+
 Response StorageManager::fileExists(const std::string& path) const {
+    TreeLock lock(*this, TreeLock::Shared);
     PathInfo info = parsePath(path);
     if (!info.folder) return Response::NotFound;
     if (isNameInvalid(info.name)) return Response::InvalidArgument;
     
     for (const auto& file : info.folder->files) {
-        if (file->name == info.name) {
+        if (file->name == info.key) {
             return Response::OK;
         }
     }
@@ -54,6 +95,7 @@ Response StorageManager::fileExists(const std::string& path) const {
 }
 
 Response StorageManager::createFile(const std::string& path) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     if (path.empty() || isNameInvalid(path)) {
         return Response::InvalidArgument;
     }
@@ -66,26 +108,25 @@ Response StorageManager::createFile(const std::string& path) {
     
     // check if file already exists
     for (const auto& file : info.folder->files) {
-        if (file->name == info.name) {
+        if (file->name == info.key) {
             logError("File already exists: " + path);
             return Response::AlreadyExists;
         }
     }
 
-    auto newFile = std::make_unique<File>();
-    newFile->name = info.name;
-    newFile->memoryToken = nullptr;
-    newFile->contentSize = 0;
-    newFile->createdAt = std::chrono::system_clock::now();
-    newFile->modifiedAt = std::chrono::system_clock::now();
-
-    info.folder->files.push_back(std::move(newFile));
-    info.folder->modifiedAt = std::chrono::system_clock::now();
+    if (!withinQuota(*info.folder, 1, 0)) return quotaExceeded(path);
+    info.folder->files.push_back(makeFile(NodeName(info.name)));
+    adjustUsage(*info.folder, 0, 1, 0);
+    markModified(*info.folder);
+    journalOp(JournalOp::CreateFile, path);
+    const File& created = *info.folder->files.back();
+    if (created.ownerUid != 0 || created.ownerPid != 0) journalFileMeta(path, created);
     logInfo("Created file: " + path);
     return Response::OK;
 }
 
 Response StorageManager::touchFile(const std::string& path) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     if (path.empty() || isNameInvalid(path)) {
         return Response::InvalidArgument;
     }
@@ -99,9 +140,9 @@ Response StorageManager::touchFile(const std::string& path) {
 
     // check if file exists
     for (auto& file : info.folder->files) {
-        if (file->name == info.name) {
-            file->modifiedAt = std::chrono::system_clock::now();
-            info.folder->modifiedAt = std::chrono::system_clock::now();
+        if (file->name == info.key) {
+            markModified(*info.folder, *file);
+            journalOp(JournalOp::TouchFile, path);
             logInfo("File already exists, timestamp updated: " + path);
             return Response::OK;
         }
@@ -113,6 +154,7 @@ Response StorageManager::touchFile(const std::string& path) {
 }
 
 Response StorageManager::deleteFile(const std::string& path) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     if (path.empty() || isNameInvalid(path)) {
         return Response::InvalidArgument;
     }
@@ -123,31 +165,32 @@ Response StorageManager::deleteFile(const std::string& path) {
     }
     if (isNameInvalid(info.name)) return Response::InvalidArgument;
 
-    return deleteFile(*info.folder, info.name);
+    Response result = deleteFile(*info.folder, info.name);
+    if (result == Response::OK) {
+        journalOp(JournalOp::DeleteFile, path);
+    }
+    return result;
 }
 
-Response StorageManager::deleteFile(Folder& folder, const std::string& name) {
+Response StorageManager::deleteFile(Folder& folder, std::string_view name) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     if (isNameInvalid(name)) return Response::InvalidArgument;
     for (size_t i = 0; i < folder.files.size(); ++i) {
         if (folder.files[i]->name == name) {
-            if (folder.files[i]->memoryToken && sysApi) {
-                auto result = sysApi->deallocateMemory(folder.files[i]->memoryToken);
-                if (result != sys::SysResult::OK) {
-                    logError("Failed to deallocate memory for file: " + name);
-                    return Response::Error;
-                }
-            }
+            unindexFile(*folder.files[i]);
+            adjustUsage(folder, 0, -1, -static_cast<int64_t>(folder.files[i]->content->size()));
             folder.files.erase(folder.files.begin() + i);
-            folder.modifiedAt = std::chrono::system_clock::now();
-            logInfo("Deleted file: " + name);
+            markModified(folder);
+            logInfo("Deleted file: " + std::string(name));
             return Response::OK;
         }
     }
-    logError("File not found: " + name);
+    logError("File not found: " + std::string(name));
     return Response::NotFound;
 }
 
 Response StorageManager::writeFile(const std::string& path, const std::string& content) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     if (path.empty() || isNameInvalid(path)) {
         return Response::InvalidArgument;
     }
@@ -160,16 +203,29 @@ Response StorageManager::writeFile(const std::string& path, const std::string& c
 
     // find file
     for (auto& file : info.folder->files) {
-        if (file->name == info.name) {
-            std::string contentWithNewline = content + "\n";
-            
-            auto result = allocateFileMemory(*file, contentWithNewline.c_str(), contentWithNewline.size());
-            if (result != Response::OK) {
-                return result;
+        if (file->name == info.key) {
+            uint64_t oldSize = file->content->size();
+            uint64_t newSize = content.size() + 1;
+            if (newSize > oldSize && !withinQuota(*info.folder, 0, newSize - oldSize)) return quotaExceeded(path);
+            uint64_t hash = 0;
+            if (!shareDuplicate(*file, {content, "\n"}, hash)) {
+                // size the content once, then fill it in place
+                FileContent* target = writableContent(*file, false);
+                if (!target ||
+                    !target->resize(content.size() + 1) ||
+                    !target->writeAt(0, content.data(), content.size()) ||
+                    !target->writeAt(content.size(), "\n", 1)) {
+                    contentResized(*info.folder, *file, oldSize);
+                    logError("Out of memory for file: " + path);
+                    return Response::Error;
+                }
+                if (dedupEnabled) registerContent(hash, file->content);
             }
             
-            file->modifiedAt = std::chrono::system_clock::now();
-            info.folder->modifiedAt = std::chrono::system_clock::now();
+            contentResized(*info.folder, *file, oldSize);
+            markModified(*info.folder, *file);
+            indexFile(*info.folder, *file);
+            journalOp(JournalOp::WriteFile, path, content);
             logInfo("Wrote to file: " + path);
             return Response::OK;
         }
@@ -180,29 +236,50 @@ Response StorageManager::writeFile(const std::string& path, const std::string& c
 }
 
 Response StorageManager::readFile(const std::string& path, std::string& outContent) const {
+    return readResident(path, [&](const File& file) {
+        outContent.clear();
+        file.content->appendTo(outContent);
+    });
+}
+
+Response StorageManager::editFile(const std::string& path, const std::string& newContent) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     if (path.empty() || isNameInvalid(path)) {
         return Response::InvalidArgument;
     }
     PathInfo info = parsePath(path);
-    if (!info.folder) return Response::NotFound;
+    if (!info.folder) {
+        logError("Path not found: " + path);
+        return Response::NotFound;
+    }
     if (isNameInvalid(info.name)) return Response::InvalidArgument;
     
-    for (const auto& file : info.folder->files) {
-        if (file->name == info.name) {
-            if (file->memoryToken && file->contentSize > 0) {
-                const char* src = static_cast<const char*>(file->memoryToken);
-                outContent.assign(src, file->contentSize);
-            } else {
-                outContent.clear();
+    for (auto& file : info.folder->files) {
+        if (file->name == info.key) {
+            if (!withinQuota(*info.folder, 0, newContent.size())) return quotaExceeded(path);
+            uint64_t oldSize = file->content->size();
+            FileContent* target = writableContent(*file, true);
+            if (!target || !target->append(newContent.data(), newContent.size())) {
+                contentResized(*info.folder, *file, oldSize);
+                logError("Out of memory for file: " + path);
+                return Response::Error;
             }
+            
+            contentResized(*info.folder, *file, oldSize);
+            markModified(*info.folder, *file);
+            indexAppended(*info.folder, *file, oldSize);
+            journalOp(JournalOp::EditFile, path, newContent);
+            logInfo("Edited file: " + path);
             return Response::OK;
         }
     }
     
+    logError("File not found: " + path);
     return Response::NotFound;
 }
 
-Response StorageManager::editFile(const std::string& path, const std::string& newContent) {
+Response StorageManager::appendFile(const std::string& path, const std::string& content) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     if (path.empty() || isNameInvalid(path)) {
         return Response::InvalidArgument;
     }
@@ -212,34 +289,142 @@ Response StorageManager::editFile(const std::string& path, const std::string& ne
         return Response::NotFound;
     }
     if (isNameInvalid(info.name)) return Response::InvalidArgument;
-    
+
     for (auto& file : info.folder->files) {
-        if (file->name == info.name) {
-            std::string existingContent;
-            if (file->memoryToken && file->contentSize > 0) {
-                const char* src = static_cast<const char*>(file->memoryToken);
-                existingContent.assign(src, file->contentSize);
+        if (file->name == info.key) {
+            // same layout writeFile produces: every appended record ends with a newline
+            if (!withinQuota(*info.folder, 0, content.size() + 1)) return quotaExceeded(path);
+            uint64_t oldSize = file->content->size();
+            FileContent* target = writableContent(*file, true);
+            if (!target ||
+                !target->append(content.data(), content.size()) ||
+                !target->append("\n", 1)) {
+                contentResized(*info.folder, *file, oldSize);
+                logError("Out of memory for file: " + path);
+                return Response::Error;
             }
-            
-            std::string combined = existingContent + newContent;
-            
-            auto result = allocateFileMemory(*file, combined.c_str(), combined.size());
-            if (result != Response::OK) {
-                return result;
+
+            contentResized(*info.folder, *file, oldSize);
+            markModified(*info.folder, *file);
+            indexAppended(*info.folder, *file, oldSize);
+            journalOp(JournalOp::AppendFile, path, content);
+            logInfo("Appended to file: " + path);
+            return Response::OK;
+        }
+    }
+
+    logError("File not found: " + path);
+    return Response::NotFound;
+}
+
+Response StorageManager::readFileRange(const std::string& path, size_t offset, size_t length,
+                                       std::string& outContent) const {
+    return readResident(path, [&](const File& file) {
+        size_t available = offset < file.content->size() ? file.content->size() - offset : 0;
+        outContent.resize(std::min(length, available));
+        file.content->readAt(offset, outContent.size(), outContent.data());
+    });
+}
+
+Response StorageManager::writeFileAt(const std::string& path, size_t offset, const std::string& data) {
+    TreeLock lock(*this, TreeLock::Exclusive);
+    if (path.empty() || isNameInvalid(path)) {
+        return Response::InvalidArgument;
+    }
+    PathInfo info = parsePath(path);
+    if (!info.folder) {
+        logError("Path not found: " + path);
+        return Response::NotFound;
+    }
+    if (isNameInvalid(info.name)) return Response::InvalidArgument;
+
+    for (auto& file : info.folder->files) {
+        if (file->name == info.key) {
+            uint64_t oldSize = file->content->size();
+            uint64_t end = offset + data.size();
+            if (end > oldSize && !withinQuota(*info.folder, 0, end - oldSize)) return quotaExceeded(path);
+            FileContent* target = writableContent(*file, true);
+            if (!target || !target->writeAt(offset, data.data(), data.size())) {
+                contentResized(*info.folder, *file, oldSize);
+                logError("Out of memory for file: " + path);
+                return Response::Error;
             }
-            
-            file->modifiedAt = std::chrono::system_clock::now();
-            info.folder->modifiedAt = std::chrono::system_clock::now();
-            logInfo("Edited file: " + path);
+
+            contentResized(*info.folder, *file, oldSize);
+            markModified(*info.folder, *file);
+            indexFile(*info.folder, *file);
+            journalOp(JournalOp::WriteFileAt, path, data, offset);
+            logDebug("Wrote " + std::to_string(data.size()) + " bytes at offset " +
+                     std::to_string(offset) + " to file: " + path);
             return Response::OK;
         }
     }
-    
+
     logError("File not found: " + path);
     return Response::NotFound;
 }
 
+Response StorageManager::statFile(const std::string& path, FileStat& outStat) const {
+    TreeLock lock(*this, TreeLock::Shared);
+    if (path.empty() || isNameInvalid(path)) {
+        return Response::InvalidArgument;
+    }
+    PathInfo info = parsePath(path);
+    if (!info.folder) return Response::NotFound;
+    if (isNameInvalid(info.name)) return Response::InvalidArgument;
+
+    for (const auto& file : info.folder->files) {
+        if (file->name == info.key) {
+            outStat.size = file->content->size();
+            outStat.createdAt = file->createdAt;
+            outStat.modifiedAt = file->modifiedAt;
+            outStat.mode = file->mode;
+            outStat.links = 1;
+            outStat.ownerUid = file->ownerUid;
+            outStat.ownerPid = file->ownerPid;
+            outStat.version = file->version;
+            return Response::OK;
+        }
+    }
+
+    return Response::NotFound;
+}
+
+Response StorageManager::setFileMode(const std::string& path, uint16_t mode) {
+    if (mode > MAX_FILE_MODE) return Response::InvalidArgument;
+    return updateFileMeta(path, [mode](File& file) { file.mode = mode; });
+}
+
+Response StorageManager::updateFileMeta(const std::string& path, const std::function<void(File&)>& change) {
+    TreeLock lock(*this, TreeLock::Exclusive);
+    if (path.empty() || isNameInvalid(path)) {
+        return Response::InvalidArgument;
+    }
+    PathInfo info = parsePath(path);
+    if (!info.folder) return Response::NotFound;
+    if (isNameInvalid(info.name)) return Response::InvalidArgument;
+
+    for (auto& file : info.folder->files) {
+        if (file->name == info.key) {
+            change(*file);
+            file->version = nextFileVersion();
+            // the folder's next delta record carries the file's metadata
+            markDirty(*info.folder);
+            journalFileMeta(path, *file);
+            return Response::OK;
+        }
+    }
+
+    logError("File not found: " + path);
+    return Response::NotFound;
+}
+
+Response StorageManager::pinFile(const std::string& path, std::shared_ptr<const FileContent>& outContent) const {
+    return readResident(path, [&](const File& file) { outContent = file.content; });
+}
+
 Response StorageManager::copyFile(const std::string& srcPath, const std::string& destPath) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     // validate inputs
     if (srcPath.empty() || destPath.empty()) {
         return Response::InvalidArgument;
@@ -255,7 +440,7 @@ Response StorageManager::copyFile(const std::string& srcPath, const std::string&
     // find source file
     File* srcFile = nullptr;
     for (const auto& file : srcInfo.folder->files) {
-        if (file->name == srcInfo.name) {
+        if (file->name == srcInfo.key) {
             srcFile = file.get();
             break;
         }
@@ -276,7 +461,7 @@ Response StorageManager::copyFile(const std::string& srcPath, const std::string&
     // check if destination is an existing directory
     Folder* targetDir = nullptr;
     for (const auto& sub : destInfo.folder->subfolders) {
-        if (sub->name == destInfo.name) {
+        if (sub->name == destInfo.key) {
             targetDir = sub.get();
             break;
         }
@@ -285,24 +470,26 @@ Response StorageManager::copyFile(const std::string& srcPath, const std::string&
     if (targetDir) {
         // dest is a directory, copy file into it with original name
         for (const auto& f : targetDir->files) {
-            if (f->name == srcInfo.name) {
-                logError("File already exists: " + srcInfo.name);
+            if (f->name == srcInfo.key) {
+                logError("File already exists: " + std::string(srcInfo.name));
                 return Response::AlreadyExists;
             }
         }
         
-        auto newFile = std::make_unique<File>();
-        newFile->name = srcFile->name;
-        newFile->createdAt = std::chrono::system_clock::now();
-        newFile->modifiedAt = std::chrono::system_clock::now();
-        
-        auto result = allocateFileMemory(*newFile, srcFile->memoryToken, srcFile->contentSize);
+        if (!withinQuota(*targetDir, 1, srcFile->content->size())) return quotaExceeded(destPath);
+        auto newFile = makeFile(srcFile->name);
+        copyFileMeta(*srcFile, *newFile);
+        auto result = copyFileContent(*srcFile, *newFile);
         if (result != Response::OK) {
             return result;
         }
         
+        File* copy = newFile.get();
         targetDir->files.push_back(std::move(newFile));
-        targetDir->modifiedAt = std::chrono::system_clock::now();
+        adjustUsage(*targetDir, 0, 1, static_cast<int64_t>(copy->content->size()));
+        indexCopy(*srcFile, *targetDir, *copy);
+        markModified(*targetDir);
+        journalOp(JournalOp::CopyFile, srcPath, destPath);
         
         logInfo("Copied file '" + srcPath + "' into directory '" + destPath + "'");
         return Response::OK;
@@ -310,30 +497,33 @@ Response StorageManager::copyFile(const std::string& srcPath, const std::string&
     
     // dest is not a directory, copy to exact path with new name
     for (const auto& file : destInfo.folder->files) {
-        if (file->name == destInfo.name) {
+        if (file->name == destInfo.key) {
             logError("Destination file already exists: " + destPath);
             return Response::AlreadyExists;
         }
     }
 
-    auto newFile = std::make_unique<File>();
-    newFile->name = destInfo.name;
-    newFile->createdAt = std::chrono::system_clock::now();
-    newFile->modifiedAt = std::chrono::system_clock::now();
-    
-    auto result = allocateFileMemory(*newFile, srcFile->memoryToken, srcFile->contentSize);
+    if (!withinQuota(*destInfo.folder, 1, srcFile->content->size())) return quotaExceeded(destPath);
+    auto newFile = makeFile(NodeName(destInfo.name));
+    copyFileMeta(*srcFile, *newFile);
+    auto result = copyFileContent(*srcFile, *newFile);
     if (result != Response::OK) {
         return result;
     }
     
+    File* copy = newFile.get();
     destInfo.folder->files.push_back(std::move(newFile));
-    destInfo.folder->modifiedAt = std::chrono::system_clock::now();
+    adjustUsage(*destInfo.folder, 0, 1, static_cast<int64_t>(copy->content->size()));
+    indexCopy(*srcFile, *destInfo.folder, *copy);
+    markModified(*destInfo.folder);
+    journalOp(JournalOp::CopyFile, srcPath, destPath);
 
     logInfo("Copied file '" + srcPath + "' to '" + destPath + "'");
     return Response::OK;
 }
 
 Response StorageManager::moveFile(const std::string& srcPath, const std::string& destPath) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     // validate inputs
     if (srcPath.empty() || destPath.empty()) {
         return Response::InvalidArgument;
@@ -349,7 +539,7 @@ Response StorageManager::moveFile(const std::string& srcPath, const std::string&
     // find source file
     int srcIndex = -1;
     for (size_t i = 0; i < srcInfo.folder->files.size(); ++i) {
-        if (srcInfo.folder->files[i]->name == srcInfo.name) {
+        if (srcInfo.folder->files[i]->name == srcInfo.key) {
             srcIndex = static_cast<int>(i);
             break;
         }
@@ -370,7 +560,7 @@ Response StorageManager::moveFile(const std::string& srcPath, const std::string&
     // check if destination is an existing directory
     Folder* targetDir = nullptr;
     for (const auto& sub : destInfo.folder->subfolders) {
-        if (sub->name == destInfo.name) {
+        if (sub->name == destInfo.key) {
             targetDir = sub.get();
             break;
         }
@@ -379,18 +569,28 @@ Response StorageManager::moveFile(const std::string& srcPath, const std::string&
     if (targetDir) {
         // dest is a directory, move file into it with original name
         for (const auto& f : targetDir->files) {
-            if (f->name == srcInfo.name) {
-                logError("File already exists: " + srcInfo.name);
+            if (f->name == srcInfo.key) {
+                logError("File already exists: " + std::string(srcInfo.name));
                 return Response::AlreadyExists;
             }
         }
         
+        if (!withinQuota(*targetDir, 1, srcInfo.folder->files[srcIndex]->content->size(), srcInfo.folder)) {
+            return quotaExceeded(destPath);
+        }
         auto filePtr = std::move(srcInfo.folder->files[srcIndex]);
         srcInfo.folder->files.erase(srcInfo.folder->files.begin() + srcIndex);
+        int64_t movedBytes = static_cast<int64_t>(filePtr->content->size());
+        adjustUsage(*srcInfo.folder, 0, -1, -movedBytes);
+        adjustUsage(*targetDir, 0, 1, movedBytes);
+        // new to its folder, so the next delta carries its content
+        filePtr->dirty = true;
+        indexMoved(*filePtr, *targetDir);
         targetDir->files.push_back(std::move(filePtr));
         
-        srcInfo.folder->modifiedAt = std::chrono::system_clock::now();
-        targetDir->modifiedAt = std::chrono::system_clock::now();
+        markModified(*srcInfo.folder);
+        markModified(*targetDir);
+        journalOp(JournalOp::MoveFile, srcPath, destPath);
         
         logInfo("Moved file '" + srcPath + "' into directory '" + destPath + "'");
         return Response::OK;
@@ -398,20 +598,30 @@ Response StorageManager::moveFile(const std::string& srcPath, const std::string&
     
     // dest is not a directory, rename/move to exact path
     for (const auto& file : destInfo.folder->files) {
-        if (file->name == destInfo.name) {
+        if (file->name == destInfo.key) {
             logError("Destination file already exists: " + destPath);
             return Response::AlreadyExists;
         }
     }
 
+    if (!withinQuota(*destInfo.folder, 1, srcInfo.folder->files[srcIndex]->content->size(), srcInfo.folder)) {
+        return quotaExceeded(destPath);
+    }
     auto filePtr = std::move(srcInfo.folder->files[srcIndex]);
     srcInfo.folder->files.erase(srcInfo.folder->files.begin() + srcIndex);
+    int64_t movedBytes = static_cast<int64_t>(filePtr->content->size());
+    adjustUsage(*srcInfo.folder, 0, -1, -movedBytes);
+    adjustUsage(*destInfo.folder, 0, 1, movedBytes);
     filePtr->name = destInfo.name;
     filePtr->modifiedAt = std::chrono::system_clock::now();
+    filePtr->version = nextFileVersion();
+    filePtr->dirty = true;
+    indexMoved(*filePtr, *destInfo.folder);
     destInfo.folder->files.push_back(std::move(filePtr));
     
-    srcInfo.folder->modifiedAt = std::chrono::system_clock::now();
-    destInfo.folder->modifiedAt = std::chrono::system_clock::now();
+    markModified(*srcInfo.folder);
+    markModified(*destInfo.folder);
+    journalOp(JournalOp::MoveFile, srcPath, destPath);
 
     logInfo("Moved file '" + srcPath + "' to '" + destPath + "'");
     return Response::OK;
@@ -1,38 +1,106 @@
 #include "storage/Storage.h"
+#include "common/TimeUtils.h"
 #include <sstream>
 
 namespace storage {
 
 using Response = StorageManager::StorageResponse;
 
-int StorageManager::findFolderIndex(const std::string& name) const {
-    for (size_t i = 0; i < currentFolder->subfolders.size(); ++i)
-        if (currentFolder->subfolders[i]->name == name)
-            return static_cast<int>(i);
-    return -1;
-}
+namespace {
+
+// Frees contents dropped while it lives in bulk, see ContentAllocator
+class BatchedFrees {
+public:
+    explicit BatchedFrees(ContentAllocator& allocator) : allocator(allocator) { allocator.beginBatch(); }
+    ~BatchedFrees() { allocator.endBatch(); }
+    BatchedFrees(const BatchedFrees&) = delete;
+    BatchedFrees& operator=(const BatchedFrees&) = delete;
+
+private:
+    ContentAllocator& allocator;
+};
+
+}  // namespace
 
 Response StorageManager::recursiveDelete(Folder& folder) {
-    while (!folder.files.empty()) {
-        std::string fileName = folder.files.front()->name;
-        Response res = deleteFile(folder, fileName);
-        if (res != Response::OK) {
-            logError("Failed to delete file '" + fileName + "' during recursiveDelete");
-            return res;
-        }
+    // Detach the subtree and drop it one folder at a time: every node is
+    // visited once, nothing is searched for, and the contents' memory goes
+    // back in bulk frees rather than one syscall per extent
+    BatchedFrees frees(contentAllocator);
+    uint64_t fileCount = folder.files.size();
+    uint64_t folderCount = 0;
+    for (const auto& file : folder.files) unindexFile(*file);
+    folder.files.clear();
+    std::vector<std::unique_ptr<Folder>> pending = std::move(folder.subfolders);
+    folder.subfolders.clear();
+    while (!pending.empty()) {
+        std::unique_ptr<Folder> next = std::move(pending.back());
+        pending.pop_back();
+        ++folderCount;
+        fileCount += next->files.size();
+        for (const auto& file : next->files) unindexFile(*file);
+        next->files.clear();
+        for (auto& sub : next->subfolders) pending.push_back(std::move(sub));
+    }
+    logDebug("Deleted " + std::to_string(fileCount) + " files in " + std::to_string(folderCount) + " folders");
+    return Response::OK;
+}
+
+// Totals change on the way up only: every change walks its folder's
+// ancestors once, so the cost is the depth and never the subtree size.
+// Negative deltas wrap, which unsigned addition undoes.
+void StorageManager::adjustUsage(Folder& folder, int64_t folders, int64_t files, int64_t bytes) {
+    if (folders == 0 && files == 0 && bytes == 0) return;
+    for (Folder* f = &folder; f; f = f->parent) {
+        f->usage.folders += static_cast<uint64_t>(folders);
+        f->usage.files += static_cast<uint64_t>(files);
+        f->usage.bytes += static_cast<uint64_t>(bytes);
     }
-    for (auto& sub : folder.subfolders) {
-        logDebug("Recursively deleting folder: " + sub->name);
-        Response res = recursiveDelete(*sub);
-        if (res != Response::OK) {
-            return res;
+}
+
+void StorageManager::addUsage(Folder& folder, const DirUsage& usage) {
+    adjustUsage(folder, static_cast<int64_t>(usage.folders), static_cast<int64_t>(usage.files),
+                static_cast<int64_t>(usage.bytes));
+}
+
+void StorageManager::subtractUsage(Folder& folder, const DirUsage& usage) {
+    adjustUsage(folder, -static_cast<int64_t>(usage.folders), -static_cast<int64_t>(usage.files),
+                -static_cast<int64_t>(usage.bytes));
+}
+
+void StorageManager::contentResized(Folder& folder, const File& file, uint64_t oldSize) {
+    adjustUsage(folder, 0, 0, static_cast<int64_t>(file.content->size() - oldSize));
+}
+
+void StorageManager::recountUsage(Folder& top) {
+    // preorder, then summed up in reverse so children come before parents
+    std::vector<Folder*> order{&top};
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (const auto& sub : order[i]->subfolders) order.push_back(sub.get());
+    }
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        Folder& folder = **it;
+        folder.usage = DirUsage{1, folder.files.size(), 0};
+        for (const auto& file : folder.files) folder.usage.bytes += file->content->size();
+        for (const auto& sub : folder.subfolders) {
+            folder.usage.folders += sub->usage.folders;
+            folder.usage.files += sub->usage.files;
+            folder.usage.bytes += sub->usage.bytes;
         }
     }
-    folder.subfolders.clear();
+}
+
+Response StorageManager::dirUsage(const std::string& path, DirUsage& outUsage) const {
+    TreeLock lock(*this, TreeLock::Shared);
+    const Folder* start = findFolder(path);
+    if (!start) return Response::NotFound;
+
+    outUsage = start->usage;
     return Response::OK;
 }
 
 Response StorageManager::makeDir(const std::string& path) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     if (path.empty() || isNameInvalid(path)) {
         return Response::InvalidArgument;
     }
@@ -45,12 +113,14 @@ Response StorageManager::makeDir(const std::string& path) {
     
     // check if directory already exists
     for (const auto& sub : info.folder->subfolders) {
-        if (sub->name == info.name) {
+        if (sub->name == info.key) {
             logError("Directory already exists: " + path);
             return Response::AlreadyExists;
         }
     }
 
+    if (!withinQuota(*info.folder, 1, 0)) return quotaExceeded(path);
+
     auto folder = std::make_unique<Folder>();
     folder->name = info.name;
     folder->parent = info.folder;
@@ -58,12 +128,15 @@ Response StorageManager::makeDir(const std::string& path) {
     folder->modifiedAt = folder->createdAt;
 
     info.folder->subfolders.push_back(std::move(folder));
-    info.folder->modifiedAt = std::chrono::system_clock::now();
+    adjustUsage(*info.folder, 1, 0, 0);
+    markModified(*info.folder);
+    journalOp(JournalOp::MakeDir, path);
     logInfo("Created directory: " + path);
     return Response::OK;
 }
 
 Response StorageManager::removeDir(const std::string& path) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     if (path.empty() || isNameInvalid(path)) {
         return Response::InvalidArgument;
     }
@@ -76,29 +149,27 @@ Response StorageManager::removeDir(const std::string& path) {
     
     if (isNameInvalid(info.name)) return Response::InvalidArgument;
 
+    // resolved now: removing the working directory moves it
+    std::string journalPath = journal ? absolutePath(path) : std::string();
+
     // find and remove directory
     for (size_t i = 0; i < info.folder->subfolders.size(); ++i) {
-        if (info.folder->subfolders[i]->name == info.name) {
+        if (info.folder->subfolders[i]->name == info.key) {
             Folder* toDelete = info.folder->subfolders[i].get();
 
-            // if we are currently inside the deleted folder or one of its subfolders
-            Folder* tmp = currentFolder;
-            while (tmp != nullptr) {
-                if (tmp == toDelete) {
-                    // jump up to parent or root if deleting current
-                    currentFolder = info.folder; 
-                    break;
-                }
-                tmp = tmp->parent;
-            }
+            // threads working inside the deleted folder jump up to its parent
+            relocateWorkingDirs(toDelete, info.folder);
 
+            DirUsage removed = toDelete->usage;
             Response delRes = recursiveDelete(*toDelete);
             if (delRes != Response::OK) {
                 logError("Failed to recursively delete directory: " + path);
                 return delRes;
             }
             info.folder->subfolders.erase(info.folder->subfolders.begin() + i);
-            info.folder->modifiedAt = std::chrono::system_clock::now();
+            subtractUsage(*info.folder, removed);
+            markModified(*info.folder);
+            journalOp(JournalOp::RemoveDir, journalPath);
             logInfo("Removed directory: " + path);
             return Response::OK;
         }
@@ -111,18 +182,25 @@ Response StorageManager::removeDir(const std::string& path) {
 Response StorageManager::changeDir(const std::string& path) {
     if (isNameInvalid(path)) return Response::InvalidArgument;
     
+    // only this thread's working directory moves, which needs no exclusive hold
+    TreeLock lock(*this, TreeLock::Shared);
+    ThreadView& view = threadView();
+    Folder* current = workingFolder();
+
     // handle special case "/"
     if (path == "/") {
-        currentFolder = root.get();
+        view.cwd = root.get();
+        view.cwdKeyValid = false;
         logInfo("Changed directory to: /");
         return Response::OK;
     }
     
     // handle special case ".."
     if (path == "..") {
-        if (currentFolder->parent == nullptr) return Response::AtRoot;
-        currentFolder = currentFolder->parent;
-        logInfo("Changed directory to: " + currentFolder->name);
+        if (current->parent == nullptr) return Response::AtRoot;
+        view.cwd = current->parent;
+        view.cwdKeyValid = false;
+        logInfo("Changed directory to: " + view.cwd->name);
         return Response::OK;
     }
     
@@ -131,81 +209,38 @@ Response StorageManager::changeDir(const std::string& path) {
         return Response::OK;
     }
     
-    // handle paths with slashes - need custom navigation for cd
-    if (path.find('/') != std::string::npos || path[0] == '/') {
-        bool isAbsolute = (path[0] == '/');
-        Folder* current = isAbsolute ? root.get() : currentFolder;
-        
-        // split path by '/'
-        std::vector<std::string> parts;
-        std::string part;
-        
-        for (char c : path) {
-            if (c == '/') {
-                if (!part.empty()) {
-                    parts.push_back(part);
-                    part.clear();
-                }
-            } else {
-                part += c;
-            }
-        }
-        if (!part.empty()) {
-            parts.push_back(part);
-        }
-        
-        // navigate through all parts
-        for (const std::string& dirName : parts) {
-            if (dirName == ".") {
-                continue;
-            } else if (dirName == "..") {
-                if (current->parent) {
-                    current = current->parent;
-                } else {
-                    return Response::AtRoot;
-                }
-            } else {
-                // find subfolder
-                bool found = false;
-                for (auto& sub : current->subfolders) {
-                    if (sub->name == dirName) {
-                        current = sub.get();
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found) {
-                    logError("Directory not found: " + path);
-                    return Response::NotFound;
-                }
-            }
-        }
-        
-        currentFolder = current;
-        logInfo("Changed directory to: " + currentFolder->name);
-        return Response::OK;
+    bool isAbsolute = (path[0] == '/');
+    Folder* target = nullptr;
+    if (path.find("..") != std::string::npos) {
+        // parent references must fail at root instead of clamping like parsePath does
+        Response status;
+        target = walkPath(isAbsolute ? root.get() : current, path, true, status);
+        if (status == Response::AtRoot) return Response::AtRoot;
+    } else {
+        target = resolveDirectory(path, isAbsolute);
     }
-    
-    // single directory name in current folder
-    int i = findFolderIndex(path);
-    if (i == -1) {
+    if (!target) {
         logError("Directory not found: " + path);
         return Response::NotFound;
     }
-    currentFolder = currentFolder->subfolders[i].get();
-    logInfo("Changed directory to: " + currentFolder->name);
+
+    view.cwd = target;
+    view.cwdKeyValid = false;
+    logInfo("Changed directory to: " + target->name);
     return Response::OK;
 }
 
-Response StorageManager::listDir(const std::string& path, std::vector<std::string>& outEntries) const {
+Response StorageManager::listDirEntries(const std::string& path, std::vector<DirEntry>& outEntries) const {
+    TreeLock lock(*this, TreeLock::Shared);
     outEntries.clear();
-    Folder* targetFolder = nullptr;
-    
+    const Folder* targetFolder = nullptr;
+    const Folder* current = workingFolder();
+
     // handle special cases
     if (path == "." || path.empty()) {
-        targetFolder = currentFolder;
+        targetFolder = current;
     } else if (path == "..") {
-        targetFolder = currentFolder->parent ? currentFolder->parent : currentFolder;
+        targetFolder = current->parent ? current->parent : current;
     } else {
         PathInfo info = parsePath(path);
         
@@ -216,47 +251,58 @@ Response StorageManager::listDir(const std::string& path, std::vector<std::strin
         if (info.name.empty()) {
             targetFolder = info.folder;
         } else {
-            for (const auto& sub : info.folder->subfolders) {
-                if (sub->name == info.name) {
-                    targetFolder = sub.get();
-                    break;
-                }
-            }
-            
+            targetFolder = findSubfolder(*info.folder, info.key);
             if (!targetFolder) {
                 return Response::NotFound;
             }
         }
     }
-    
-    // list the target folder's contents
-    for (auto& f : targetFolder->subfolders) {
-        std::ostringstream line;
-        line << "[D] " << f->name
-             << " | created: " << formatTime(f->createdAt)
-             << " | modified: " << formatTime(f->modifiedAt);
-        outEntries.push_back(line.str());
-    }
-    for (auto& fl : targetFolder->files) {
-        std::ostringstream line;
-        line << "[F] " << fl->name
-             << " | created: " << formatTime(fl->createdAt)
-             << " | modified: " << formatTime(fl->modifiedAt)
-             << " | size: " << fl->contentSize << " bytes";
-        outEntries.push_back(line.str());
+
+    outEntries.reserve(targetFolder->subfolders.size() + targetFolder->files.size());
+    for (const auto& f : targetFolder->subfolders) {
+        outEntries.push_back({f->name, true, f->usage.bytes, f->usage.files, f->createdAt, f->modifiedAt});
+    }
+    for (const auto& fl : targetFolder->files) {
+        outEntries.push_back({fl->name, false, fl->content->size(), 0, fl->createdAt, fl->modifiedAt});
+    }
+    return Response::OK;
+}
+
+Response StorageManager::listDir(const std::string& path, std::vector<std::string>& outEntries) const {
+    TreeLock lock(*this, TreeLock::Shared);
+    outEntries.clear();
+    std::vector<DirEntry> entries;
+    Response result = listDirEntries(path, entries);
+    if (result != Response::OK) return result;
+
+    common::TimeFormatCache times;
+    outEntries.reserve(entries.size());
+    for (const auto& entry : entries) {
+        std::string line = entry.isFolder ? "[D] " : "[F] ";
+        line += entry.name;
+        line += " | created: ";
+        line += times.format(entry.createdAt);
+        line += " | modified: ";
+        line += times.format(entry.modifiedAt);
+        if (!entry.isFolder) {
+            line += " | size: ";
+            line += std::to_string(entry.size);
+            line += " bytes";
+        }
+        outEntries.push_back(std::move(line));
     }
-    
     return Response::OK;
 }
 
 std::string StorageManager::getWorkingDir() const {
     std::ostringstream path;
+    TreeLock lock(*this, TreeLock::Shared);
     std::vector<std::string> parts;
-    auto* tmp = currentFolder;
+    auto* tmp = workingFolder();
     
     while (tmp) {
         if (tmp->name != "/") {
-            parts.push_back(tmp->name);
+            parts.push_back(tmp->name.str());
         }
         tmp = tmp->parent;
     }
@@ -273,28 +319,8 @@ std::string StorageManager::getWorkingDir() const {
     return path.str();
 }
 
-void StorageManager::recursiveCopyDir(const Folder& src, Folder& destParent) {
-    auto target = std::make_unique<Folder>();
-    target->name = src.name;
-    target->parent = &destParent;
-    target->createdAt = std::chrono::system_clock::now();
-    target->modifiedAt = std::chrono::system_clock::now();
-
-    for (const auto& f : src.files) {
-        auto fileCopy = std::make_unique<File>(*f);
-        fileCopy->createdAt = std::chrono::system_clock::now();
-        fileCopy->modifiedAt = std::chrono::system_clock::now();
-        target->files.push_back(std::move(fileCopy));
-    }
-
-    for (const auto& sub : src.subfolders) {
-        recursiveCopyDir(*sub, *target);
-    }
-
-    destParent.subfolders.push_back(std::move(target));
-}
-
 Response StorageManager::copyDir(const std::string& srcPath, const std::string& destPath) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     // validate inputs
     if (srcPath.empty() || destPath.empty()) {
         return Response::InvalidArgument;
@@ -310,7 +336,7 @@ Response StorageManager::copyDir(const std::string& srcPath, const std::string&
     // find source folder
     Folder* srcFolder = nullptr;
     for (const auto& sub : srcInfo.folder->subfolders) {
-        if (sub->name == srcInfo.name) {
+        if (sub->name == srcInfo.key) {
             srcFolder = sub.get();
             break;
         }
@@ -331,7 +357,7 @@ Response StorageManager::copyDir(const std::string& srcPath, const std::string&
     // check if destination is an existing directory
     Folder* targetDir = nullptr;
     for (const auto& sub : destInfo.folder->subfolders) {
-        if (sub->name == destInfo.name) {
+        if (sub->name == destInfo.key) {
             targetDir = sub.get();
             break;
         }
@@ -340,14 +366,22 @@ Response StorageManager::copyDir(const std::string& srcPath, const std::string&
     if (targetDir) {
         // dest is a directory, copy dir into it with original name
         for (const auto& sub : targetDir->subfolders) {
-            if (sub->name == srcInfo.name) {
-                logError("Directory already exists: " + srcInfo.name);
+            if (sub->name == srcInfo.key) {
+                logError("Directory already exists: " + std::string(srcInfo.name));
                 return Response::AlreadyExists;
             }
         }
         
-        recursiveCopyDir(*srcFolder, *targetDir);
-        targetDir->modifiedAt = std::chrono::system_clock::now();
+        if (!withinQuota(*targetDir, srcFolder->usage.folders + srcFolder->usage.files, srcFolder->usage.bytes)) {
+            return quotaExceeded(destPath);
+        }
+        Response res = copySubtree(*srcFolder, *targetDir, srcFolder->name);
+        if (res != Response::OK) {
+            logError("Failed to copy directory '" + srcPath + "'");
+            return res;
+        }
+        markModified(*targetDir);
+        journalOp(JournalOp::CopyDir, srcPath, destPath);
         
         logInfo("Copied directory '" + srcPath + "' into '" + destPath + "'");
         return Response::OK;
@@ -355,21 +389,29 @@ Response StorageManager::copyDir(const std::string& srcPath, const std::string&
     
     // dest is not a directory - copy with new name
     for (const auto& sub : destInfo.folder->subfolders) {
-        if (sub->name == destInfo.name) {
+        if (sub->name == destInfo.key) {
             logError("Destination directory already exists: " + destPath);
             return Response::AlreadyExists;
         }
     }
 
-    recursiveCopyDir(*srcFolder, *destInfo.folder);
-    destInfo.folder->subfolders.back()->name = destInfo.name;
-    destInfo.folder->modifiedAt = std::chrono::system_clock::now();
+    if (!withinQuota(*destInfo.folder, srcFolder->usage.folders + srcFolder->usage.files, srcFolder->usage.bytes)) {
+        return quotaExceeded(destPath);
+    }
+    Response res = copySubtree(*srcFolder, *destInfo.folder, destInfo.name);
+    if (res != Response::OK) {
+        logError("Failed to copy directory '" + srcPath + "'");
+        return res;
+    }
+    markModified(*destInfo.folder);
+    journalOp(JournalOp::CopyDir, srcPath, destPath);
 
     logInfo("Copied directory '" + srcPath + "' to '" + destPath + "'");
     return Response::OK;
 }
 
 Response StorageManager::moveDir(const std::string& srcPath, const std::string& destPath) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     // validate inputs
     if (srcPath.empty() || destPath.empty()) {
         return Response::InvalidArgument;
@@ -385,7 +427,7 @@ Response StorageManager::moveDir(const std::string& srcPath, const std::string&
     // find source folder
     int srcIndex = -1;
     for (size_t i = 0; i < srcInfo.folder->subfolders.size(); ++i) {
-        if (srcInfo.folder->subfolders[i]->name == srcInfo.name) {
+        if (srcInfo.folder->subfolders[i]->name == srcInfo.key) {
             srcIndex = static_cast<int>(i);
             break;
         }
@@ -406,7 +448,7 @@ Response StorageManager::moveDir(const std::string& srcPath, const std::string&
     // check if destination is an existing directory
     Folder* targetDir = nullptr;
     for (const auto& sub : destInfo.folder->subfolders) {
-        if (sub->name == destInfo.name) {
+        if (sub->name == destInfo.key) {
             targetDir = sub.get();
             break;
         }
@@ -415,7 +457,7 @@ Response StorageManager::moveDir(const std::string& srcPath, const std::string&
     // Only block if destination is inside the source folder (or is the source itself)
     Folder* srcFolder = nullptr;
     for (const auto& sub : srcInfo.folder->subfolders) {
-        if (sub->name == srcInfo.name) {
+        if (sub->name == srcInfo.key) {
             srcFolder = sub.get();
             break;
         }
@@ -425,26 +467,40 @@ Response StorageManager::moveDir(const std::string& srcPath, const std::string&
         return Response::NotFound;
     }
     if (isDescendantOrSame(srcFolder, destInfo.folder)) {
-        logError("cannot move '" + srcInfo.name + "' to a subdirectory of itself, '" + destPath + "'");
+        logError("cannot move '" + std::string(srcInfo.name) + "' to a subdirectory of itself, '" + destPath + "'");
         return Response::InvalidArgument;
     }
 
+    // resolved now: moving an ancestor of the working directory changes its path
+    std::string journalSrc = journal ? absolutePath(srcPath) : std::string();
+    std::string journalDest = journal ? absolutePath(destPath) : std::string();
+
     if (targetDir) {
         // dest is a directory, move dir into it with original name
         for (const auto& sub : targetDir->subfolders) {
-            if (sub->name == srcInfo.name) {
-                logError("Directory already exists: " + srcInfo.name);
+            if (sub->name == srcInfo.key) {
+                logError("Directory already exists: " + std::string(srcInfo.name));
                 return Response::AlreadyExists;
             }
         }
 
+        if (!withinQuota(*targetDir, srcFolder->usage.folders + srcFolder->usage.files, srcFolder->usage.bytes,
+                         srcInfo.folder)) {
+            return quotaExceeded(destPath);
+        }
+        invalidateDentryCache();
         auto folderPtr = std::move(srcInfo.folder->subfolders[srcIndex]);
         srcInfo.folder->subfolders.erase(srcInfo.folder->subfolders.begin() + srcIndex);
+        subtractUsage(*srcInfo.folder, folderPtr->usage);
+        addUsage(*targetDir, folderPtr->usage);
         folderPtr->parent = targetDir;
+        // nothing under the new path is in the last snapshot
+        markSubtreeDirty(*folderPtr);
         targetDir->subfolders.push_back(std::move(folderPtr));
         
-        srcInfo.folder->modifiedAt = std::chrono::system_clock::now();
-        targetDir->modifiedAt = std::chrono::system_clock::now();
+        markModified(*srcInfo.folder);
+        markModified(*targetDir);
+        journalOp(JournalOp::MoveDir, journalSrc, journalDest);
         
         logInfo("Moved directory '" + srcPath + "' into '" + destPath + "'");
         return Response::OK;
@@ -452,21 +508,30 @@ Response StorageManager::moveDir(const std::string& srcPath, const std::string&
     
     // dest is not a directory, rename/move with new name
     for (const auto& sub : destInfo.folder->subfolders) {
-        if (sub->name == destInfo.name) {
+        if (sub->name == destInfo.key) {
             logError("Destination directory already exists: " + destPath);
             return Response::AlreadyExists;
         }
     }
 
+    if (!withinQuota(*destInfo.folder, srcFolder->usage.folders + srcFolder->usage.files, srcFolder->usage.bytes,
+                     srcInfo.folder)) {
+        return quotaExceeded(destPath);
+    }
+    invalidateDentryCache();
     auto folderPtr = std::move(srcInfo.folder->subfolders[srcIndex]);
     srcInfo.folder->subfolders.erase(srcInfo.folder->subfolders.begin() + srcIndex);
+    subtractUsage(*srcInfo.folder, folderPtr->usage);
+    addUsage(*destInfo.folder, folderPtr->usage);
     folderPtr->name = destInfo.name;
     folderPtr->parent = destInfo.folder;
     folderPtr->modifiedAt = std::chrono::system_clock::now();
+    markSubtreeDirty(*folderPtr);
     destInfo.folder->subfolders.push_back(std::move(folderPtr));
     
-    srcInfo.folder->modifiedAt = std::chrono::system_clock::now();
-    destInfo.folder->modifiedAt = std::chrono::system_clock::now();
+    markModified(*srcInfo.folder);
+    markModified(*destInfo.folder);
+    journalOp(JournalOp::MoveDir, journalSrc, journalDest);
 
     logInfo("Moved directory '" + srcPath + "' to '" + destPath + "'");
     return Response::OK;
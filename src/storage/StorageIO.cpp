@@ -1,161 +1,127 @@
 #include "storage/Storage.h"
-#include "kernel/SysCallsAPI.h"
+#include "storage/SnapshotEncoding.h"
+#include <cstdio>
 #include <fstream>
 #include <sstream>
-#include <cstring>
 
 namespace storage {
 
-using json = nlohmann::json;
 using Response = StorageManager::StorageResponse;
 
-static json serializeFolder(const StorageManager::Folder& folder) {
-    json j;
-    j["name"] = folder.name;
-    j["createdAt"] = std::chrono::duration_cast<std::chrono::seconds>(
-                         folder.createdAt.time_since_epoch())
-                         .count();
-    j["modifiedAt"] = std::chrono::duration_cast<std::chrono::seconds>(
-                          folder.modifiedAt.time_since_epoch())
-                          .count();
-    j["files"] = json::array();
-    j["subfolders"] = json::array();
-
-    for (auto& f : folder.files) {
-        json jf;
-        jf["name"] = f->name;
-        if (f->memoryToken && f->contentSize > 0) {
-            const char* src = static_cast<const char*>(f->memoryToken);
-            jf["content"] = std::string(src, f->contentSize);
-        } else {
-            jf["content"] = "";
-        }
-        jf["createdAt"] = std::chrono::duration_cast<std::chrono::seconds>(
-                              f->createdAt.time_since_epoch())
-                              .count();
-        jf["modifiedAt"] = std::chrono::duration_cast<std::chrono::seconds>(
-                               f->modifiedAt.time_since_epoch())
-                               .count();
-        j["files"].push_back(jf);
+std::string StorageManager::findHostPath(const std::string& name, bool directory) {
+    if (std::filesystem::path(name).is_absolute()) {
+        return name;
     }
-
-    for (auto& sub : folder.subfolders)
-        j["subfolders"].push_back(serializeFolder(*sub));
-
-    return j;
-}
-
-static std::unique_ptr<StorageManager::Folder> deserializeFolder(
-    const json& j, StorageManager::Folder* parent, sys::SysApi* sysApi) {
-    auto folder = std::make_unique<StorageManager::Folder>();
-    folder->name = j.at("name");
-    folder->parent = parent;
-
-    folder->createdAt = std::chrono::system_clock::time_point(
-        std::chrono::seconds(j.value("createdAt", 0LL)));
-    folder->modifiedAt = std::chrono::system_clock::time_point(
-        std::chrono::seconds(j.value("modifiedAt", 0LL)));
-
-    for (const auto& jf : j["files"]) {
-        auto f = std::make_unique<StorageManager::File>();
-        f->name = jf.at("name");
-        // Load content from JSON and allocate memory for it
-        std::string content = jf.at("content");
-        if (!content.empty() && sysApi) {
-            f->memoryToken = sysApi->allocateMemory(content.size(), 0);
-            if (f->memoryToken) {
-                std::memcpy(f->memoryToken, content.c_str(), content.size());
-                f->contentSize = content.size();
-            } else {
-                // Failed to allocate - file will have no content
-                f->memoryToken = nullptr;
-                f->contentSize = 0;
-            }
-        } else {
-            f->memoryToken = nullptr;
-            f->contentSize = 0;
+    for (const std::string& candidate : {name, "/app/data/" + name, "data/" + name}) {
+        if (directory ? std::filesystem::is_directory(candidate) : std::filesystem::is_regular_file(candidate)) {
+            return candidate;
         }
-        f->createdAt = std::chrono::system_clock::time_point(
-            std::chrono::seconds(jf.value("createdAt", 0LL)));
-        f->modifiedAt = std::chrono::system_clock::time_point(
-            std::chrono::seconds(jf.value("modifiedAt", 0LL)));
-        folder->files.push_back(std::move(f));
     }
+    return name;
+}
 
-    for (const auto& sub : j["subfolders"])
-        folder->subfolders.push_back(deserializeFolder(sub, folder.get(), sysApi));
-
-    return folder;
+static bool isBinarySnapshotName(const std::string& fileName) {
+    return fileName.ends_with(".bin");
 }
 
-Response StorageManager::saveToDisk(const std::string& fileName) const {
+Response StorageManager::saveToDisk(const std::string& fileName, bool incremental, bool compress) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     try {
-        std::filesystem::create_directories("data");
-        std::string path = "data/" + fileName;
-        if (path.find(".json") == std::string::npos) path += ".json";
+        finishBackgroundSave();
+        std::string name = fileName;
+        if (incremental) {
+            // deltas exist only for binary snapshots
+            if (name.ends_with(".json")) return Response::InvalidArgument;
+            if (!isBinarySnapshotName(name)) name += ".bin";
+        }
 
-        std::ofstream out(path);
-        if (!out.is_open()) {
-            return Response::Error;
+        std::filesystem::create_directories("data");
+        std::string path = "data/" + name;
+        Response result;
+        if (!isBinarySnapshotName(name)) {
+            if (path.find(".json") == std::string::npos) path += ".json";
+            result = saveJsonSnapshot(path, compress);
+        } else if (incremental && isDeltaBase(path)) {
+            result = saveDeltaSegment(path);
+        } else {
+            uint32_t snapshotId = snapshot::newSnapshotId();
+            result = saveBinarySnapshot(path, snapshotId, compress, encodeIndex());
+            if (result == Response::OK) {
+                trackDeltaBase(path, snapshotId);
+            }
         }
-        out << std::setw(4) << serializeFolder(*root);
-        if (!out) {
-            return Response::Error;
+        // the snapshot now holds everything the journal recorded
+        if (result == Response::OK) {
+            journalCheckpoint(name);
         }
-        return Response::OK;
+        return result;
     } catch (...) {
         return Response::Error;
     }
 }
 
-Response StorageManager::loadFromDisk(const std::string& fileName) {
+Response StorageManager::loadFromDisk(const std::string& fileName, bool lazy) {
+    TreeLock lock(*this, TreeLock::Exclusive);
     try {
+        finishBackgroundSave();
+        auto loadBinary = [this, lazy](const std::string& name) {
+            Response result = loadBinarySnapshot(findHostPath(name, false), lazy);
+            if (result == Response::OK) {
+                journalCheckpoint(name);
+            }
+            return result;
+        };
+
+        if (isBinarySnapshotName(fileName)) {
+            return loadBinary(fileName);
+        }
+
         std::string fileNameWithExt = fileName;
         if (fileNameWithExt.find(".json") == std::string::npos) {
             fileNameWithExt += ".json";
         }
 
-        std::string content;
-        auto readResult = readFileFromHost(fileNameWithExt, content);
-        if (readResult != Response::OK) {
-            return readResult;
+        // JSON snapshots always load eagerly
+        auto result = loadJsonSnapshot(findHostPath(fileNameWithExt, false));
+        if (result == Response::NotFound && fileNameWithExt != fileName) {
+            // bare name without a JSON snapshot, try the binary one
+            return loadBinary(fileName + ".bin");
         }
-
-        // Parse the JSON content
-        json j = json::parse(content);
-        root = deserializeFolder(j, nullptr, sysApi);
-        currentFolder = root.get();
-        return Response::OK;
+        if (result == Response::OK) {
+            deltaBasePath.clear();  // the next incremental save writes a full base
+            journalCheckpoint(fileNameWithExt);
+        }
+        return result;
     } catch (...) {
         return Response::Error;
     }
 }
 
+void StorageManager::recordSnapshotStats(const std::string& action, const std::string& path, uint64_t rawBytes,
+                                         uint64_t storedBytes, bool compressed,
+                                         std::chrono::steady_clock::time_point started) {
+    snapshotStats.rawBytes = rawBytes;
+    snapshotStats.storedBytes = storedBytes;
+    snapshotStats.elapsed = std::chrono::steady_clock::now() - started;
+    snapshotStats.compressed = compressed;
+
+    double seconds = std::chrono::duration<double>(snapshotStats.elapsed).count();
+    double rawMb = static_cast<double>(rawBytes) / (1024.0 * 1024.0);
+    double throughput = seconds > 0 ? rawMb / seconds : 0.0;
+    char summary[128];
+    if (compressed) {
+        double ratio = storedBytes > 0 ? static_cast<double>(rawBytes) / static_cast<double>(storedBytes) : 0.0;
+        std::snprintf(summary, sizeof(summary), "%.2f MB compressed to %.2f MB (%.2fx) at %.1f MB/s", rawMb,
+                      static_cast<double>(storedBytes) / (1024.0 * 1024.0), ratio, throughput);
+    } else {
+        std::snprintf(summary, sizeof(summary), "%.2f MB at %.1f MB/s", rawMb, throughput);
+    }
+    logInfo(action + " " + path + ": " + summary);
+}
+
 Response StorageManager::readFileFromHost(const std::string& hostFileName, std::string& outContent) {
     try {
-        std::ifstream file;
-        
-        std::filesystem::path filePath(hostFileName);
-        if (filePath.is_absolute()) {
-            // Use the path directly
-            file.open(hostFileName);
-        } else {
-            // For relative paths, try in this order:
-            // 1. Current directory / near executable
-            file.open(hostFileName);
-            
-            if (!file.is_open()) {
-                // 2. Try Docker/container path
-                std::string dataPath = "/app/data/" + hostFileName;
-                file.open(dataPath);
-                
-                if (!file.is_open()) {
-                    // 3. Try local development data folder
-                    dataPath = "data/" + hostFileName;
-                    file.open(dataPath);
-                }
-            }
-        }
+        std::ifstream file(findHostPath(hostFileName, false));
         
         if (!file.is_open()) {
             return Response::NotFound;
@@ -186,10 +152,12 @@ Response StorageManager::listDataFiles(std::vector<std::string>& outFiles) const
         outFiles.clear();
 
         for (auto& entry : std::filesystem::directory_iterator(dataDir)) {
-            if (entry.is_regular_file() &&
-                entry.path().extension() == ".json") {
-                std::string fileName = entry.path().stem().string();
-                outFiles.push_back(fileName);
+            if (!entry.is_regular_file()) continue;
+            // binary snapshots keep their extension so they can be told apart
+            if (entry.path().extension() == ".json") {
+                outFiles.push_back(entry.path().stem().string());
+            } else if (entry.path().extension() == ".bin") {
+                outFiles.push_back(entry.path().filename().string());
             }
         }
 
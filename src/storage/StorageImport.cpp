@@ -0,0 +1,264 @@
+#include "storage/Storage.h"
+#include "common/WorkerPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+namespace storage {
+
+using Response = StorageManager::StorageResponse;
+
+// An import runs in three steps, like a directory copy. The calling thread
+// walks the host directory and builds the new subtree on its own, taking
+// simulated memory for every file at its host size. The worker pool then
+// reads the files straight into those extents with unbuffered sequential
+// reads, so every byte is copied once, and hashes them for dedup. Only
+// then is the tree held, to check the target and quotas and attach the
+// subtree; nobody waits on the host disk.
+
+namespace {
+
+// One read task covers up to this many extents of a file (4MB)
+constexpr size_t IMPORT_CHUNK_EXTENTS = 64;
+
+struct ReadChunk {
+    size_t file;
+    size_t offset;
+    size_t firstExtent;
+    size_t extentCount;
+    size_t bytesRead = 0;
+};
+
+std::chrono::system_clock::time_point hostTime(const std::filesystem::file_time_type& time) {
+    return std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+        std::chrono::file_clock::to_sys(time));
+}
+
+}  // namespace
+
+struct StorageManager::ImportPlan {
+    struct HostFile {
+        std::filesystem::path hostPath;
+        Folder* folder;
+        File* file;
+        uint64_t hash = 0;
+    };
+    std::vector<HostFile> files;
+    std::vector<ReadChunk> chunks;
+    uint64_t skipped = 0;
+};
+
+bool StorageManager::buildImport(const std::filesystem::path& dir, Folder& folder, ImportPlan& plan) {
+    std::error_code error;
+    std::vector<std::filesystem::directory_entry> entries;
+    for (std::filesystem::directory_iterator it(dir, error), end; !error && it != end; it.increment(error)) {
+        entries.push_back(*it);
+    }
+    if (error) ++plan.skipped;
+    // host listing order is arbitrary; keep imports repeatable
+    std::sort(entries.begin(), entries.end(),
+              [](const auto& a, const auto& b) { return a.path().filename() < b.path().filename(); });
+
+    for (const auto& entry : entries) {
+        std::string name = entry.path().filename().string();
+        auto modified = entry.last_write_time(error);
+        if (error || isNameInvalid(name) || entry.is_symlink(error)) {
+            ++plan.skipped;
+            continue;
+        }
+        auto stamp = hostTime(modified);
+
+        if (entry.is_directory(error)) {
+            auto sub = std::make_unique<Folder>();
+            sub->name = name;
+            sub->parent = &folder;
+            sub->createdAt = stamp;
+            sub->modifiedAt = stamp;
+            Folder& added = *sub;
+            folder.subfolders.push_back(std::move(sub));
+            if (!buildImport(entry.path(), added, plan)) return false;
+            continue;
+        }
+
+        bool regular = entry.is_regular_file(error);
+        uint64_t size = regular && !error ? entry.file_size(error) : 0;
+        if (error || !regular) {
+            ++plan.skipped;
+            continue;
+        }
+        auto file = makeFile(NodeName(name), stamp);
+        if (!file->content->allocateUninitialized(size)) {
+            logError("Out of memory importing: " + entry.path().string());
+            return false;
+        }
+        size_t index = plan.files.size();
+        size_t offset = 0;
+        const auto& extents = file->content->getExtents();
+        for (size_t first = 0; first < extents.size(); first += IMPORT_CHUNK_EXTENTS) {
+            ReadChunk chunk{index, offset, first, std::min(IMPORT_CHUNK_EXTENTS, extents.size() - first)};
+            for (size_t i = 0; i < chunk.extentCount; ++i) offset += extents[first + i].size;
+            plan.chunks.push_back(chunk);
+        }
+        plan.files.push_back({entry.path(), &folder, file.get()});
+        folder.files.push_back(std::move(file));
+    }
+    return true;
+}
+
+Response StorageManager::importTree(const std::string& hostDir, const std::string& path, ImportStats& outStats) {
+    if (hostDir.empty() || path.empty() || isNameInvalid(path)) {
+        return Response::InvalidArgument;
+    }
+    std::filesystem::path source(findHostPath(hostDir, true));
+    std::error_code error;
+    auto sourceTime = std::filesystem::last_write_time(source, error);
+    if (error || !std::filesystem::is_directory(source, error)) {
+        logError("Host directory not found: " + hostDir);
+        return Response::NotFound;
+    }
+
+    try {
+        auto started = std::chrono::steady_clock::now();
+        ImportPlan plan;
+        // dropping the subtree before it is attached frees what it took
+        auto subtree = std::make_unique<Folder>();
+        subtree->createdAt = hostTime(sourceTime);
+        subtree->modifiedAt = subtree->createdAt;
+        Folder& imported = *subtree;
+        if (!buildImport(source, imported, plan)) return Response::Error;
+
+        common::WorkerPool::shared().parallelFor(plan.chunks.size(), [&plan](size_t i) {
+            ReadChunk& chunk = plan.chunks[i];
+            const auto& extents = plan.files[chunk.file].file->content->getExtents();
+            std::FILE* in = std::fopen(plan.files[chunk.file].hostPath.string().c_str(), "rb");
+            if (!in) return;
+            // reads go straight into the extents, past the stdio buffer
+            std::setvbuf(in, nullptr, _IONBF, 0);
+            if (chunk.offset == 0 || std::fseek(in, static_cast<long>(chunk.offset), SEEK_SET) == 0) {
+                for (size_t e = chunk.firstExtent; e < chunk.firstExtent + chunk.extentCount; ++e) {
+                    size_t got = std::fread(extents[e].memoryToken, 1, extents[e].size, in);
+                    chunk.bytesRead += got;
+                    if (got < extents[e].size) break;
+                }
+            }
+            std::fclose(in);
+        });
+
+        // a file that shrank or could not be read keeps what was read in order
+        for (size_t c = 0; c < plan.chunks.size();) {
+            size_t file = plan.chunks[c].file;
+            size_t valid = 0;
+            bool whole = true;
+            for (; c < plan.chunks.size() && plan.chunks[c].file == file; ++c) {
+                const ReadChunk& chunk = plan.chunks[c];
+                size_t expected = 0;
+                const auto& extents = plan.files[file].file->content->getExtents();
+                for (size_t e = 0; e < chunk.extentCount; ++e) expected += extents[chunk.firstExtent + e].size;
+                if (whole) valid += chunk.bytesRead;
+                whole = whole && chunk.bytesRead == expected;
+            }
+            if (!whole) {
+                logWarn("Host file changed or unreadable during import: " + plan.files[file].hostPath.string());
+                plan.files[file].file->content->resize(valid);
+            }
+        }
+
+        bool hashed = false;
+        {
+            TreeLock lock(*this, TreeLock::Shared);
+            hashed = dedupEnabled;
+        }
+        if (hashed) {
+            common::WorkerPool::shared().parallelFor(plan.files.size(), [&plan](size_t i) {
+                plan.files[i].hash = plan.files[i].file->content->hash();
+            });
+        }
+        recountUsage(imported);
+
+        TreeLock lock(*this, TreeLock::Exclusive);
+        PathInfo info = parsePath(path);
+        if (!info.folder) {
+            logError("Path not found: " + path);
+            return Response::NotFound;
+        }
+        if (isNameInvalid(info.name)) return Response::InvalidArgument;
+        bool taken = findSubfolder(*info.folder, info.key) != nullptr ||
+                     std::any_of(info.folder->files.begin(), info.folder->files.end(),
+                                 [&](const auto& file) { return file->name == info.key; });
+        if (taken) {
+            logError("Destination already exists: " + path);
+            return Response::AlreadyExists;
+        }
+        if (!withinQuota(*info.folder, imported.usage.folders + imported.usage.files, imported.usage.bytes)) {
+            return quotaExceeded(path);
+        }
+
+        for (auto& hostFile : plan.files) {
+            if (!dedupEnabled) break;
+            if (!hashed) hostFile.hash = hostFile.file->content->hash();
+            std::shared_ptr<FileContent>& content = hostFile.file->content;
+            const FileContent& fresh = *content;
+            auto duplicate = findDuplicate(hostFile.hash,
+                                           [&fresh](const FileContent& candidate) { return candidate.equals(fresh); });
+            if (duplicate) {
+                content = std::move(duplicate);
+            } else {
+                registerContent(hostFile.hash, content);
+            }
+        }
+
+        subtree->name = info.name;
+        subtree->parent = info.folder;
+        for (auto& hostFile : plan.files) indexFile(*hostFile.folder, *hostFile.file);
+        addUsage(*info.folder, subtree->usage);
+        info.folder->subfolders.push_back(std::move(subtree));
+        markModified(*info.folder);
+
+        if (journal) {
+            // replayed as the folders and writes the import amounts to
+            std::string top = absolutePath(path);
+            std::string content;
+            std::vector<std::pair<const Folder*, std::string>> pending{{&imported, top}};
+            while (!pending.empty()) {
+                auto [folder, folderPath] = pending.back();
+                pending.pop_back();
+                journalOp(JournalOp::MakeDir, folderPath);
+                for (const auto& file : folder->files) {
+                    std::string filePath = folderPath + "/" + file->name;
+                    journalOp(JournalOp::CreateFile, filePath);
+                    if (file->ownerUid != 0 || file->ownerPid != 0) journalFileMeta(filePath, *file);
+                    if (file->content->empty()) continue;
+                    content.clear();
+                    file->content->appendTo(content);
+                    journalOp(JournalOp::WriteFileAt, filePath, content, 0);
+                }
+                for (auto it = folder->subfolders.rbegin(); it != folder->subfolders.rend(); ++it) {
+                    pending.emplace_back(it->get(), folderPath + "/" + (*it)->name);
+                }
+            }
+        }
+
+        outStats.folders = imported.usage.folders;
+        outStats.files = imported.usage.files;
+        outStats.bytes = imported.usage.bytes;
+        outStats.skipped = plan.skipped;
+        outStats.elapsed = std::chrono::steady_clock::now() - started;
+
+        double seconds = std::chrono::duration<double>(outStats.elapsed).count();
+        std::ostringstream summary;
+        summary << "Imported " << source.string() << " to " << path << ": " << outStats.files << " files in "
+                << outStats.folders << " folders (" << outStats.bytes << " bytes) in " << std::fixed
+                << std::setprecision(3) << seconds * 1000.0 << " ms";
+        if (seconds > 0) {
+            summary << ", " << std::setprecision(0) << outStats.files / seconds << " files/s, "
+                    << std::setprecision(1) << outStats.bytes / seconds / (1024.0 * 1024.0) << " MB/s";
+        }
+        logInfo(summary.str());
+        return Response::OK;
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+}  // namespace storage
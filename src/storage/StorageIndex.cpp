@@ -0,0 +1,196 @@
+#include "storage/Storage.h"
+#include <iomanip>
+#include <sstream>
+
+namespace storage {
+
+using Response = StorageManager::StorageResponse;
+
+// Files are numbered for the index by pointer. A number stays with its
+// file through renames, moves and writes, and is released when the file is
+// deleted, so a freed File can never be found under an old number. Paths
+// are put together from the folder chain only for the files a search
+// returns.
+
+void StorageManager::setIndexing(bool enabled) {
+    TreeLock lock(*this, TreeLock::Exclusive);
+    if (enabled == isIndexing()) return;
+    if (enabled) {
+        textIndex = std::make_unique<TextIndex>();
+        rebuildIndex();
+    } else {
+        textIndex.reset();
+        indexIds.clear();
+        indexedFiles.clear();
+        freeIndexIds.clear();
+        logInfo("Full-text index disabled");
+    }
+}
+
+TextIndex::DocId StorageManager::indexIdFor(Folder& folder, const File& file) {
+    auto known = indexIds.find(&file);
+    if (known != indexIds.end()) {
+        indexedFiles[known->second].folder = &folder;
+        return known->second;
+    }
+    TextIndex::DocId id;
+    if (!freeIndexIds.empty()) {
+        id = freeIndexIds.back();
+        freeIndexIds.pop_back();
+    } else {
+        id = static_cast<TextIndex::DocId>(indexedFiles.size());
+        indexedFiles.emplace_back();
+    }
+    indexedFiles[id] = {&file, &folder};
+    indexIds.emplace(&file, id);
+    return id;
+}
+
+void StorageManager::indexFile(Folder& folder, const File& file) {
+    if (!textIndex) return;
+    textIndex->index(indexIdFor(folder, file), *file.content);
+}
+
+void StorageManager::indexAppended(Folder& folder, const File& file, uint64_t oldSize) {
+    if (!textIndex) return;
+    textIndex->indexAppended(indexIdFor(folder, file), *file.content, oldSize);
+}
+
+void StorageManager::indexCopy(const File& src, Folder& folder, const File& copy) {
+    if (!textIndex) return;
+    TextIndex::DocId copyId = indexIdFor(folder, copy);
+    auto source = indexIds.find(&src);
+    if (source != indexIds.end()) textIndex->copy(source->second, copyId);
+}
+
+void StorageManager::indexCopiedSubtree(const Folder& src, Folder& copy) {
+    if (!textIndex) return;
+    // the copy has the same shape as its source, entry for entry
+    std::vector<std::pair<const Folder*, Folder*>> pending{{&src, &copy}};
+    while (!pending.empty()) {
+        auto [from, to] = pending.back();
+        pending.pop_back();
+        for (size_t i = 0; i < from->files.size(); ++i) indexCopy(*from->files[i], *to, *to->files[i]);
+        for (size_t i = 0; i < from->subfolders.size(); ++i) {
+            pending.emplace_back(from->subfolders[i].get(), to->subfolders[i].get());
+        }
+    }
+}
+
+void StorageManager::indexMoved(const File& file, Folder& folder) {
+    if (!textIndex) return;
+    auto known = indexIds.find(&file);
+    if (known != indexIds.end()) indexedFiles[known->second].folder = &folder;
+}
+
+void StorageManager::unindexFile(const File& file) {
+    if (!textIndex) return;
+    auto known = indexIds.find(&file);
+    if (known == indexIds.end()) return;
+    textIndex->remove(known->second);
+    indexedFiles[known->second] = {};
+    freeIndexIds.push_back(known->second);
+    indexIds.erase(known);
+}
+
+void StorageManager::rebuildIndex() {
+    if (!textIndex) return;
+    auto started = std::chrono::steady_clock::now();
+    textIndex->clear();
+    indexIds.clear();
+    indexedFiles.clear();
+    freeIndexIds.clear();
+
+    uint64_t bytes = 0;
+    std::vector<Folder*> pending{root.get()};
+    while (!pending.empty()) {
+        Folder* folder = pending.back();
+        pending.pop_back();
+        for (const auto& file : folder->files) {
+            indexFile(*folder, *file);
+            bytes += file->content->size();
+        }
+        for (const auto& sub : folder->subfolders) pending.push_back(sub.get());
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::ostringstream summary;
+    summary << "Indexed " << indexedFiles.size() << " files (" << bytes << " bytes, " << textIndex->termCount()
+            << " terms) in " << std::fixed << std::setprecision(1) << seconds * 1000.0 << " ms";
+    logInfo(summary.str());
+}
+
+std::string StorageManager::encodeIndex() const {
+    std::string section;
+    if (!textIndex) return section;
+
+    // the order saveBinarySnapshot writes file records in
+    std::unordered_map<const File*, uint64_t> ordinals;
+    std::vector<const Folder*> pending{root.get()};
+    while (!pending.empty()) {
+        const Folder* folder = pending.back();
+        pending.pop_back();
+        for (const auto& file : folder->files) ordinals.emplace(file.get(), ordinals.size());
+        for (auto it = folder->subfolders.rbegin(); it != folder->subfolders.rend(); ++it) {
+            pending.push_back(it->get());
+        }
+    }
+
+    textIndex->encode(section, [&](TextIndex::DocId doc) {
+        auto ordinal = ordinals.find(indexedFiles[doc].file);
+        return ordinal != ordinals.end() ? ordinal->second : TextIndex::NO_KEY;
+    });
+    return section;
+}
+
+bool StorageManager::decodeIndex(const char* data, uint64_t size, std::vector<IndexedFile> files) {
+    if (!textIndex) return false;
+    indexIds.clear();
+    freeIndexIds.clear();
+    indexedFiles = std::move(files);
+    if (!textIndex->decode(data, size, indexedFiles.size())) {
+        indexedFiles.clear();
+        return false;
+    }
+    for (size_t i = 0; i < indexedFiles.size(); ++i) {
+        indexIds.emplace(indexedFiles[i].file, static_cast<TextIndex::DocId>(i));
+    }
+    return true;
+}
+
+Response StorageManager::searchIndex(const std::string& query, const IndexCallback& onHit) const {
+    TreeLock lock(*this, TreeLock::Shared);
+    if (!textIndex) return Response::Error;
+    std::vector<std::string> terms = TextIndex::tokenize(query);
+    if (terms.empty()) return Response::InvalidArgument;
+
+    std::string path;
+    std::vector<const Folder*> chain;
+    textIndex->search(terms, [&](TextIndex::DocId doc, std::span<const uint64_t> offsets) {
+        const IndexedFile& entry = indexedFiles[doc];
+        chain.clear();
+        for (const Folder* f = entry.folder; f && f->parent; f = f->parent) chain.push_back(f);
+        path.clear();
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            path += '/';
+            path += (*it)->name;
+        }
+        path += '/';
+        path += entry.file->name;
+        return onHit(IndexHit{path, offsets});
+    });
+    return Response::OK;
+}
+
+StorageManager::IndexStats StorageManager::indexStats() const {
+    TreeLock lock(*this, TreeLock::Shared);
+    IndexStats stats;
+    if (!textIndex) return stats;
+    stats.enabled = true;
+    stats.files = indexIds.size();
+    stats.terms = textIndex->termCount();
+    stats.postings = textIndex->postingCount();
+    return stats;
+}
+
+}  // namespace storage
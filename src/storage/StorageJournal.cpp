@@ -0,0 +1,198 @@
+#include "storage/Storage.h"
+#include "storage/MappedFile.h"
+#include "storage/SnapshotEncoding.h"
+
+namespace storage {
+
+using Response = StorageManager::StorageResponse;
+using namespace snapshot;
+
+// Journal record payload: u8 op, u64 offset (WriteFileAt only), then two
+// strings. The first is always an absolute path; the second is a second
+// path for copies and moves, the data for writes, and empty otherwise.
+// SetQuota keeps the byte limit in the offset and the inode limit, as a
+// u64, in the second string. SetFileMeta keeps the mode in the offset and
+// the owner, u32 uid then i32 pid, in the second string; it follows every
+// change of a file's mode and every file created for someone other than
+// the kernel.
+
+namespace {
+
+// Snapshot a new journal starts from when the tree already has content
+constexpr const char* JOURNAL_CHECKPOINT = "journal_checkpoint.bin";
+
+}  // namespace
+
+std::string StorageManager::absolutePath(const std::string& path) const {
+    if (!path.empty() && path[0] == '/') return path;
+    return workingDirKey() + "/" + path;
+}
+
+void StorageManager::journalOp(JournalOp op, const std::string& path, const std::string& arg, uint64_t offset) {
+    if (!journal) return;
+
+    bool argIsPath = op == JournalOp::CopyFile || op == JournalOp::MoveFile ||
+                     op == JournalOp::CopyDir || op == JournalOp::MoveDir;
+    std::string record;
+    record.push_back(static_cast<char>(op));
+    put64(record, offset);
+    putString(record, absolutePath(path));
+    putString(record, argIsPath ? absolutePath(arg) : arg);
+    if (!journal->append(record)) {
+        logError("Failed to write journal " + journal->path());
+    }
+}
+
+void StorageManager::journalFileMeta(const std::string& path, const File& file) {
+    if (!journal) return;
+    std::string owner;
+    put32(owner, file.ownerUid);
+    put32(owner, static_cast<uint32_t>(file.ownerPid));
+    journalOp(JournalOp::SetFileMeta, path, owner, file.mode);
+}
+
+void StorageManager::journalCheckpoint(const std::string& snapshotName) {
+    if (journal && !journal->restart(snapshotName)) {
+        logError("Failed to restart journal " + journal->path());
+    }
+}
+
+Response StorageManager::openJournal(const std::string& path, const JournalOptions& options) {
+    TreeLock lock(*this, TreeLock::Exclusive);
+    try {
+        closeJournal();
+
+        if (std::filesystem::exists(path)) {
+            uint64_t validBytes = 0;
+            Response result = replayJournal(path, validBytes);
+            if (result != Response::OK) {
+                return result;
+            }
+            journal = Journal::resume(path, validBytes, options);
+        } else {
+            std::string snapshotName;
+            if (!root->files.empty() || !root->subfolders.empty()) {
+                snapshotName = JOURNAL_CHECKPOINT;
+                Response result = saveToDisk(snapshotName);
+                if (result != Response::OK) {
+                    return result;
+                }
+            }
+            if (path.find('/') != std::string::npos) {
+                std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+            }
+            journal = Journal::create(path, snapshotName, options);
+        }
+
+        if (!journal) {
+            logError("Failed to open journal " + path);
+            return Response::Error;
+        }
+        logInfo("Journaling storage changes to " + path);
+        return Response::OK;
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+void StorageManager::closeJournal() {
+    TreeLock lock(*this, TreeLock::Exclusive);
+    // a running save restarts the journal when it lands
+    finishBackgroundSave();
+    if (journal && !journal->commit()) {
+        logError("Failed to write journal " + journal->path());
+    }
+    journal.reset();
+}
+
+Response StorageManager::replayJournal(const std::string& path, uint64_t& outValidBytes) {
+    auto mapping = MappedFile::open(path);
+    if (!mapping) {
+        return Response::NotFound;
+    }
+    const char* data = mapping->data();
+    uint64_t size = mapping->size();
+
+    std::string snapshotName;
+    uint64_t offset = 0;
+    if (!Journal::readHeader(data, size, snapshotName, offset)) {
+        logError("Not a storage journal: " + path);
+        return Response::Error;
+    }
+
+    // the journal is not open yet, so nothing below is journaled again
+    Response result = snapshotName.empty() ? reset() : loadFromDisk(snapshotName);
+    if (result != Response::OK) {
+        logError("Journal base snapshot could not be loaded: " + snapshotName);
+        return result;
+    }
+
+    // files made below belong to whoever the records say, not to this thread
+    ThreadView& view = threadView();
+    uint32_t callerUid = view.callerUid;
+    int32_t callerPid = view.callerPid;
+    setCaller(0, 0);
+
+    size_t replayed = 0;
+    size_t failed = 0;
+    std::string_view payload;
+    uint64_t next = 0;
+    while (Journal::readRecord(data, size, offset, payload, next)) {
+        Reader reader(payload.data(), payload.size());
+        auto op = static_cast<JournalOp>(reader.u8());
+        uint64_t position = reader.u64();
+        std::string first(reader.string());
+        std::string second(reader.string());
+        if (!reader.ok()) break;
+        offset = next;
+
+        switch (op) {
+            case JournalOp::CreateFile: result = createFile(first); break;
+            case JournalOp::TouchFile: result = touchFile(first); break;
+            case JournalOp::DeleteFile: result = deleteFile(first); break;
+            case JournalOp::WriteFile: result = writeFile(first, second); break;
+            case JournalOp::EditFile: result = editFile(first, second); break;
+            case JournalOp::AppendFile: result = appendFile(first, second); break;
+            case JournalOp::WriteFileAt: result = writeFileAt(first, position, second); break;
+            case JournalOp::CopyFile: result = copyFile(first, second); break;
+            case JournalOp::MoveFile: result = moveFile(first, second); break;
+            case JournalOp::MakeDir: result = makeDir(first); break;
+            case JournalOp::RemoveDir: result = removeDir(first); break;
+            case JournalOp::CopyDir: result = copyDir(first, second); break;
+            case JournalOp::MoveDir: result = moveDir(first, second); break;
+            case JournalOp::SetQuota:
+                result = second.size() == 8 ? setQuota(first, {position, get64(second.data())})
+                                            : Response::InvalidArgument;
+                break;
+            case JournalOp::SetFileMeta:
+                if (second.size() != 8 || position > MAX_FILE_MODE) {
+                    result = Response::InvalidArgument;
+                    break;
+                }
+                result = updateFileMeta(first, [&](File& file) {
+                    file.mode = static_cast<uint16_t>(position);
+                    file.ownerUid = get32(second.data());
+                    file.ownerPid = static_cast<int32_t>(get32(second.data() + 4));
+                });
+                break;
+            default: result = Response::InvalidArgument; break;
+        }
+        ++replayed;
+        if (result != Response::OK) ++failed;
+    }
+    setCaller(callerUid, callerPid);
+
+    if (offset < size) {
+        logWarn("Discarding " + std::to_string(size - offset) + " bytes of torn journal records in " + path);
+    }
+    if (failed > 0) {
+        logWarn(std::to_string(failed) + " journal records did not apply cleanly");
+    }
+    relocateWorkingDirs(nullptr, nullptr);
+    outValidBytes = offset;
+    logInfo("Replayed " + std::to_string(replayed) + " journal records on top of " +
+            (snapshotName.empty() ? std::string("an empty tree") : snapshotName));
+    return Response::OK;
+}
+
+}  // namespace storage
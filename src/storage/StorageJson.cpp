@@ -0,0 +1,500 @@
+#include "storage/Storage.h"
+#include "storage/Compression.h"
+#include "storage/MappedFile.h"
+#include <cstdio>
+#include <fstream>
+#include <optional>
+
+namespace storage {
+
+using json = nlohmann::json;
+using Response = StorageManager::StorageResponse;
+
+// JSON snapshots are streamed in both directions: the writer walks the tree
+// and emits text as it goes, the loader builds folders and files from SAX
+// events. Neither holds more than one file's content at a time.
+//
+// The output matches what dumping the whole tree as an nlohmann::json with
+// setw(4) used to produce (sorted keys, four space indent), so snapshots
+// saved before and after this change are interchangeable.
+
+namespace {
+
+constexpr size_t WRITE_CHUNK_SIZE = 64 * 1024;
+
+long long toSeconds(std::chrono::system_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point fromSeconds(long long seconds) {
+    return std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+}
+
+// Buffers text in fixed-size chunks and escapes strings the way
+// nlohmann's dump does. Strings must be valid UTF-8, as the parser rejects
+// anything else; invalid input fails the save instead of writing a
+// snapshot that cannot be loaded back.
+class JsonStreamWriter {
+public:
+    JsonStreamWriter(std::ostream& out, const std::function<void(uint64_t)>& progress)
+        : out(out), progress(progress) {
+        buffer.reserve(WRITE_CHUNK_SIZE);
+    }
+
+    bool ok() const { return valid && out.good(); }
+
+    // Reports file content bytes written so far to the progress callback
+    void contentWritten(size_t bytes) {
+        contentBytes += bytes;
+        if (progress) progress(contentBytes);
+    }
+
+    void raw(std::string_view text) {
+        buffer.append(text);
+        if (buffer.size() >= WRITE_CHUNK_SIZE) flush();
+    }
+
+    void indent(int depth) { buffer.append(static_cast<size_t>(depth) * 4, ' '); }
+
+    void key(int depth, std::string_view name) {
+        indent(depth);
+        buffer += '"';
+        buffer.append(name);
+        buffer += "\": ";
+    }
+
+    void number(long long value) { raw(std::to_string(value)); }
+
+    void string(std::string_view text) {
+        beginString();
+        escape(text.data(), text.size());
+        endString();
+    }
+
+    void beginString() {
+        buffer += '"';
+        continuations = 0;
+    }
+
+    // May be called several times per string; a multibyte sequence can be
+    // split across calls
+    void escape(const char* data, size_t size) {
+        size_t runStart = 0;
+        for (size_t i = 0; i < size; ++i) {
+            auto byte = static_cast<unsigned char>(data[i]);
+            if (continuations == 0 && byte >= 0x20 && byte < 0x80 && byte != '"' && byte != '\\') {
+                continue;
+            }
+            buffer.append(data + runStart, i - runStart);
+            runStart = i + 1;
+            if (continuations > 0 || byte >= 0x80) {
+                utf8Byte(byte);
+                continue;
+            }
+            switch (byte) {
+                case '"': buffer += "\\\""; break;
+                case '\\': buffer += "\\\\"; break;
+                case '\b': buffer += "\\b"; break;
+                case '\f': buffer += "\\f"; break;
+                case '\n': buffer += "\\n"; break;
+                case '\r': buffer += "\\r"; break;
+                case '\t': buffer += "\\t"; break;
+                default: {
+                    char escaped[7];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", byte);
+                    buffer += escaped;
+                }
+            }
+            if (buffer.size() >= WRITE_CHUNK_SIZE) flush();
+        }
+        buffer.append(data + runStart, size - runStart);
+        if (buffer.size() >= WRITE_CHUNK_SIZE) flush();
+    }
+
+    void endString() {
+        if (continuations != 0) valid = false;  // truncated multibyte sequence
+        buffer += '"';
+    }
+
+    void flush() {
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+
+private:
+    // RFC 3629: no overlong forms, no surrogates, nothing above U+10FFFF
+    void utf8Byte(unsigned char byte) {
+        if (continuations > 0) {
+            if (byte < nextLow || byte > nextHigh) {
+                valid = false;
+                continuations = 0;
+                return;
+            }
+            buffer += static_cast<char>(byte);
+            --continuations;
+            nextLow = 0x80;
+            nextHigh = 0xBF;
+            return;
+        }
+
+        nextLow = 0x80;
+        nextHigh = 0xBF;
+        if (byte >= 0xC2 && byte <= 0xDF) {
+            continuations = 1;
+        } else if (byte >= 0xE0 && byte <= 0xEF) {
+            continuations = 2;
+            if (byte == 0xE0) nextLow = 0xA0;
+            if (byte == 0xED) nextHigh = 0x9F;
+        } else if (byte >= 0xF0 && byte <= 0xF4) {
+            continuations = 3;
+            if (byte == 0xF0) nextLow = 0x90;
+            if (byte == 0xF4) nextHigh = 0x8F;
+        } else {
+            valid = false;
+            return;
+        }
+        buffer += static_cast<char>(byte);
+    }
+
+    std::ostream& out;
+    const std::function<void(uint64_t)>& progress;
+    uint64_t contentBytes = 0;
+    std::string buffer;
+    int continuations = 0;
+    unsigned char nextLow = 0x80;
+    unsigned char nextHigh = 0xBF;
+    bool valid = true;
+};
+
+void writeFolder(JsonStreamWriter& writer, const StorageManager::Folder& folder, int depth) {
+    writer.raw("{\n");
+    writer.key(depth + 1, "createdAt");
+    writer.number(toSeconds(folder.createdAt));
+    writer.raw(",\n");
+
+    writer.key(depth + 1, "files");
+    if (folder.files.empty()) {
+        writer.raw("[]");
+    } else {
+        writer.raw("[\n");
+        for (size_t i = 0; i < folder.files.size(); ++i) {
+            const auto& file = *folder.files[i];
+            writer.indent(depth + 2);
+            writer.raw("{\n");
+            writer.key(depth + 3, "content");
+            writer.beginString();
+            // straight from the extents (or mapping), never joined into one string
+            file.content->forEachSegment([&writer](const char* bytes, size_t count) {
+                writer.escape(bytes, count);
+            });
+            writer.endString();
+            writer.contentWritten(file.content->size());
+            writer.raw(",\n");
+            writer.key(depth + 3, "createdAt");
+            writer.number(toSeconds(file.createdAt));
+            writer.raw(",\n");
+            // mode and owner only when not the defaults, like quotas
+            if (file.mode != StorageManager::DEFAULT_FILE_MODE) {
+                writer.key(depth + 3, "mode");
+                writer.number(file.mode);
+                writer.raw(",\n");
+            }
+            writer.key(depth + 3, "modifiedAt");
+            writer.number(toSeconds(file.modifiedAt));
+            writer.raw(",\n");
+            writer.key(depth + 3, "name");
+            writer.string(file.name);
+            if (file.ownerPid != 0) {
+                writer.raw(",\n");
+                writer.key(depth + 3, "ownerPid");
+                writer.number(file.ownerPid);
+            }
+            if (file.ownerUid != 0) {
+                writer.raw(",\n");
+                writer.key(depth + 3, "ownerUid");
+                writer.number(file.ownerUid);
+            }
+            writer.raw("\n");
+            writer.indent(depth + 2);
+            writer.raw(i + 1 < folder.files.size() ? "},\n" : "}\n");
+        }
+        writer.indent(depth + 1);
+        writer.raw("]");
+    }
+    writer.raw(",\n");
+
+    writer.key(depth + 1, "modifiedAt");
+    writer.number(toSeconds(folder.modifiedAt));
+    writer.raw(",\n");
+    writer.key(depth + 1, "name");
+    writer.string(folder.name);
+    writer.raw(",\n");
+    // only written when set, so trees without quotas save as they always did
+    if (folder.quota.bytes != 0) {
+        writer.key(depth + 1, "quotaBytes");
+        writer.number(static_cast<long long>(folder.quota.bytes));
+        writer.raw(",\n");
+    }
+    if (folder.quota.inodes != 0) {
+        writer.key(depth + 1, "quotaInodes");
+        writer.number(static_cast<long long>(folder.quota.inodes));
+        writer.raw(",\n");
+    }
+
+    writer.key(depth + 1, "subfolders");
+    if (folder.subfolders.empty()) {
+        writer.raw("[]");
+    } else {
+        writer.raw("[\n");
+        for (size_t i = 0; i < folder.subfolders.size(); ++i) {
+            writer.indent(depth + 2);
+            writeFolder(writer, *folder.subfolders[i], depth + 2);
+            writer.raw(i + 1 < folder.subfolders.size() ? ",\n" : "\n");
+        }
+        writer.indent(depth + 1);
+        writer.raw("]");
+    }
+    writer.raw("\n");
+    writer.indent(depth);
+    writer.raw("}");
+}
+
+// Builds the tree straight from parser events. Keys other than the ones a
+// snapshot uses are skipped along with whatever value they hold.
+class SnapshotSaxHandler : public nlohmann::json_sax<json> {
+public:
+    // sink fills a file's content from the snapshot's string
+    using ContentSink = std::function<void(StorageManager::File&, const std::string&)>;
+
+    SnapshotSaxHandler(ContentAllocator* allocator, ContentSink sink)
+        : allocator(allocator), contentSink(std::move(sink)) {}
+
+    std::unique_ptr<StorageManager::Folder> takeRoot() { return std::move(root); }
+    const std::string& error() const { return errorMessage; }
+
+    bool null() override { return scalar(); }
+    bool boolean(bool) override { return scalar(); }
+    bool number_float(number_float_t, const string_t&) override { return scalar(); }
+    bool binary(binary_t&) override { return scalar(); }
+
+    bool number_integer(number_integer_t value) override { return number(value); }
+    bool number_unsigned(number_unsigned_t value) override {
+        return number(static_cast<long long>(value));
+    }
+
+    bool string(string_t& value) override {
+        if (stack.empty()) return fail("snapshot root must be an object");
+        Frame& top = stack.back();
+        if (top.kind == Kind::Folder && currentKey == "name") {
+            top.folder->name = std::move(value);
+            top.named = true;
+        } else if (top.kind == Kind::File && currentKey == "name") {
+            top.file->name = std::move(value);
+            top.named = true;
+        } else if (top.kind == Kind::File && currentKey == "content") {
+            contentSink(*top.file, value);
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        if (stack.empty()) {
+            if (root) return fail("trailing data after snapshot");
+            root = std::make_unique<StorageManager::Folder>();
+            stack.push_back({Kind::Folder, root.get()});
+            return true;
+        }
+
+        Frame& top = stack.back();
+        if (top.kind == Kind::Files) {
+            auto file = std::make_unique<StorageManager::File>();
+            file->content = std::make_shared<FileContent>(allocator);
+            StorageManager::File* raw = file.get();
+            top.folder->files.push_back(std::move(file));
+            stack.push_back({Kind::File, top.folder, raw});
+        } else if (top.kind == Kind::Subfolders) {
+            auto folder = std::make_unique<StorageManager::Folder>();
+            folder->parent = top.folder;
+            StorageManager::Folder* raw = folder.get();
+            top.folder->subfolders.push_back(std::move(folder));
+            stack.push_back({Kind::Folder, raw});
+        } else {
+            stack.push_back({Kind::Skip});
+        }
+        return true;
+    }
+
+    bool key(string_t& value) override {
+        currentKey = std::move(value);
+        return true;
+    }
+
+    bool end_object() override {
+        if (stack.back().kind != Kind::Skip && !stack.back().named) {
+            return fail("folder or file without a name");
+        }
+        stack.pop_back();
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (stack.empty()) return fail("snapshot root must be an object");
+        Frame& top = stack.back();
+        if (top.kind == Kind::Folder && currentKey == "files") {
+            stack.push_back({Kind::Files, top.folder});
+        } else if (top.kind == Kind::Folder && currentKey == "subfolders") {
+            stack.push_back({Kind::Subfolders, top.folder});
+        } else {
+            stack.push_back({Kind::Skip});
+        }
+        return true;
+    }
+
+    bool end_array() override {
+        stack.pop_back();
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override {
+        return fail(ex.what());
+    }
+
+private:
+    enum class Kind { Folder, File, Files, Subfolders, Skip };
+
+    struct Frame {
+        Kind kind;
+        StorageManager::Folder* folder = nullptr;
+        StorageManager::File* file = nullptr;
+        bool named = false;
+    };
+
+    bool scalar() {
+        if (stack.empty()) return fail("snapshot root must be an object");
+        return true;
+    }
+
+    bool number(long long value) {
+        if (stack.empty()) return fail("snapshot root must be an object");
+        Frame& top = stack.back();
+        if (top.kind == Kind::Folder) {
+            if (currentKey == "createdAt") top.folder->createdAt = fromSeconds(value);
+            if (currentKey == "modifiedAt") top.folder->modifiedAt = fromSeconds(value);
+            if (currentKey == "quotaBytes" && value > 0) top.folder->quota.bytes = static_cast<uint64_t>(value);
+            if (currentKey == "quotaInodes" && value > 0) top.folder->quota.inodes = static_cast<uint64_t>(value);
+        } else if (top.kind == Kind::File) {
+            if (currentKey == "createdAt") top.file->createdAt = fromSeconds(value);
+            if (currentKey == "modifiedAt") top.file->modifiedAt = fromSeconds(value);
+            if (currentKey == "mode" && value >= 0 && value <= StorageManager::MAX_FILE_MODE) {
+                top.file->mode = static_cast<uint16_t>(value);
+            }
+            if (currentKey == "ownerUid" && value >= 0 && value <= UINT32_MAX) {
+                top.file->ownerUid = static_cast<uint32_t>(value);
+            }
+            if (currentKey == "ownerPid" && value >= INT32_MIN && value <= INT32_MAX) {
+                top.file->ownerPid = static_cast<int32_t>(value);
+            }
+        }
+        return true;
+    }
+
+    bool fail(std::string message) {
+        errorMessage = std::move(message);
+        return false;
+    }
+
+    ContentAllocator* allocator;
+    ContentSink contentSink;
+    std::unique_ptr<StorageManager::Folder> root;
+    std::vector<Frame> stack;
+    std::string currentKey;
+    std::string errorMessage;
+};
+
+}  // namespace
+
+Response StorageManager::saveJsonSnapshot(const std::string& path, bool compress) {
+    try {
+        auto started = std::chrono::steady_clock::now();
+        // Write next to the target and rename, so a failed save keeps the old snapshot
+        std::string tmpPath = path + ".tmp";
+        uint64_t rawBytes = 0;
+        {
+            std::ofstream file(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                return Response::Error;
+            }
+            std::optional<compression::CompressingStreamBuf> packer;
+            if (compress) packer.emplace(file);
+            std::ostream out(packer ? static_cast<std::streambuf*>(&*packer) : file.rdbuf());
+            JsonStreamWriter writer(out, saveProgress);
+            writeFolder(writer, *root, 0);
+            writer.flush();
+            bool ok = writer.ok() && (!packer || packer->finish());
+            file.flush();
+            if (!ok || !file) {
+                file.close();
+                std::filesystem::remove(tmpPath);
+                return Response::Error;
+            }
+            rawBytes = packer ? packer->rawBytes() : static_cast<uint64_t>(file.tellp());
+        }
+        std::filesystem::rename(tmpPath, path);
+        recordSnapshotStats("Saved", path, rawBytes, std::filesystem::file_size(path), compress, started);
+        return Response::OK;
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+Response StorageManager::loadJsonSnapshot(const std::string& path) {
+    try {
+        auto started = std::chrono::steady_clock::now();
+        auto mapping = MappedFile::open(path);
+        if (!mapping) {
+            return Response::NotFound;
+        }
+        if (mapping->size() == 0) {
+            return Response::InvalidArgument;
+        }
+        const char* text = mapping->data();
+        uint64_t textSize = mapping->size();
+        bool compressed = compression::isCompressed(text, textSize);
+        std::string decompressed;
+        if (compressed) {
+            if (!compression::decompress(text, textSize, decompressed)) {
+                logError("Corrupt compressed snapshot: " + path);
+                return Response::Error;
+            }
+            text = decompressed.data();
+            textSize = decompressed.size();
+        }
+
+        // identical contents end up sharing one copy, see setDedup
+        SnapshotSaxHandler handler(&contentAllocator, [this](File& file, const std::string& bytes) {
+            uint64_t hash = 0;
+            if (shareDuplicate(file, {bytes}, hash)) return;
+            if (!file.content->assign(bytes.data(), bytes.size())) {
+                // Failed to allocate - file will have no content
+                file.content->clear();
+            } else if (dedupEnabled) {
+                registerContent(hash, file.content);
+            }
+        });
+        if (!json::sax_parse(text, text + textSize, &handler)) {
+            logError("Failed to parse JSON snapshot: " + handler.error());
+            return Response::Error;
+        }
+
+        root = handler.takeRoot();
+        recountUsage(*root);
+        relocateWorkingDirs(nullptr, nullptr);
+        rebuildIndex();
+        recordSnapshotStats("Loaded", path, textSize, mapping->size(), compressed, started);
+        return Response::OK;
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+}  // namespace storage
@@ -0,0 +1,82 @@
+#include "storage/Storage.h"
+#include "storage/SnapshotEncoding.h"
+
+namespace storage {
+
+using Response = StorageManager::StorageResponse;
+
+// Quotas are checked against the running totals (see adjustUsage), so a
+// check reads one folder per level and never looks below the target.
+
+namespace {
+
+size_t depthOf(const StorageManager::Folder* folder) {
+    size_t depth = 0;
+    for (; folder->parent; folder = folder->parent) ++depth;
+    return depth;
+}
+
+// Deepest folder holding both a and b
+const StorageManager::Folder* commonAncestor(const StorageManager::Folder* a, const StorageManager::Folder* b) {
+    size_t depthA = depthOf(a);
+    size_t depthB = depthOf(b);
+    for (; depthA > depthB; --depthA) a = a->parent;
+    for (; depthB > depthA; --depthB) b = b->parent;
+    while (a != b) {
+        a = a->parent;
+        b = b->parent;
+    }
+    return a;
+}
+
+}  // namespace
+
+bool StorageManager::withinQuota(const Folder& folder, uint64_t inodes, uint64_t bytes, const Folder* from) {
+    const Folder* stop = from ? commonAncestor(&folder, from) : nullptr;
+    for (const Folder* f = &folder; f && f != stop; f = f->parent) {
+        const DirQuota& quota = f->quota;
+        if (quota.bytes != 0 && bytes > 0 && f->usage.bytes + bytes > quota.bytes) return false;
+        uint64_t entries = f->usage.folders - 1 + f->usage.files;
+        if (quota.inodes != 0 && inodes > 0 && entries + inodes > quota.inodes) return false;
+    }
+    return true;
+}
+
+Response StorageManager::quotaExceeded(const std::string& path) {
+    logError("Quota exceeded: " + path);
+    return Response::QuotaExceeded;
+}
+
+Response StorageManager::setQuota(const std::string& path, const DirQuota& quota) {
+    TreeLock lock(*this, TreeLock::Exclusive);
+    Folder* folder = findFolder(path);
+    if (!folder) {
+        logError("Directory not found: " + path);
+        return Response::NotFound;
+    }
+    folder->quota = quota;
+    // the next delta carries the folder's record, quota included
+    markDirty(*folder);
+
+    if (journal) {
+        std::string absolute;
+        for (const Folder* f = folder; f->parent; f = f->parent) absolute.insert(0, "/" + f->name);
+        if (absolute.empty()) absolute = "/";
+        std::string inodes;
+        snapshot::put64(inodes, quota.inodes);
+        journalOp(JournalOp::SetQuota, absolute, inodes, quota.bytes);
+    }
+    logInfo("Set quota on " + path + ": " + std::to_string(quota.bytes) + " bytes, " +
+            std::to_string(quota.inodes) + " inodes");
+    return Response::OK;
+}
+
+Response StorageManager::getQuota(const std::string& path, DirQuota& outQuota) const {
+    TreeLock lock(*this, TreeLock::Shared);
+    const Folder* folder = findFolder(path);
+    if (!folder) return Response::NotFound;
+    outQuota = folder->quota;
+    return Response::OK;
+}
+
+}  // namespace storage
@@ -0,0 +1,286 @@
+#include "storage/Storage.h"
+#include "storage/ByteSearch.h"
+#include <algorithm>
+#include <cstring>
+#include <regex>
+
+namespace storage {
+
+using Response = StorageManager::StorageResponse;
+
+// Searches walk the tree once with an explicit stack. Paths live in one
+// buffer that grows and shrinks with the walk, and every match is handed to
+// the caller as soon as it is found. Content search reads the stored pieces
+// (extents or the snapshot mapping) in place; only a line that straddles
+// two pieces is copied, to give the caller one contiguous view.
+
+namespace {
+
+// A content's pieces with their offsets, wherever the bytes live
+class Segments {
+public:
+    explicit Segments(const FileContent& content) {
+        content.forEachSegment([this](const char* bytes, size_t count) {
+            pieces.emplace_back(bytes, count);
+            starts.push_back(total);
+            total += count;
+        });
+    }
+
+    uint64_t size() const { return total; }
+
+    // First offset at or after from where needle starts, or size()
+    uint64_t find(uint64_t from, std::string_view needle, std::string& scratch) const {
+        if (needle.empty()) return std::min(from, total);
+        if (from >= total || needle.size() > total - from) return total;
+        for (size_t i = pieceAt(from); i < pieces.size(); ++i) {
+            uint64_t start = starts[i];
+            std::string_view piece = pieces[i];
+            uint64_t skip = from > start ? from - start : 0;
+            if (skip < piece.size()) {
+                const char* hit = search::findBytes(piece.data() + skip, piece.size() - skip, needle);
+                if (hit) return start + static_cast<uint64_t>(hit - piece.data());
+            }
+            // a match may also straddle the end of this piece
+            uint64_t end = start + piece.size();
+            if (needle.size() > 1 && end < total) {
+                uint64_t spanFrom = std::max(from, end - std::min<uint64_t>(end, needle.size() - 1));
+                uint64_t spanTo = std::min(total, end + needle.size() - 1);
+                copy(spanFrom, spanTo, scratch);
+                const char* hit = search::findBytes(scratch.data(), scratch.size(), needle);
+                if (hit) return spanFrom + static_cast<uint64_t>(hit - scratch.data());
+            }
+        }
+        return total;
+    }
+
+    // First offset at or after from holding byte, or size()
+    uint64_t findByte(uint64_t from, char byte) const {
+        if (from >= total) return total;
+        for (size_t i = pieceAt(from); i < pieces.size(); ++i) {
+            uint64_t skip = from > starts[i] ? from - starts[i] : 0;
+            const void* hit = std::memchr(pieces[i].data() + skip, byte, pieces[i].size() - skip);
+            if (hit) return starts[i] + static_cast<uint64_t>(static_cast<const char*>(hit) - pieces[i].data());
+        }
+        return total;
+    }
+
+    // Newlines in [from, to); moves lineStart past the last of them
+    uint64_t countLines(uint64_t from, uint64_t to, uint64_t& lineStart) const {
+        uint64_t lines = 0;
+        if (from >= to) return 0;
+        for (size_t i = pieceAt(from); i < pieces.size() && starts[i] < to; ++i) {
+            uint64_t begin = std::max(from, starts[i]) - starts[i];
+            uint64_t end = std::min<uint64_t>(to - starts[i], pieces[i].size());
+            std::string_view part = pieces[i].substr(begin, end - begin);
+            size_t count = search::countByte(part.data(), part.size(), '\n');
+            if (count > 0) {
+                lines += count;
+                lineStart = starts[i] + begin + part.rfind('\n') + 1;
+            }
+        }
+        return lines;
+    }
+
+    // [from, to) as one view: straight into the piece when it fits in one,
+    // otherwise copied into scratch
+    std::string_view view(uint64_t from, uint64_t to, std::string& scratch) const {
+        if (from >= to) return {};
+        size_t i = pieceAt(from);
+        if (to <= starts[i] + pieces[i].size()) {
+            return pieces[i].substr(from - starts[i], to - from);
+        }
+        copy(from, to, scratch);
+        return scratch;
+    }
+
+private:
+    size_t pieceAt(uint64_t offset) const {
+        return static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin()) - 1;
+    }
+
+    void copy(uint64_t from, uint64_t to, std::string& out) const {
+        out.clear();
+        for (size_t i = pieceAt(from); i < pieces.size() && starts[i] < to; ++i) {
+            uint64_t begin = std::max(from, starts[i]) - starts[i];
+            uint64_t end = std::min<uint64_t>(to - starts[i], pieces[i].size());
+            out.append(pieces[i].data() + begin, end - begin);
+        }
+    }
+
+    std::vector<std::string_view> pieces;
+    std::vector<uint64_t> starts;
+    uint64_t total = 0;
+};
+
+std::string escapeRegex(std::string_view literal) {
+    std::string escaped;
+    for (char c : literal) {
+        if (std::string_view("\\^$.|?*+()[]{}/").find(c) != std::string_view::npos) escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+}  // namespace
+
+bool StorageManager::globMatch(std::string_view pattern, std::string_view name) {
+    // '*' backtracks to just after the last star seen, one name byte further each time
+    size_t p = 0, n = 0;
+    size_t starP = std::string_view::npos, starN = 0;
+    while (n < name.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+            ++p;
+            ++n;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            starP = p++;
+            starN = n;
+        } else if (starP != std::string_view::npos) {
+            p = starP + 1;
+            n = ++starN;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') ++p;
+    return p == pattern.size();
+}
+
+Response StorageManager::walkEntries(const std::string& path,
+                                     const std::function<bool(const Folder&, const File*, std::string_view)>& fn) const {
+    PathInfo info = parsePath(path.empty() ? "." : path);
+    if (!info.folder) return Response::NotFound;
+
+    const Folder* start = info.folder;
+    const File* startFile = nullptr;
+    if (!info.name.empty()) {
+        start = findSubfolder(*info.folder, info.key);
+        if (!start) {
+            for (const auto& file : info.folder->files) {
+                if (file->name == info.key) startFile = file.get();
+            }
+            if (!startFile) return Response::NotFound;
+        }
+    }
+
+    // absolute path of the folder the walk starts from ("" for the root)
+    std::string buffer;
+    const Folder* top = start ? start : info.folder;
+    for (const Folder* f = top; f && f->parent; f = f->parent) {
+        buffer.insert(0, "/" + f->name);
+    }
+    if (startFile) {
+        buffer += "/" + startFile->name;
+        fn(*info.folder, startFile, buffer);
+        return Response::OK;
+    }
+
+    std::vector<std::pair<const Folder*, size_t>> pending{{start, buffer.size()}};
+    bool first = true;
+    while (!pending.empty()) {
+        auto [folder, parentLength] = pending.back();
+        pending.pop_back();
+        buffer.resize(parentLength);
+        if (!first) {
+            buffer += '/';
+            buffer += folder->name;
+        }
+        first = false;
+        if (!fn(*folder, nullptr, buffer.empty() ? std::string_view("/") : std::string_view(buffer))) {
+            return Response::OK;
+        }
+
+        size_t folderLength = buffer.size();
+        for (const auto& file : folder->files) {
+            buffer += '/';
+            buffer += file->name;
+            bool more = fn(*folder, file.get(), buffer);
+            buffer.resize(folderLength);
+            if (!more) return Response::OK;
+        }
+        for (auto it = folder->subfolders.rbegin(); it != folder->subfolders.rend(); ++it) {
+            pending.emplace_back(it->get(), folderLength);
+        }
+    }
+    return Response::OK;
+}
+
+Response StorageManager::find(const std::string& path, const FindQuery& query, const FindCallback& onMatch) const {
+    TreeLock lock(*this, TreeLock::Shared);
+    bool sizeBound = query.minSize > 0 || query.maxSize < UINT64_MAX;
+    return walkEntries(path, [&](const Folder& folder, const File* file, std::string_view entryPath) {
+        FoundEntry entry;
+        entry.path = entryPath;
+        entry.isFolder = file == nullptr;
+        entry.size = file ? file->content->size() : 0;
+        entry.modifiedAt = file ? file->modifiedAt : folder.modifiedAt;
+        std::string_view name = file ? file->name : folder.name;
+
+        if (entry.isFolder ? query.type == FindQuery::Type::File || sizeBound
+                           : query.type == FindQuery::Type::Folder) {
+            return true;
+        }
+        if (!query.nameGlob.empty() && !globMatch(query.nameGlob, name)) return true;
+        if (entry.size < query.minSize || entry.size > query.maxSize) return true;
+        if (entry.modifiedAt < query.modifiedAfter || entry.modifiedAt > query.modifiedBefore) return true;
+        return onMatch(entry);
+    });
+}
+
+Response StorageManager::grep(const std::string& path, const GrepQuery& query, const GrepCallback& onMatch) const {
+    TreeLock lock(*this, TreeLock::Shared);
+    std::regex pattern;
+    bool useRegex = query.regex || query.ignoreCase;
+    if (useRegex) {
+        try {
+            auto flags = std::regex::ECMAScript | std::regex::optimize;
+            if (query.ignoreCase) flags |= std::regex::icase;
+            pattern = std::regex(query.regex ? query.pattern : escapeRegex(query.pattern), flags);
+        } catch (const std::regex_error&) {
+            return Response::InvalidArgument;
+        }
+    }
+
+    std::string scratch;
+    std::string lineScratch;
+    try {
+        return walkEntries(path, [&](const Folder&, const File* file, std::string_view filePath) {
+            if (!file || (!query.nameGlob.empty() && !globMatch(query.nameGlob, file->name))) return true;
+
+            Segments content(*file->content);
+            GrepMatch match;
+            match.path = filePath;
+            uint64_t pos = 0;
+            uint64_t lineNumber = 1;
+            while (pos < content.size()) {
+                uint64_t lineStart = pos;
+                uint64_t lineEnd;
+                if (useRegex) {
+                    lineEnd = content.findByte(pos, '\n');
+                    std::string_view line = content.view(lineStart, lineEnd, lineScratch);
+                    if (std::regex_search(line.data(), line.data() + line.size(), pattern)) {
+                        match.lineNumber = lineNumber;
+                        match.line = line;
+                        if (!onMatch(match)) return false;
+                    }
+                } else {
+                    // jump straight to the next hit, counting the lines skipped over
+                    uint64_t hit = content.find(pos, query.pattern, scratch);
+                    if (hit >= content.size()) break;
+                    lineNumber += content.countLines(pos, hit, lineStart);
+                    lineEnd = content.findByte(hit, '\n');
+                    match.lineNumber = lineNumber;
+                    match.line = content.view(lineStart, lineEnd, lineScratch);
+                    if (!onMatch(match)) return false;
+                }
+                pos = lineEnd + 1;
+                ++lineNumber;
+            }
+            return true;
+        });
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+}  // namespace storage
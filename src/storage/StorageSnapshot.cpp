@@ -0,0 +1,341 @@
+#include "storage/Storage.h"
+#include "storage/Compression.h"
+#include "storage/MappedFile.h"
+#include "storage/SnapshotEncoding.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+
+namespace storage {
+
+using Response = StorageManager::StorageResponse;
+using namespace snapshot;
+
+// Binary snapshot layout, all integers little-endian:
+//
+//   header   magic "S3ALSNAP", u32 version, u32 snapshot id,
+//            u64 string count, u64 folder count, u64 file count, u64 blob bytes,
+//            u64 index bytes
+//   strings  u32 length + bytes for every distinct name
+//   folders  u64 parent index, u32 name index, i64 created, i64 modified,
+//            u64 quota bytes, u64 quota inodes (0 for no limit);
+//            preorder, so the root is record 0 and parents precede children
+//   files    u64 folder index, u32 name index, i64 created, i64 modified,
+//            u64 blob offset, u64 size, u32 mode, u32 owner uid, i32 owner pid
+//   blobs    raw file contents back to back, each distinct one once
+//   index    full-text index (see TextIndex::encode), files keyed by their
+//            record number; empty when the tree was not indexed
+//
+// Blob offsets are relative to the start of the blob section, so a mapped
+// snapshot can serve any file's bytes without reading the others. Files
+// with identical bytes point at the same blob and load sharing one content.
+//
+// Version 1 snapshots have no index bytes field and no index section;
+// versions 1 and 2 have no quotas in their folder records, and versions 1
+// to 3 no mode or owner in their file records.
+//
+// Timestamps are nanoseconds since the epoch. The snapshot id is fresh for
+// every full save; delta segments record the id of the base they apply to.
+//
+// A compressed snapshot is this layout inside a compression frame. Loading
+// it decompresses the whole snapshot into host memory, which then stands in
+// for the mapping.
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'S', '3', 'A', 'L', 'S', 'N', 'A', 'P'};
+constexpr uint32_t SNAPSHOT_VERSION = 4;
+constexpr uint32_t SNAPSHOT_VERSION_NO_META = 3;
+constexpr uint32_t SNAPSHOT_VERSION_NO_QUOTA = 2;
+constexpr uint32_t SNAPSHOT_VERSION_NO_INDEX = 1;
+constexpr uint64_t NO_PARENT = std::numeric_limits<uint64_t>::max();
+constexpr size_t HEADER_SIZE_NO_INDEX = 8 + 4 + 4 + 4 * 8;
+constexpr size_t HEADER_SIZE = HEADER_SIZE_NO_INDEX + 8;
+constexpr size_t FOLDER_RECORD_SIZE_NO_QUOTA = 8 + 4 + 8 + 8;
+constexpr size_t FOLDER_RECORD_SIZE = FOLDER_RECORD_SIZE_NO_QUOTA + 8 + 8;
+constexpr size_t FILE_RECORD_SIZE_NO_META = 8 + 4 + 8 + 8 + 8 + 8;
+constexpr size_t FILE_RECORD_SIZE = FILE_RECORD_SIZE_NO_META + 4 + 4 + 4;
+constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+}  // namespace
+
+Response StorageManager::saveBinarySnapshot(const std::string& path, uint32_t snapshotId, bool compress,
+                                            const std::string& indexSection) {
+    try {
+        auto started = std::chrono::steady_clock::now();
+        std::string strings;
+        std::string folderRecords;
+        std::string fileRecords;
+        BlobTable blobs;
+        std::unordered_map<std::string_view, uint32_t> stringIndex;
+        uint64_t folderCount = 0;
+        uint64_t fileCount = 0;
+
+        auto intern = [&](std::string_view name) {
+            auto [it, added] = stringIndex.try_emplace(name, static_cast<uint32_t>(stringIndex.size()));
+            if (added) {
+                put32(strings, static_cast<uint32_t>(name.size()));
+                strings += name;
+            }
+            return it->second;
+        };
+
+        folderRecords.reserve(root->usage.folders * FOLDER_RECORD_SIZE);
+        fileRecords.reserve(root->usage.files * FILE_RECORD_SIZE);
+
+        // Preorder walk; children are pushed in reverse to keep their order
+        std::vector<std::pair<const Folder*, uint64_t>> pending{{root.get(), NO_PARENT}};
+        while (!pending.empty()) {
+            auto [folder, parent] = pending.back();
+            pending.pop_back();
+            uint64_t index = folderCount++;
+
+            put64(folderRecords, parent);
+            put32(folderRecords, intern(folder->name));
+            put64(folderRecords, toNanos(folder->createdAt));
+            put64(folderRecords, toNanos(folder->modifiedAt));
+            put64(folderRecords, folder->quota.bytes);
+            put64(folderRecords, folder->quota.inodes);
+
+            for (const auto& file : folder->files) {
+                put64(fileRecords, index);
+                put32(fileRecords, intern(file->name));
+                put64(fileRecords, toNanos(file->createdAt));
+                put64(fileRecords, toNanos(file->modifiedAt));
+                put64(fileRecords, blobs.add(*file->content));
+                put64(fileRecords, file->content->size());
+                put32(fileRecords, file->mode);
+                put32(fileRecords, file->ownerUid);
+                put32(fileRecords, static_cast<uint32_t>(file->ownerPid));
+                ++fileCount;
+            }
+
+            for (auto it = folder->subfolders.rbegin(); it != folder->subfolders.rend(); ++it) {
+                pending.emplace_back(it->get(), index);
+            }
+        }
+
+        std::string header(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        put32(header, SNAPSHOT_VERSION);
+        put32(header, snapshotId);
+        put64(header, stringIndex.size());
+        put64(header, folderCount);
+        put64(header, fileCount);
+        put64(header, blobs.bytes());
+        put64(header, indexSection.size());
+
+        // Write next to the target and rename, so a failed save keeps the old snapshot
+        std::string tmpPath = path + ".tmp";
+        uint64_t rawBytes = 0;
+        {
+            std::vector<char> buffer(WRITE_BUFFER_SIZE);
+            std::ofstream file;
+            file.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            file.open(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                return Response::Error;
+            }
+            std::optional<compression::CompressingStreamBuf> packer;
+            if (compress) packer.emplace(file);
+            std::ostream out(packer ? static_cast<std::streambuf*>(&*packer) : file.rdbuf());
+
+            out.write(header.data(), static_cast<std::streamsize>(header.size()));
+            out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+            out.write(folderRecords.data(), static_cast<std::streamsize>(folderRecords.size()));
+            out.write(fileRecords.data(), static_cast<std::streamsize>(fileRecords.size()));
+            // contents go out straight from their extents (or mapping)
+            uint64_t written = 0;
+            for (const FileContent* content : blobs.contents()) {
+                content->forEachSegment([&out](const char* bytes, size_t count) {
+                    out.write(bytes, static_cast<std::streamsize>(count));
+                });
+                written += content->size();
+                if (saveProgress) saveProgress(written);
+            }
+            out.write(indexSection.data(), static_cast<std::streamsize>(indexSection.size()));
+            bool ok = out.flush() && (!packer || packer->finish());
+            file.flush();
+            if (!ok || !file) {
+                file.close();
+                std::filesystem::remove(tmpPath);
+                return Response::Error;
+            }
+            rawBytes = packer ? packer->rawBytes() : static_cast<uint64_t>(file.tellp());
+        }
+        std::filesystem::rename(tmpPath, path);
+        // deltas written against the previous base no longer apply
+        std::filesystem::remove(path + std::string(DELTA_SUFFIX));
+        recordSnapshotStats("Saved", path, rawBytes, std::filesystem::file_size(path), compress, started);
+        return Response::OK;
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+Response StorageManager::loadBinarySnapshot(const std::string& path, bool lazy) {
+    try {
+        auto started = std::chrono::steady_clock::now();
+        auto mapping = MappedFile::open(path);
+        if (!mapping) {
+            return Response::NotFound;
+        }
+        std::shared_ptr<const void> pin = mapping;
+        const char* data = mapping->data();
+        uint64_t fileSize = mapping->size();
+        bool compressed = compression::isCompressed(data, fileSize);
+        if (compressed) {
+            auto snapshotBytes = std::make_shared<std::string>();
+            if (!compression::decompress(data, fileSize, *snapshotBytes)) {
+                logError("Corrupt compressed snapshot: " + path);
+                return Response::Error;
+            }
+            data = snapshotBytes->data();
+            fileSize = snapshotBytes->size();
+            pin = std::move(snapshotBytes);
+        }
+        if (fileSize < HEADER_SIZE_NO_INDEX) {
+            logError("Binary snapshot too small");
+            return Response::Error;
+        }
+
+        uint32_t version = get32(data + 8);
+        if (std::memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+            version < SNAPSHOT_VERSION_NO_INDEX || version > SNAPSHOT_VERSION) {
+            logError("Not a binary snapshot or unsupported version");
+            return Response::Error;
+        }
+        size_t headerSize = version == SNAPSHOT_VERSION_NO_INDEX ? HEADER_SIZE_NO_INDEX : HEADER_SIZE;
+        bool hasQuotas = version > SNAPSHOT_VERSION_NO_QUOTA;
+        size_t folderRecordSize = hasQuotas ? FOLDER_RECORD_SIZE : FOLDER_RECORD_SIZE_NO_QUOTA;
+        bool hasMeta = version > SNAPSHOT_VERSION_NO_META;
+        size_t fileRecordSize = hasMeta ? FILE_RECORD_SIZE : FILE_RECORD_SIZE_NO_META;
+        if (fileSize < headerSize) {
+            logError("Binary snapshot too small");
+            return Response::Error;
+        }
+        uint32_t snapshotId = get32(data + 12);
+        uint64_t stringCount = get64(data + 16);
+        uint64_t folderCount = get64(data + 24);
+        uint64_t fileCount = get64(data + 32);
+        uint64_t blobBytes = get64(data + 40);
+        uint64_t indexBytes = version == SNAPSHOT_VERSION_NO_INDEX ? 0 : get64(data + 48);
+
+        // Reject counts the file cannot possibly hold before allocating for them
+        uint64_t available = fileSize - headerSize;
+        if (folderCount == 0 || stringCount > available / 4 ||
+            folderCount > available / folderRecordSize || fileCount > available / fileRecordSize ||
+            blobBytes > available || indexBytes > available - blobBytes) {
+            logError("Corrupt binary snapshot header");
+            return Response::Error;
+        }
+
+        uint64_t pos = headerSize;
+        // each distinct name is interned once, not once per node
+        std::vector<NodeName> names(stringCount);
+        for (auto& name : names) {
+            if (fileSize - pos < 4) return Response::Error;
+            uint32_t size = get32(data + pos);
+            pos += 4;
+            if (fileSize - pos < size) return Response::Error;
+            name = std::string_view(data + pos, size);
+            pos += size;
+        }
+
+        uint64_t folderBytes = folderCount * folderRecordSize;
+        uint64_t fileBytes = fileCount * fileRecordSize;
+        if (fileSize - pos < folderBytes || fileSize - pos - folderBytes < fileBytes ||
+            fileSize - pos - folderBytes - fileBytes != blobBytes + indexBytes) {
+            logError("Binary snapshot truncated");
+            return Response::Error;
+        }
+        const char* folderRecords = data + pos;
+        const char* fileRecords = folderRecords + folderBytes;
+        const char* blobs = fileRecords + fileBytes;
+        const char* indexSection = blobs + blobBytes;
+
+        std::unique_ptr<Folder> newRoot;
+        std::vector<Folder*> folders;
+        folders.reserve(folderCount);
+        for (uint64_t i = 0; i < folderCount; ++i) {
+            const char* record = folderRecords + i * folderRecordSize;
+            uint64_t parent = get64(record);
+            uint32_t name = get32(record + 8);
+            if (name >= stringCount || (i == 0) != (parent == NO_PARENT) || (i > 0 && parent >= i)) {
+                logError("Corrupt folder record in binary snapshot");
+                return Response::Error;
+            }
+
+            auto folder = std::make_unique<Folder>();
+            folder->name = names[name];
+            folder->createdAt = fromNanos(get64(record + 12));
+            folder->modifiedAt = fromNanos(get64(record + 20));
+            if (hasQuotas) folder->quota = {get64(record + 28), get64(record + 36)};
+            folders.push_back(folder.get());
+            if (i == 0) {
+                newRoot = std::move(folder);
+            } else {
+                folder->parent = folders[parent];
+                folders[parent]->subfolders.push_back(std::move(folder));
+            }
+        }
+
+        // Lazy loads leave every content on the mapping, which each of them
+        // keeps alive; eager loads copy the blobs into simulated memory now
+        BlobCache loadedBlobs;
+        std::vector<IndexedFile> loadedFiles;
+        if (textIndex) loadedFiles.reserve(fileCount);
+        for (uint64_t i = 0; i < fileCount; ++i) {
+            const char* record = fileRecords + i * fileRecordSize;
+            uint64_t folder = get64(record);
+            uint32_t name = get32(record + 8);
+            uint64_t offset = get64(record + 28);
+            uint64_t size = get64(record + 36);
+            if (folder >= folderCount || name >= stringCount || offset > blobBytes || size > blobBytes - offset) {
+                logError("Corrupt file record in binary snapshot");
+                return Response::Error;
+            }
+
+            auto file = makeFile(names[name]);
+            file->createdAt = fromNanos(get64(record + 12));
+            file->modifiedAt = fromNanos(get64(record + 20));
+            file->mode = hasMeta ? static_cast<uint16_t>(get32(record + 44) & MAX_FILE_MODE) : DEFAULT_FILE_MODE;
+            file->ownerUid = hasMeta ? get32(record + 48) : 0;
+            file->ownerPid = hasMeta ? static_cast<int32_t>(get32(record + 52)) : 0;
+            file->content = loadBlob(pin, blobs + offset, size, lazy, loadedBlobs);
+            if (!file->content) {
+                logError("Failed to load content for file: " + file->name);
+                return Response::Error;
+            }
+            if (textIndex) loadedFiles.push_back({file.get(), folders[folder]});
+            folders[folder]->files.push_back(std::move(file));
+        }
+
+        std::string deltaPath = path + std::string(DELTA_SUFFIX);
+        bool hasDeltas = std::filesystem::exists(deltaPath);
+        Response deltaResult = applyDeltaSegments(*newRoot, deltaPath, snapshotId, lazy);
+        if (deltaResult != Response::OK) {
+            return deltaResult;
+        }
+
+        root = std::move(newRoot);
+        recountUsage(*root);
+        relocateWorkingDirs(nullptr, nullptr);
+        // deltas may have replaced files the saved index points at
+        if (textIndex && (hasDeltas || indexBytes == 0 ||
+                          !decodeIndex(indexSection, indexBytes, std::move(loadedFiles)))) {
+            rebuildIndex();
+        }
+        trackDeltaBase(path, snapshotId);
+        recordSnapshotStats(lazy ? "Mapped" : "Loaded", path, fileSize, mapping->size(), compressed, started);
+        logInfo(std::string(lazy ? "Mapped" : "Loaded") + " binary snapshot (" +
+                std::to_string(folderCount) + " folders, " + std::to_string(fileCount) + " files)");
+        return Response::OK;
+    } catch (...) {
+        return Response::Error;
+    }
+}
+
+}  // namespace storage
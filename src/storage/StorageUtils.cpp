@@ -19,13 +19,15 @@ std::string StorageManager::toString(Response status) {
             return "Already at Root";
         case Response::InvalidArgument:
             return "Invalid Argument";
+        case Response::QuotaExceeded:
+            return "Quota Exceeded";
         case Response::Error:
         default:
             return "Error";
     }
 }
 
-bool StorageManager::isNameInvalid(const std::string& s) {
+bool StorageManager::isNameInvalid(std::string_view s) {
     if (s.empty()) return true;
     return std::all_of(s.begin(), s.end(), [](unsigned char c) {
         return std::isspace(c);
@@ -36,71 +38,160 @@ std::string formatTime(const std::chrono::system_clock::time_point& tp) {
     return common::TimeUtils::format(tp, common::TimeUtils::Format::DateTimeSeconds);
 }
 
-StorageManager::PathInfo StorageManager::parsePath(const std::string& path) const {
-    if (path.empty()) {
-        return {nullptr, ""};
-    }
+namespace {
 
-    // is path absolute or relative
-    bool isAbsolute = (path[0] == '/');
-    Folder* current = isAbsolute ? root.get() : currentFolder;
+// Splits a path on '/' without allocating, skipping empty components
+class PathTokenizer {
+public:
+    explicit PathTokenizer(std::string_view path) : path(path) {}
 
-    // split path by '/'
-    std::vector<std::string> parts;
-    std::string part;
-    
-    for (char c : path) {
-        if (c == '/') {
-            if (!part.empty()) {
-                parts.push_back(part);
-                part.clear();
-            }
-        } else {
-            part += c;
-        }
-    }
-    if (!part.empty()) {
-        parts.push_back(part);
+    bool next(std::string_view& token) {
+        while (pos < path.size() && path[pos] == '/') ++pos;
+        if (pos >= path.size()) return false;
+        size_t end = path.find('/', pos);
+        if (end == std::string_view::npos) end = path.size();
+        token = path.substr(pos, end - pos);
+        pos = end;
+        return true;
     }
 
-    // handle "/" case, just return root with empty name
-    if (parts.empty() && isAbsolute) {
-        return {root.get(), ""};
-    }
+private:
+    std::string_view path;
+    size_t pos = 0;
+};
 
-    if (parts.empty()) {
-        return {nullptr, ""};
+}  // namespace
+
+StorageManager::Folder* StorageManager::findSubfolder(const Folder& folder, std::string_view name) {
+    return folder.subfolders.empty() ? nullptr : findSubfolder(folder, NodeName::lookup(name));
+}
+
+StorageManager::Folder* StorageManager::findSubfolder(const Folder& folder, NodeName name) {
+    for (const auto& sub : folder.subfolders) {
+        if (sub->name == name) return sub.get();
     }
+    return nullptr;
+}
 
-    // navigate to parent folder
-    for (size_t i = 0; i + 1 < parts.size(); ++i) {
-        const std::string& dirName = parts[i];
-        
+StorageManager::Folder* StorageManager::findFolder(const std::string& path) const {
+    PathInfo info = parsePath(path.empty() ? "." : path);
+    if (!info.folder) return nullptr;
+    // "/", "." and ".." come back as the folder itself with no name
+    return info.name.empty() ? info.folder : findSubfolder(*info.folder, info.key);
+}
+
+StorageManager::Folder* StorageManager::walkPath(Folder* start, std::string_view dirPath,
+                                                 bool strict, Response& outStatus) const {
+    Folder* current = start;
+    PathTokenizer tokens(dirPath);
+    std::string_view dirName;
+    while (tokens.next(dirName)) {
         if (dirName == ".") {
             continue;
         } else if (dirName == "..") {
             if (current->parent) {
                 current = current->parent;
+            } else if (strict) {
+                outStatus = Response::AtRoot;
+                return nullptr;
             }
         } else {
-            // find subfolder
-            bool found = false;
-            for (auto& sub : current->subfolders) {
-                if (sub->name == dirName) {
-                    current = sub.get();
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                return {nullptr, ""};
+            current = findSubfolder(*current, dirName);
+            if (!current) {
+                outStatus = Response::NotFound;
+                return nullptr;
             }
         }
     }
+    outStatus = Response::OK;
+    return current;
+}
+
+const std::string& StorageManager::workingDirKey() const {
+    ThreadView& view = threadView();
+    if (!view.cwdKeyValid) {
+        view.cwdKey = getWorkingDir();
+        if (view.cwdKey == "/") view.cwdKey.clear();
+        view.cwdKeyValid = true;
+    }
+    return view.cwdKey;
+}
+
+void StorageManager::invalidateDentryCache() {
+    // every thread drops its cache the next time it resolves a path
+    ++treeGeneration;
+}
+
+StorageManager::Folder* StorageManager::resolveDirectory(std::string_view dirPath, bool isAbsolute) const {
+    Folder* start = isAbsolute ? root.get() : workingFolder();
+    Response status;
+
+    // ".." has to be checked component by component against the live tree
+    if (dirPath.find("..") != std::string_view::npos) {
+        return walkPath(start, dirPath, false, status);
+    }
+
+    ThreadView& view = threadView();
+    if (view.generation != treeGeneration) {
+        view.dentryCache.clear();
+        view.cwdKeyValid = false;
+        view.generation = treeGeneration;
+    }
+
+    // build the normalized absolute key in a reused buffer
+    std::string& key = view.pathKeyBuffer;
+    if (isAbsolute) {
+        key.clear();
+    } else {
+        key.assign(workingDirKey());
+    }
+    PathTokenizer tokens(dirPath);
+    std::string_view dirName;
+    bool hasComponents = false;
+    while (tokens.next(dirName)) {
+        if (dirName == ".") continue;
+        key += '/';
+        key.append(dirName);
+        hasComponents = true;
+    }
+    if (!hasComponents) return start;
+    if (key.empty()) return root.get();
+
+    auto it = view.dentryCache.find(key);
+    if (it != view.dentryCache.end()) return it->second;
+
+    Folder* folder = walkPath(start, dirPath, false, status);
+    if (folder) {
+        if (view.dentryCache.size() >= DENTRY_CACHE_CAPACITY) view.dentryCache.clear();
+        view.dentryCache.emplace(key, folder);
+    }
+    return folder;
+}
+
+StorageManager::PathInfo StorageManager::parsePath(std::string_view path) const {
+    if (path.empty()) {
+        return {nullptr, ""};
+    }
+
+    // is path absolute or relative
+    bool isAbsolute = (path[0] == '/');
+
+    // handle "/" case, just return root with empty name
+    size_t lastEnd = path.find_last_not_of('/');
+    if (lastEnd == std::string_view::npos) {
+        return {root.get(), ""};
+    }
+
+    // split off the last component, everything before it names the parent folder
+    size_t lastStart = path.rfind('/', lastEnd);
+    lastStart = (lastStart == std::string_view::npos) ? 0 : lastStart + 1;
+    std::string_view lastName = path.substr(lastStart, lastEnd - lastStart + 1);
+
+    Folder* current = resolveDirectory(path.substr(0, lastStart), isAbsolute);
+    if (!current) {
+        return {nullptr, ""};
+    }
 
-    // handle the last part
-    const std::string& lastName = parts.back();
-    
     // if last part is ".." or ".", handle specially
     if (lastName == "..") {
         if (current->parent) {
@@ -114,7 +205,7 @@ StorageManager::PathInfo StorageManager::parsePath(const std::string& path) cons
     }
 
     // return folder and fileName/dirname
-    return {current, parts.back()};
+    return {current, lastName, NodeName::lookup(lastName)};
 }
 
 }  // namespace storage
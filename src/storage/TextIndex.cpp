@@ -0,0 +1,285 @@
+#include "storage/TextIndex.h"
+#include "storage/SnapshotEncoding.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace storage {
+
+using namespace snapshot;
+
+namespace {
+
+// Lowercased term byte for every byte that belongs to a term, else 0
+constexpr std::array<char, 256> makeTermBytes() {
+    std::array<char, 256> table{};
+    for (int c = 0; c < 256; ++c) {
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '_') table[c] = static_cast<char>(c);
+        if (c >= 'A' && c <= 'Z') table[c] = static_cast<char>(c - 'A' + 'a');
+    }
+    return table;
+}
+
+constexpr std::array<char, 256> TERM_BYTES = makeTermBytes();
+
+char termByte(char c) {
+    return TERM_BYTES[static_cast<unsigned char>(c)];
+}
+
+}  // namespace
+
+void TextIndex::index(DocId doc, const FileContent& content) {
+    remove(doc);
+    addTerms(doc, content, 0);
+}
+
+void TextIndex::indexAppended(DocId doc, const FileContent& content, uint64_t oldSize) {
+    uint64_t from = oldSize;
+    char last = 0;
+    char next = 0;
+    if (oldSize > 0 && oldSize < content.size() && content.readAt(oldSize - 1, 1, &last) == 1 &&
+        content.readAt(oldSize, 1, &next) == 1 && termByte(last) && termByte(next)) {
+        // the append continues the last term: back up to where it starts
+        // and index it again, whole
+        char chunk[256];
+        bool found = false;
+        while (from > 0 && !found) {
+            uint64_t count = std::min<uint64_t>(from, sizeof(chunk));
+            content.readAt(from - count, count, chunk);
+            for (uint64_t i = count; i > 0; --i) {
+                if (!termByte(chunk[i - 1])) {
+                    found = true;
+                    break;
+                }
+                --from;
+            }
+        }
+
+        std::string oldTerm(std::min<uint64_t>(oldSize - from, MAX_TERM_LENGTH), '\0');
+        content.readAt(from, oldTerm.size(), oldTerm.data());
+        for (char& c : oldTerm) c = termByte(c);
+        auto entry = postings.find(oldTerm);
+        if (entry != postings.end()) dropOffset(doc, *entry, from);
+    }
+    addTerms(doc, content, from);
+}
+
+void TextIndex::copy(DocId from, DocId to) {
+    if (from == to) return;
+    remove(to);
+    auto source = docs.find(from);
+    if (source == docs.end()) return;
+    std::vector<TermEntry*> terms = source->second;
+    for (TermEntry* entry : terms) {
+        std::vector<uint64_t> offsets = entry->second.at(from);
+        offsetCount += offsets.size();
+        entry->second.emplace(to, std::move(offsets));
+    }
+    docs.emplace(to, std::move(terms));
+}
+
+void TextIndex::remove(DocId doc) {
+    auto it = docs.find(doc);
+    if (it == docs.end()) return;
+    for (TermEntry* entry : it->second) {
+        auto offsets = entry->second.find(doc);
+        offsetCount -= offsets->second.size();
+        entry->second.erase(offsets);
+        if (entry->second.empty()) postings.erase(postings.find(entry->first));
+    }
+    docs.erase(it);
+}
+
+void TextIndex::clear() {
+    postings.clear();
+    docs.clear();
+    offsetCount = 0;
+}
+
+void TextIndex::addTerms(DocId doc, const FileContent& content, uint64_t from) {
+    auto& docTerms = docs[doc];
+    std::string term;
+    term.reserve(MAX_TERM_LENGTH);
+    uint64_t termStart = 0;
+    bool inTerm = false;
+    uint64_t base = 0;
+
+    auto addTerm = [&] {
+        auto entry = postings.find(term);
+        if (entry == postings.end()) entry = postings.emplace(term, DocOffsets{}).first;
+        auto [offsets, added] = entry->second.try_emplace(doc);
+        if (added) docTerms.push_back(&*entry);
+        offsets->second.push_back(termStart);
+        ++offsetCount;
+    };
+
+    content.forEachSegment([&](const char* bytes, size_t count) {
+        uint64_t end = base + count;
+        size_t i = from > base ? static_cast<size_t>(std::min<uint64_t>(from - base, count)) : 0;
+        for (; i < count; ++i) {
+            char c = termByte(bytes[i]);
+            if (c) {
+                if (!inTerm) {
+                    inTerm = true;
+                    termStart = base + i;
+                    term.clear();
+                }
+                if (term.size() < MAX_TERM_LENGTH) term.push_back(c);
+            } else if (inTerm) {
+                addTerm();
+                inTerm = false;
+            }
+        }
+        base = end;
+    });
+    if (inTerm) addTerm();
+    if (docTerms.empty()) docs.erase(doc);
+}
+
+void TextIndex::dropOffset(DocId doc, TermEntry& entry, uint64_t offset) {
+    auto offsets = entry.second.find(doc);
+    if (offsets == entry.second.end()) return;
+    auto& list = offsets->second;
+    auto it = std::lower_bound(list.begin(), list.end(), offset);
+    if (it == list.end() || *it != offset) return;
+    list.erase(it);
+    --offsetCount;
+    if (!list.empty()) return;
+
+    entry.second.erase(offsets);
+    auto& docTerms = docs[doc];
+    docTerms.erase(std::find(docTerms.begin(), docTerms.end(), &entry));
+    if (docTerms.empty()) docs.erase(doc);
+    if (entry.second.empty()) postings.erase(postings.find(entry.first));
+}
+
+void TextIndex::search(const std::vector<std::string>& terms,
+                       const std::function<bool(DocId, std::span<const uint64_t>)>& fn) const {
+    std::vector<const DocOffsets*> lists;
+    for (const auto& term : terms) {
+        auto entry = postings.find(term);
+        if (entry == postings.end()) return;
+        if (std::find(lists.begin(), lists.end(), &entry->second) == lists.end()) {
+            lists.push_back(&entry->second);
+        }
+    }
+    if (lists.empty()) return;
+
+    // walk the rarest term's documents, probing the others
+    std::sort(lists.begin(), lists.end(), [](const DocOffsets* a, const DocOffsets* b) { return a->size() < b->size(); });
+    std::vector<DocId> matches;
+    for (const auto& [doc, offsets] : *lists[0]) {
+        bool all = std::all_of(lists.begin() + 1, lists.end(),
+                               [doc = doc](const DocOffsets* list) { return list->contains(doc); });
+        if (all) matches.push_back(doc);
+    }
+    std::sort(matches.begin(), matches.end());
+
+    std::vector<uint64_t> merged;
+    for (DocId doc : matches) {
+        if (lists.size() == 1) {
+            if (!fn(doc, lists[0]->at(doc))) return;
+            continue;
+        }
+        merged.clear();
+        for (const DocOffsets* list : lists) {
+            const auto& offsets = list->at(doc);
+            size_t middle = merged.size();
+            merged.insert(merged.end(), offsets.begin(), offsets.end());
+            std::inplace_merge(merged.begin(), merged.begin() + static_cast<std::ptrdiff_t>(middle), merged.end());
+        }
+        if (!fn(doc, merged)) return;
+    }
+}
+
+std::vector<std::string> TextIndex::tokenize(std::string_view text) {
+    std::vector<std::string> terms;
+    std::string term;
+    bool inTerm = false;
+    for (char byte : text) {
+        char c = termByte(byte);
+        if (c) {
+            if (!inTerm) term.clear();
+            inTerm = true;
+            if (term.size() < MAX_TERM_LENGTH) term.push_back(c);
+        } else if (inTerm) {
+            terms.push_back(term);
+            inTerm = false;
+        }
+    }
+    if (inTerm) terms.push_back(term);
+    return terms;
+}
+
+void TextIndex::encode(std::string& out, const std::function<uint64_t(DocId)>& keyOf) const {
+    std::string body;
+    uint64_t termTotal = 0;
+    std::vector<std::pair<uint64_t, const std::vector<uint64_t>*>> kept;
+    for (const auto& [term, docOffsets] : postings) {
+        kept.clear();
+        for (const auto& [doc, offsets] : docOffsets) {
+            uint64_t key = keyOf(doc);
+            if (key != NO_KEY) kept.emplace_back(key, &offsets);
+        }
+        if (kept.empty()) continue;
+        ++termTotal;
+        putString(body, term);
+        put32(body, static_cast<uint32_t>(kept.size()));
+        for (const auto& [key, offsets] : kept) {
+            put64(body, key);
+            putVar(body, offsets->size());
+            uint64_t previous = 0;
+            for (uint64_t offset : *offsets) {
+                putVar(body, offset - previous);
+                previous = offset;
+            }
+        }
+    }
+    put64(out, termTotal);
+    out += body;
+}
+
+bool TextIndex::decode(const char* data, size_t size, uint64_t docLimit) {
+    clear();
+    Reader in(data, size);
+    uint64_t termTotal = in.u64();
+    // every term takes at least its length and document count
+    if (termTotal > in.remaining() / 8) in.bytes(in.remaining() + 1);
+
+    for (uint64_t t = 0; t < termTotal && in.ok(); ++t) {
+        std::string_view term = in.string();
+        uint32_t docTotal = in.u32();
+        auto [entry, added] = postings.try_emplace(std::string(term));
+        if (!added || term.empty() || term.size() > MAX_TERM_LENGTH || docTotal > in.remaining() / 9) break;
+
+        for (uint32_t d = 0; d < docTotal && in.ok(); ++d) {
+            uint64_t key = in.u64();
+            uint64_t count = in.var();
+            if (key >= docLimit || count == 0 || count > in.remaining()) {
+                in.bytes(in.remaining() + 1);
+                break;
+            }
+            auto [offsets, fresh] = entry->second.try_emplace(static_cast<DocId>(key));
+            if (!fresh) {
+                in.bytes(in.remaining() + 1);
+                break;
+            }
+            offsets->second.reserve(count);
+            uint64_t offset = 0;
+            for (uint64_t i = 0; i < count; ++i) {
+                offset += in.var();
+                offsets->second.push_back(offset);
+            }
+            offsetCount += count;
+            docs[static_cast<DocId>(key)].push_back(&*entry);
+        }
+        if (entry->second.empty()) break;
+    }
+    if (!in.ok() || in.remaining() != 0 || postings.size() != termTotal) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+}  // namespace storage
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "storage/FileContent.h"
+
+// Inverted full-text index over file contents. Internal to the storage
+// library.
+//
+// A term is a run of ASCII letters, digits and '_', lowercased; runs longer
+// than MAX_TERM_LENGTH are indexed by their first MAX_TERM_LENGTH bytes.
+// Every term maps to the documents holding it and, per document, the byte
+// offsets where it starts, in ascending order. Documents are numbered by
+// the caller; the index never looks at what they are.
+
+namespace storage {
+
+class TextIndex {
+public:
+    using DocId = uint32_t;
+    static constexpr size_t MAX_TERM_LENGTH = 64;
+
+    // Replaces whatever doc had indexed with the terms of content
+    void index(DocId doc, const FileContent& content);
+    // content is what doc held, oldSize bytes, with bytes appended: only
+    // those are read, plus the term the append may have extended
+    void indexAppended(DocId doc, const FileContent& content, uint64_t oldSize);
+    // Gives to the terms from has, replacing its own
+    void copy(DocId from, DocId to);
+    void remove(DocId doc);
+    void clear();
+
+    // Calls fn(doc, offsets) for every document holding all the terms, in
+    // ascending doc order; offsets are where any of them start, sorted
+    void search(const std::vector<std::string>& terms,
+                const std::function<bool(DocId, std::span<const uint64_t>)>& fn) const;
+    // The terms in text, as the index would see them
+    static std::vector<std::string> tokenize(std::string_view text);
+
+    size_t documentCount() const { return docs.size(); }
+    size_t termCount() const { return postings.size(); }
+    size_t postingCount() const { return offsetCount; }
+
+    // Snapshot section: u64 term count, then per term its text (u32 length
+    // + bytes), u32 document count and per document a u64 key, a varint
+    // offset count and the offsets as varint gaps. Keys are keyOf(doc);
+    // documents keyed NO_KEY are left out.
+    static constexpr uint64_t NO_KEY = UINT64_MAX;
+    void encode(std::string& out, const std::function<uint64_t(DocId)>& keyOf) const;
+    // Replaces the index with a section encode() wrote, taking the keys as
+    // doc ids; false (leaving the index empty) if it is corrupt or names a
+    // key of docLimit or more
+    bool decode(const char* data, size_t size, uint64_t docLimit);
+
+private:
+    using DocOffsets = std::unordered_map<DocId, std::vector<uint64_t>>;
+    using TermEntry = std::pair<const std::string, DocOffsets>;
+
+    // Terms in [from, end of content), started at a term boundary
+    void addTerms(DocId doc, const FileContent& content, uint64_t from);
+    void dropOffset(DocId doc, TermEntry& entry, uint64_t offset);
+
+    // Map nodes stay put, so documents can point at their terms
+    std::unordered_map<std::string, DocOffsets> postings;
+    std::unordered_map<DocId, std::vector<TermEntry*>> docs;
+    size_t offsetCount = 0;
+};
+
+}  // namespace storage
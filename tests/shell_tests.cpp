@@ -18,7 +18,7 @@ class MockSysApiForShell : public testHelpers::MockSysApi {
 public:
     // File operations tested by shell
     MOCK_METHOD(SysResult, createFile, (const std::string& name), (override));
-    MOCK_METHOD(SysResult, listDir, (const std::string& path, std::vector<std::string>& out), (override));
+    MOCK_METHOD(SysResult, listDirEntries, (const std::string& path, std::vector<DirEntry>& out), (override));
     MOCK_METHOD(std::string, getWorkingDir, (), (override));
     
     // System info tested by shell
@@ -82,9 +82,10 @@ TEST_F(ShellTest, TouchCommandFileExists) {
 TEST_F(ShellTest, LsCommandDisplaysFiles) {
     Shell shell(mockSys, *registry);
     std::ostringstream output;
-    std::vector<std::string> files = {"file1.txt", "file2.txt", "dir1"};
+    std::vector<SysApi::DirEntry> files = {{"dir1", true, 0, 0, 0}, {"file1.txt", false, 12, 0, 0},
+                                           {"file2.txt", false, 3, 0, 0}};
     
-    EXPECT_CALL(mockSys, listDir(_, _))
+    EXPECT_CALL(mockSys, listDirEntries(_, _))
         .WillOnce(DoAll(
             SetArgReferee<1>(files),
             Return(SysResult::OK)
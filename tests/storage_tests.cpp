@@ -1,7 +1,13 @@
 #include <gtest/gtest.h>
 #include "storage/Storage.h"
+#include "storage/Compression.h"
 #include "testHelpers/MockSysApi.h"
 #include "logger/Logger.h"
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <random>
+#include <thread>
 
 using namespace storage;
 using Response = StorageManager::StorageResponse;
@@ -89,6 +95,191 @@ TEST_F(StorageManagerTest, EditFile_AppendsContent) {
     EXPECT_EQ(out, "begin\n end");
 }
 
+TEST_F(StorageManagerTest, AppendFile_AddsNewlineTerminatedRecords) {
+    EXPECT_EQ(storage.createFile("log.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("log.txt", "first"), Response::OK);
+    EXPECT_EQ(storage.appendFile("log.txt", "second"), Response::OK);
+    EXPECT_EQ(storage.appendFile("log.txt", "third"), Response::OK);
+
+    std::string out;
+    EXPECT_EQ(storage.readFile("log.txt", out), Response::OK);
+    EXPECT_EQ(out, "first\nsecond\nthird\n");
+}
+
+TEST_F(StorageManagerTest, AppendFile_ManySmallAppendsKeepAllContent) {
+    EXPECT_EQ(storage.createFile("grow.txt"), Response::OK);
+    std::string expected;
+    for (int i = 0; i < 500; ++i) {
+        std::string line = "line" + std::to_string(i);
+        EXPECT_EQ(storage.appendFile("grow.txt", line), Response::OK);
+        expected += line + "\n";
+    }
+
+    std::string out;
+    EXPECT_EQ(storage.readFile("grow.txt", out), Response::OK);
+    EXPECT_EQ(out, expected);
+}
+
+TEST_F(StorageManagerTest, AppendFile_NotFoundOrInvalid) {
+    EXPECT_EQ(storage.appendFile("ghost.txt", "data"), Response::NotFound);
+    EXPECT_EQ(storage.appendFile("", "data"), Response::InvalidArgument);
+}
+
+TEST_F(StorageManagerTest, WriteFile_AfterAppendsReplacesContent) {
+    EXPECT_EQ(storage.createFile("mix.txt"), Response::OK);
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_EQ(storage.appendFile("mix.txt", "0123456789"), Response::OK);
+    }
+    EXPECT_EQ(storage.writeFile("mix.txt", "short"), Response::OK);
+
+    std::string out;
+    EXPECT_EQ(storage.readFile("mix.txt", out), Response::OK);
+    EXPECT_EQ(out, "short\n");
+}
+
+TEST_F(StorageManagerTest, WriteFile_LargerThanOneExtent) {
+    std::string big;
+    for (size_t i = 0; big.size() < 3 * FileContent::EXTENT_SIZE + 123; ++i) {
+        big += std::to_string(i) + ",";
+    }
+    EXPECT_EQ(storage.createFile("big.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("big.txt", big), Response::OK);
+
+    std::string out;
+    EXPECT_EQ(storage.readFile("big.txt", out), Response::OK);
+    EXPECT_EQ(out, big + "\n");
+
+    EXPECT_EQ(storage.writeFile("big.txt", "tiny"), Response::OK);
+    EXPECT_EQ(storage.readFile("big.txt", out), Response::OK);
+    EXPECT_EQ(out, "tiny\n");
+}
+
+TEST_F(StorageManagerTest, AppendFile_GrowsAcrossExtentBoundary) {
+    std::string record(1000, 'x');
+    std::string expected;
+    EXPECT_EQ(storage.createFile("log.txt"), Response::OK);
+    for (int i = 0; i < 100; ++i) {
+        record[0] = static_cast<char>('a' + i % 26);
+        EXPECT_EQ(storage.appendFile("log.txt", record), Response::OK);
+        expected += record + "\n";
+    }
+
+    std::string out;
+    EXPECT_EQ(storage.readFile("log.txt", out), Response::OK);
+    EXPECT_GT(out.size(), FileContent::EXTENT_SIZE);
+    EXPECT_EQ(out, expected);
+}
+
+TEST_F(StorageManagerTest, ReadFileRange_ReturnsRequestedSlice) {
+    EXPECT_EQ(storage.createFile("range.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("range.txt", "0123456789"), Response::OK);
+
+    std::string out;
+    EXPECT_EQ(storage.readFileRange("range.txt", 3, 4, out), Response::OK);
+    EXPECT_EQ(out, "3456");
+    EXPECT_EQ(storage.readFileRange("range.txt", 8, 100, out), Response::OK);
+    EXPECT_EQ(out, "89\n");
+    EXPECT_EQ(storage.readFileRange("range.txt", 500, 10, out), Response::OK);
+    EXPECT_TRUE(out.empty());
+    EXPECT_EQ(storage.readFileRange("ghost.txt", 0, 10, out), Response::NotFound);
+}
+
+TEST_F(StorageManagerTest, WriteFileAt_OverwritesAndZeroFillsGap) {
+    EXPECT_EQ(storage.createFile("patch.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("patch.txt", "hello"), Response::OK);
+    EXPECT_EQ(storage.writeFileAt("patch.txt", 1, "EY"), Response::OK);
+    EXPECT_EQ(storage.writeFileAt("patch.txt", 8, "!"), Response::OK);
+
+    std::string out;
+    EXPECT_EQ(storage.readFile("patch.txt", out), Response::OK);
+    EXPECT_EQ(out, std::string("hEYlo\n\0\0!", 9));
+    EXPECT_EQ(storage.writeFileAt("ghost.txt", 0, "x"), Response::NotFound);
+}
+
+TEST_F(StorageManagerTest, StatFile_ReportsSizeWithoutReading) {
+    EXPECT_EQ(storage.createFile("sized.txt"), Response::OK);
+    StorageManager::FileStat st;
+    EXPECT_EQ(storage.statFile("sized.txt", st), Response::OK);
+    EXPECT_EQ(st.size, 0u);
+
+    EXPECT_EQ(storage.writeFile("sized.txt", "abc"), Response::OK);
+    EXPECT_EQ(storage.statFile("sized.txt", st), Response::OK);
+    EXPECT_EQ(st.size, 4u);
+    EXPECT_EQ(storage.statFile("missing.txt", st), Response::NotFound);
+}
+
+TEST_F(StorageManagerTest, StatFile_VersionMovesOnEveryChange) {
+    storage.setCaller(0, 42);
+    EXPECT_EQ(storage.createFile("meta.txt"), Response::OK);
+    storage.setCaller(0, 0);
+    StorageManager::FileStat st;
+    EXPECT_EQ(storage.statFile("meta.txt", st), Response::OK);
+    EXPECT_EQ(st.mode, StorageManager::DEFAULT_FILE_MODE);
+    EXPECT_EQ(st.links, 1u);
+    EXPECT_EQ(st.ownerUid, 0u);
+    EXPECT_EQ(st.ownerPid, 42);
+
+    uint64_t seen = st.version;
+    std::string content;
+    EXPECT_EQ(storage.readFile("meta.txt", content), Response::OK);
+    EXPECT_EQ(storage.statFile("meta.txt", st), Response::OK);
+    EXPECT_EQ(st.version, seen);
+
+    EXPECT_EQ(storage.writeFile("meta.txt", "abc"), Response::OK);
+    EXPECT_EQ(storage.statFile("meta.txt", st), Response::OK);
+    EXPECT_GT(st.version, seen);
+    seen = st.version;
+
+    EXPECT_EQ(storage.setFileMode("meta.txt", 0600), Response::OK);
+    EXPECT_EQ(storage.setFileMode("meta.txt", 010000), Response::InvalidArgument);
+    EXPECT_EQ(storage.setFileMode("ghost.txt", 0600), Response::NotFound);
+    EXPECT_EQ(storage.statFile("meta.txt", st), Response::OK);
+    EXPECT_EQ(st.mode, 0600);
+    EXPECT_GT(st.version, seen);
+
+    // copies keep mode and owner but are files of their own
+    EXPECT_EQ(storage.copyFile("meta.txt", "copy.txt"), Response::OK);
+    StorageManager::FileStat copy;
+    EXPECT_EQ(storage.statFile("copy.txt", copy), Response::OK);
+    EXPECT_EQ(copy.mode, 0600);
+    EXPECT_EQ(copy.ownerPid, 42);
+    EXPECT_NE(copy.version, st.version);
+}
+
+TEST_F(StorageManagerTest, PinFile_ViewKeepsBytesAcrossWrites) {
+    EXPECT_EQ(storage.createFile("pinned.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("pinned.txt", "before"), Response::OK);
+
+    std::shared_ptr<const FileContent> pinned;
+    EXPECT_EQ(storage.pinFile("pinned.txt", pinned), Response::OK);
+    ASSERT_NE(pinned, nullptr);
+
+    EXPECT_EQ(storage.appendFile("pinned.txt", "more"), Response::OK);
+    EXPECT_EQ(storage.writeFileAt("pinned.txt", 0, "B"), Response::OK);
+
+    std::string seen;
+    pinned->appendTo(seen);
+    EXPECT_EQ(seen, "before\n");
+
+    std::string out;
+    EXPECT_EQ(storage.readFile("pinned.txt", out), Response::OK);
+    EXPECT_EQ(out, "Before\nmore\n");
+}
+
+TEST_F(StorageManagerTest, PinFile_ContentOutlivesDeletedFile) {
+    EXPECT_EQ(storage.createFile("gone.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("gone.txt", "still here"), Response::OK);
+
+    std::shared_ptr<const FileContent> pinned;
+    EXPECT_EQ(storage.pinFile("gone.txt", pinned), Response::OK);
+    EXPECT_EQ(storage.deleteFile("gone.txt"), Response::OK);
+
+    std::string seen;
+    pinned->appendTo(seen);
+    EXPECT_EQ(seen, "still here\n");
+    EXPECT_EQ(storage.pinFile("gone.txt", pinned), Response::NotFound);
+}
+
 TEST_F(StorageManagerTest, EditFile_NotFoundOrEmptyShouldFailGracefully) {
     EXPECT_EQ(storage.editFile("ghost.txt", "data"), Response::NotFound);
     EXPECT_EQ(storage.editFile("", "data"), Response::InvalidArgument);
@@ -230,6 +421,20 @@ TEST_F(StorageManagerTest, CopyDir_ShouldCopyFolderWithContents) {
     EXPECT_EQ(out, "data\n");
 }
 
+TEST_F(StorageManagerTest, CopyDir_CopyOutlivesRemovedSource) {
+    EXPECT_EQ(storage.makeDir("orig"), Response::OK);
+    EXPECT_EQ(storage.createFile("orig/keep.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("orig/keep.txt", "kept"), Response::OK);
+    EXPECT_EQ(storage.copyDir("orig", "dup"), Response::OK);
+
+    EXPECT_EQ(storage.writeFile("orig/keep.txt", "changed"), Response::OK);
+    EXPECT_EQ(storage.removeDir("orig"), Response::OK);
+
+    std::string out;
+    EXPECT_EQ(storage.readFile("dup/keep.txt", out), Response::OK);
+    EXPECT_EQ(out, "kept\n");
+}
+
 TEST_F(StorageManagerTest, CopyDir_ShouldReturnAlreadyExistsIfSameNameInDest) {
     EXPECT_EQ(storage.makeDir("a"), Response::OK);
     EXPECT_EQ(storage.makeDir("b"), Response::OK);
@@ -360,6 +565,27 @@ TEST_F(StorageManagerTest, ListDir_ShouldIncludeHiddenFiles) {
     EXPECT_TRUE(foundHidden);
 }
 
+TEST_F(StorageManagerTest, ListDirEntries_ReturnsTypedEntries) {
+    EXPECT_EQ(storage.createFile("b.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("b.txt", "hello"), Response::OK);
+    EXPECT_EQ(storage.makeDir("docs"), Response::OK);
+    EXPECT_EQ(storage.createFile("a.txt"), Response::OK);
+
+    std::vector<StorageManager::DirEntry> entries;
+    EXPECT_EQ(storage.listDirEntries("", entries), Response::OK);
+    ASSERT_EQ(entries.size(), 3u);
+    EXPECT_EQ(entries[0].name, "docs");
+    EXPECT_TRUE(entries[0].isFolder);
+    EXPECT_EQ(entries[1].name, "b.txt");
+    EXPECT_FALSE(entries[1].isFolder);
+    EXPECT_EQ(entries[1].size, 6u);
+    EXPECT_EQ(entries[2].name, "a.txt");
+    EXPECT_EQ(entries[2].size, 0u);
+
+    EXPECT_EQ(storage.listDirEntries("missing", entries), Response::NotFound);
+    EXPECT_TRUE(entries.empty());
+}
+
 // PATH RESOLUTION
 TEST_F(StorageManagerTest, PathNormalization_ShouldCollapseExtraSlashes) {
     EXPECT_EQ(storage.makeDir("a/b/c"), Response::NotFound);
@@ -437,6 +663,56 @@ TEST_F(StorageManagerTest, ChangeDir_WithAbsolutePath) {
     EXPECT_EQ(storage.getWorkingDir(), "/a/b/c");
 }
 
+TEST_F(StorageManagerTest, PathCache_ShouldFollowMovedDirectory) {
+    EXPECT_EQ(storage.makeDir("a"), Response::OK);
+    EXPECT_EQ(storage.makeDir("a/b"), Response::OK);
+    EXPECT_EQ(storage.createFile("/a/b/f.txt"), Response::OK);
+    EXPECT_EQ(storage.fileExists("/a/b/f.txt"), Response::OK);
+
+    EXPECT_EQ(storage.moveDir("a", "z"), Response::OK);
+    EXPECT_EQ(storage.fileExists("/a/b/f.txt"), Response::NotFound);
+    EXPECT_EQ(storage.fileExists("/z/b/f.txt"), Response::OK);
+}
+
+TEST_F(StorageManagerTest, PathCache_ShouldForgetRemovedDirectory) {
+    EXPECT_EQ(storage.makeDir("a"), Response::OK);
+    EXPECT_EQ(storage.makeDir("a/b"), Response::OK);
+    EXPECT_EQ(storage.createFile("a/b/f.txt"), Response::OK);
+    EXPECT_EQ(storage.removeDir("a"), Response::OK);
+    EXPECT_EQ(storage.fileExists("a/b/f.txt"), Response::NotFound);
+
+    EXPECT_EQ(storage.makeDir("a"), Response::OK);
+    EXPECT_EQ(storage.makeDir("a/b"), Response::OK);
+    EXPECT_EQ(storage.fileExists("a/b/f.txt"), Response::NotFound);
+    EXPECT_EQ(storage.createFile("a/b/f.txt"), Response::OK);
+}
+
+TEST_F(StorageManagerTest, PathCache_RelativePathsTrackWorkingDirectory) {
+    EXPECT_EQ(storage.makeDir("x"), Response::OK);
+    EXPECT_EQ(storage.makeDir("x/y"), Response::OK);
+    EXPECT_EQ(storage.makeDir("y"), Response::OK);
+    EXPECT_EQ(storage.createFile("x/y/inner.txt"), Response::OK);
+
+    EXPECT_EQ(storage.changeDir("x"), Response::OK);
+    EXPECT_EQ(storage.fileExists("y/inner.txt"), Response::OK);
+    EXPECT_EQ(storage.changeDir("/"), Response::OK);
+    EXPECT_EQ(storage.fileExists("y/inner.txt"), Response::NotFound);
+}
+
+TEST_F(StorageManagerTest, PathCache_ResetClearsCachedFolders) {
+    EXPECT_EQ(storage.makeDir("a"), Response::OK);
+    EXPECT_EQ(storage.createFile("/a/f.txt"), Response::OK);
+    EXPECT_EQ(storage.reset(), Response::OK);
+    EXPECT_EQ(storage.fileExists("/a/f.txt"), Response::NotFound);
+    EXPECT_EQ(storage.changeDir("/a"), Response::NotFound);
+}
+
+TEST_F(StorageManagerTest, ChangeDir_MissingComponentBeforeParentReference) {
+    EXPECT_EQ(storage.makeDir("a"), Response::OK);
+    EXPECT_EQ(storage.changeDir("ghost/../a"), Response::NotFound);
+    EXPECT_EQ(storage.getWorkingDir(), "/");
+}
+
 // ELSE
 TEST_F(StorageManagerTest, FileLifecycle_EndToEnd) {
     EXPECT_EQ(storage.createFile("story.txt"), Response::OK);
@@ -470,3 +746,1237 @@ TEST_F(StorageManagerTest, PathOperations_EmptyPathReturnsInvalidArgument) {
     EXPECT_EQ(storage.deleteFile(""), Response::InvalidArgument);
     EXPECT_EQ(storage.removeDir(""), Response::InvalidArgument);
 }
+
+// SNAPSHOTS
+TEST_F(StorageManagerTest, BinarySnapshot_RoundTripsTree) {
+    std::string big(2 * FileContent::EXTENT_SIZE + 17, 'z');
+    EXPECT_EQ(storage.makeDir("docs"), Response::OK);
+    EXPECT_EQ(storage.makeDir("docs/deep"), Response::OK);
+    EXPECT_EQ(storage.createFile("docs/a.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("docs/a.txt", "alpha"), Response::OK);
+    EXPECT_EQ(storage.createFile("docs/deep/big.bin"), Response::OK);
+    EXPECT_EQ(storage.writeFile("docs/deep/big.bin", big), Response::OK);
+    EXPECT_EQ(storage.createFile("empty.txt"), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_snapshot.bin"), Response::OK);
+
+    StorageManager loaded;
+    loaded.setSysApi(&mockSysApi);
+    EXPECT_EQ(loaded.loadFromDisk("unit_snapshot"), Response::OK);
+
+    std::string out;
+    EXPECT_EQ(loaded.readFile("/docs/a.txt", out), Response::OK);
+    EXPECT_EQ(out, "alpha\n");
+    EXPECT_EQ(loaded.readFile("/docs/deep/big.bin", out), Response::OK);
+    EXPECT_EQ(out, big + "\n");
+    EXPECT_EQ(loaded.readFile("/empty.txt", out), Response::OK);
+    EXPECT_TRUE(out.empty());
+
+    StorageManager::DirUsage usage;
+    EXPECT_EQ(loaded.dirUsage("/docs", usage), Response::OK);
+    EXPECT_EQ(usage.folders, 2u);
+    EXPECT_EQ(usage.files, 2u);
+    EXPECT_EQ(usage.bytes, 6u + big.size() + 1);
+
+    std::filesystem::remove("data/unit_snapshot.bin");
+}
+
+TEST_F(StorageManagerTest, BinarySnapshot_CorruptFileKeepsCurrentTree) {
+    EXPECT_EQ(storage.createFile("keep.txt"), Response::OK);
+    std::filesystem::create_directories("data");
+    {
+        std::ofstream bad("data/unit_corrupt.bin", std::ios::binary);
+        bad << "S3ALSNAP but not really a snapshot";
+    }
+
+    EXPECT_EQ(storage.loadFromDisk("unit_corrupt.bin"), Response::Error);
+    EXPECT_EQ(storage.fileExists("keep.txt"), Response::OK);
+    EXPECT_EQ(storage.loadFromDisk("no_such_snapshot.bin"), Response::NotFound);
+
+    std::filesystem::remove("data/unit_corrupt.bin");
+}
+
+TEST_F(StorageManagerTest, JsonSnapshot_RoundTripsEscapedContent) {
+    // the two-byte character straddles the first extent boundary
+    std::string big(FileContent::EXTENT_SIZE - 1, 'a');
+    big += "\xC3\xA9 end";
+    std::string tricky = "quote \" slash \\ tab \t cr \r bell \x07 nul";
+    tricky += '\0';
+    tricky += " \xE2\x82\xAC";
+    EXPECT_EQ(storage.makeDir("nested"), Response::OK);
+    EXPECT_EQ(storage.makeDir("nested/inner \"dir\""), Response::OK);
+    EXPECT_EQ(storage.createFile("nested/inner \"dir\"/tricky.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("nested/inner \"dir\"/tricky.txt", tricky), Response::OK);
+    EXPECT_EQ(storage.createFile("big.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("big.txt", big), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_stream"), Response::OK);
+
+    // same text the DOM based writer produced
+    std::ifstream in("data/unit_stream.json", std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(nlohmann::json::parse(text).dump(4), text);
+
+    StorageManager loaded;
+    loaded.setSysApi(&mockSysApi);
+    EXPECT_EQ(loaded.loadFromDisk("unit_stream"), Response::OK);
+    std::string out;
+    EXPECT_EQ(loaded.readFile("/nested/inner \"dir\"/tricky.txt", out), Response::OK);
+    EXPECT_EQ(out, tricky + "\n");
+    EXPECT_EQ(loaded.readFile("/big.txt", out), Response::OK);
+    EXPECT_EQ(out, big + "\n");
+
+    std::filesystem::remove("data/unit_stream.json");
+}
+
+TEST_F(StorageManagerTest, JsonSnapshot_RejectsInvalidInput) {
+    EXPECT_EQ(storage.createFile("raw.bin"), Response::OK);
+    EXPECT_EQ(storage.writeFile("raw.bin", "\xFF\xFE"), Response::OK);
+    // not UTF-8, so the file could not be loaded back
+    EXPECT_EQ(storage.saveToDisk("unit_invalid"), Response::Error);
+    EXPECT_FALSE(std::filesystem::exists("data/unit_invalid.json"));
+
+    std::filesystem::create_directories("data");
+    {
+        std::ofstream bad("data/unit_truncated.json");
+        bad << R"({"name": "root", "files": [{"name": "a", "content": "x")";
+    }
+    EXPECT_EQ(storage.loadFromDisk("unit_truncated"), Response::Error);
+    EXPECT_EQ(storage.fileExists("raw.bin"), Response::OK);
+
+    std::filesystem::remove("data/unit_truncated.json");
+}
+
+TEST_F(StorageManagerTest, DeltaSnapshot_ReplaysChangesOnLoad) {
+    std::string big(2 * FileContent::EXTENT_SIZE, 'b');
+    EXPECT_EQ(storage.makeDir("keep"), Response::OK);
+    EXPECT_EQ(storage.createFile("keep/big.bin"), Response::OK);
+    EXPECT_EQ(storage.writeFile("keep/big.bin", big), Response::OK);
+    EXPECT_EQ(storage.makeDir("old"), Response::OK);
+    EXPECT_EQ(storage.createFile("old/a.txt"), Response::OK);
+    EXPECT_EQ(storage.createFile("gone.txt"), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_delta", true), Response::OK);  // nothing to build on: full save
+    auto baseSize = std::filesystem::file_size("data/unit_delta.bin");
+
+    EXPECT_EQ(storage.writeFile("old/a.txt", "changed"), Response::OK);
+    EXPECT_EQ(storage.moveDir("old", "renamed"), Response::OK);
+    EXPECT_EQ(storage.deleteFile("gone.txt"), Response::OK);
+    EXPECT_EQ(storage.makeDir("renamed/fresh"), Response::OK);
+    EXPECT_EQ(storage.createFile("renamed/fresh/new.txt"), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_delta", true), Response::OK);
+    EXPECT_EQ(storage.appendFile("renamed/a.txt", "again"), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_delta", true), Response::OK);
+
+    // only the changed files went out, the base was left alone
+    EXPECT_EQ(std::filesystem::file_size("data/unit_delta.bin"), baseSize);
+    EXPECT_LT(std::filesystem::file_size("data/unit_delta.bin.delta"), big.size());
+
+    StorageManager loaded;
+    loaded.setSysApi(&mockSysApi);
+    EXPECT_EQ(loaded.loadFromDisk("unit_delta.bin"), Response::OK);
+    std::string out;
+    EXPECT_EQ(loaded.readFile("/renamed/a.txt", out), Response::OK);
+    EXPECT_EQ(out, "changed\nagain\n");
+    EXPECT_EQ(loaded.readFile("/keep/big.bin", out), Response::OK);
+    EXPECT_EQ(out, big + "\n");
+    EXPECT_EQ(loaded.fileExists("/renamed/fresh/new.txt"), Response::OK);
+    EXPECT_EQ(loaded.fileExists("/gone.txt"), Response::NotFound);
+    EXPECT_EQ(loaded.changeDir("/old"), Response::NotFound);
+
+    std::filesystem::remove("data/unit_delta.bin");
+    std::filesystem::remove("data/unit_delta.bin.delta");
+}
+
+TEST_F(StorageManagerTest, DeltaSnapshot_CompactFoldsDeltasIntoBase) {
+    EXPECT_EQ(storage.createFile("a.txt"), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_compact.bin"), Response::OK);
+    EXPECT_EQ(storage.writeFile("a.txt", "one"), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_compact.bin", true), Response::OK);
+    EXPECT_TRUE(std::filesystem::exists("data/unit_compact.bin.delta"));
+
+    EXPECT_EQ(storage.compactSnapshot("unit_compact"), Response::OK);
+    EXPECT_FALSE(std::filesystem::exists("data/unit_compact.bin.delta"));
+
+    // still the base this tree tracks, so later changes keep going to deltas
+    EXPECT_EQ(storage.writeFile("a.txt", "two"), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_compact.bin", true), Response::OK);
+    EXPECT_TRUE(std::filesystem::exists("data/unit_compact.bin.delta"));
+
+    StorageManager loaded;
+    loaded.setSysApi(&mockSysApi);
+    EXPECT_EQ(loaded.loadFromDisk("unit_compact.bin", true), Response::OK);
+    std::string out;
+    EXPECT_EQ(loaded.readFile("/a.txt", out), Response::OK);
+    EXPECT_EQ(out, "two\n");
+
+    // a full save starts a new base and drops the old deltas
+    EXPECT_EQ(storage.saveToDisk("unit_compact.bin"), Response::OK);
+    EXPECT_FALSE(std::filesystem::exists("data/unit_compact.bin.delta"));
+    EXPECT_EQ(storage.compactSnapshot("no_such_snapshot"), Response::NotFound);
+
+    std::filesystem::remove("data/unit_compact.bin");
+}
+
+TEST_F(StorageManagerTest, Journal_ReplaysOperationsOnReopen) {
+    std::filesystem::remove("data/unit_journal.wal");
+    storage::JournalOptions options;
+    options.sync = storage::JournalSync::Always;
+    {
+        StorageManager crashed;
+        crashed.setSysApi(&mockSysApi);
+        EXPECT_EQ(crashed.openJournal("data/unit_journal.wal", options), Response::OK);
+        EXPECT_EQ(crashed.makeDir("work"), Response::OK);
+        EXPECT_EQ(crashed.changeDir("work"), Response::OK);
+        EXPECT_EQ(crashed.makeDir("inner"), Response::OK);
+        EXPECT_EQ(crashed.createFile("inner/log.txt"), Response::OK);
+        EXPECT_EQ(crashed.writeFile("inner/log.txt", "first"), Response::OK);
+        EXPECT_EQ(crashed.appendFile("inner/log.txt", "second"), Response::OK);
+        EXPECT_EQ(crashed.writeFileAt("inner/log.txt", 0, "FIRST"), Response::OK);
+        EXPECT_EQ(crashed.copyDir("inner", "copy"), Response::OK);
+        EXPECT_EQ(crashed.changeDir("inner"), Response::OK);
+        // relative paths and a move of the working directory's parent
+        EXPECT_EQ(crashed.moveDir("/work", "/moved"), Response::OK);
+        EXPECT_EQ(crashed.moveFile("log.txt", "renamed.txt"), Response::OK);
+        EXPECT_EQ(crashed.removeDir("/moved/copy"), Response::OK);
+        EXPECT_EQ(crashed.createFile("/gone.txt"), Response::OK);
+        EXPECT_EQ(crashed.deleteFile("/gone.txt"), Response::OK);
+        // no save: the tree only survives through the journal
+    }
+
+    StorageManager recovered;
+    recovered.setSysApi(&mockSysApi);
+    EXPECT_EQ(recovered.openJournal("data/unit_journal.wal", options), Response::OK);
+    std::string out;
+    EXPECT_EQ(recovered.readFile("/moved/inner/renamed.txt", out), Response::OK);
+    EXPECT_EQ(out, "FIRST\nsecond\n");
+    EXPECT_EQ(recovered.changeDir("/moved/copy"), Response::NotFound);
+    EXPECT_EQ(recovered.fileExists("/gone.txt"), Response::NotFound);
+    recovered.closeJournal();
+
+    std::filesystem::remove("data/unit_journal.wal");
+}
+
+TEST_F(StorageManagerTest, Journal_RestartsOnSaveAndDropsTornTail) {
+    const std::string path = "data/unit_journal_tail.wal";
+    std::filesystem::remove(path);
+    {
+        StorageManager first;
+        first.setSysApi(&mockSysApi);
+        EXPECT_EQ(first.openJournal(path), Response::OK);
+        EXPECT_EQ(first.createFile("saved.txt"), Response::OK);
+        EXPECT_EQ(first.saveToDisk("unit_journal_base.bin"), Response::OK);
+        EXPECT_EQ(first.writeFile("saved.txt", "after save"), Response::OK);
+    }
+    {
+        // half a record, as a crash in the middle of a write leaves it
+        std::ofstream torn(path, std::ios::binary | std::ios::app);
+        torn << "\x40\x00\x00\x00junk";
+    }
+    auto tornSize = std::filesystem::file_size(path);
+
+    {
+        StorageManager second;
+        second.setSysApi(&mockSysApi);
+        EXPECT_EQ(second.openJournal(path), Response::OK);
+        std::string out;
+        EXPECT_EQ(second.readFile("/saved.txt", out), Response::OK);
+        EXPECT_EQ(out, "after save\n");
+        EXPECT_LT(std::filesystem::file_size(path), tornSize);
+        EXPECT_EQ(second.createFile("later.txt"), Response::OK);
+    }
+
+    StorageManager third;
+    third.setSysApi(&mockSysApi);
+    EXPECT_EQ(third.openJournal(path), Response::OK);
+    EXPECT_EQ(third.fileExists("/later.txt"), Response::OK);
+    third.closeJournal();
+
+    std::filesystem::remove(path);
+    std::filesystem::remove("data/unit_journal_base.bin");
+}
+
+TEST_F(StorageManagerTest, AsyncSave_WritesTreeAsOfTheCall) {
+    const std::string path = "data/unit_async.wal";
+    std::filesystem::remove(path);
+    storage::JournalOptions options;
+    options.sync = storage::JournalSync::Always;
+    {
+        StorageManager live;
+        live.setSysApi(&mockSysApi);
+        EXPECT_EQ(live.openJournal(path, options), Response::OK);
+        EXPECT_EQ(live.createFile("kept.txt"), Response::OK);
+        EXPECT_EQ(live.writeFile("kept.txt", "before"), Response::OK);
+        EXPECT_EQ(live.saveToDiskAsync("unit_async.bin"), Response::OK);
+
+        // changes made while the worker runs stay out of the snapshot
+        EXPECT_EQ(live.writeFile("kept.txt", "after"), Response::OK);
+        EXPECT_EQ(live.createFile("later.txt"), Response::OK);
+        live.finishBackgroundSave();
+        EXPECT_EQ(live.appendFile("later.txt", "tail"), Response::OK);
+    }
+
+    StorageManager saved;
+    saved.setSysApi(&mockSysApi);
+    EXPECT_EQ(saved.loadFromDisk("unit_async.bin"), Response::OK);
+    std::string out;
+    EXPECT_EQ(saved.readFile("/kept.txt", out), Response::OK);
+    EXPECT_EQ(out, "before\n");
+    EXPECT_EQ(saved.fileExists("/later.txt"), Response::NotFound);
+
+    // the journal restarted on the new snapshot but kept what came after the copy
+    StorageManager recovered;
+    recovered.setSysApi(&mockSysApi);
+    EXPECT_EQ(recovered.openJournal(path, options), Response::OK);
+    EXPECT_EQ(recovered.readFile("/kept.txt", out), Response::OK);
+    EXPECT_EQ(out, "after\n");
+    EXPECT_EQ(recovered.readFile("/later.txt", out), Response::OK);
+    EXPECT_EQ(out, "tail\n");
+    recovered.closeJournal();
+
+    std::filesystem::remove(path);
+    std::filesystem::remove("data/unit_async.bin");
+}
+
+TEST_F(StorageManagerTest, AsyncSave_BecomesBaseForIncrementalSaves) {
+    EXPECT_EQ(storage.createFile("a.txt"), Response::OK);
+    EXPECT_EQ(storage.saveToDiskAsync("unit_async_base.bin"), Response::OK);
+    EXPECT_EQ(storage.writeFile("a.txt", "during"), Response::OK);
+    // waits for the background save, then appends only the change above
+    EXPECT_EQ(storage.saveToDisk("unit_async_base.bin", true), Response::OK);
+    EXPECT_TRUE(std::filesystem::exists("data/unit_async_base.bin.delta"));
+
+    StorageManager loaded;
+    loaded.setSysApi(&mockSysApi);
+    EXPECT_EQ(loaded.loadFromDisk("unit_async_base.bin"), Response::OK);
+    std::string out;
+    EXPECT_EQ(loaded.readFile("/a.txt", out), Response::OK);
+    EXPECT_EQ(out, "during\n");
+
+    std::filesystem::remove("data/unit_async_base.bin");
+    std::filesystem::remove("data/unit_async_base.bin.delta");
+}
+
+TEST_F(StorageManagerTest, Compression_BlocksRoundTrip) {
+    std::mt19937 random(7);
+    std::string noise(100000, '\0');
+    for (auto& c : noise) c = static_cast<char>(random());
+    std::string text;
+    while (text.size() < 300000) text += "line " + std::to_string(text.size() % 977) + " of a log file\n";
+
+    for (const std::string& input : {std::string(), std::string("tiny"), std::string(70000, 'x'), noise, text}) {
+        std::string packed(storage::compression::compressBound(input.size()), '\0');
+        packed.resize(storage::compression::compressBlock(input.data(), input.size(), packed.data()));
+        std::string unpacked(input.size(), '\0');
+        EXPECT_TRUE(storage::compression::decompressBlock(packed.data(), packed.size(), unpacked.data(),
+                                                          unpacked.size()));
+        EXPECT_EQ(unpacked, input);
+        if (!packed.empty() && input.size() > 1) {
+            // truncated input must be rejected, never read past the end
+            EXPECT_FALSE(storage::compression::decompressBlock(packed.data(), packed.size() - 1, unpacked.data(),
+                                                               unpacked.size()));
+        }
+    }
+}
+
+TEST_F(StorageManagerTest, CompressedSnapshot_RoundTripsBothFormats) {
+    std::string log;
+    while (log.size() < 3 * storage::compression::BLOCK_SIZE) log += "entry " + std::to_string(log.size()) + "\n";
+    EXPECT_EQ(storage.makeDir("logs"), Response::OK);
+    EXPECT_EQ(storage.createFile("logs/app.log"), Response::OK);
+    EXPECT_EQ(storage.writeFile("logs/app.log", log), Response::OK);
+
+    for (const std::string name : {"unit_packed.bin", "unit_packed"}) {
+        std::string path = name.ends_with(".bin") ? "data/" + name : "data/" + name + ".json";
+        EXPECT_EQ(storage.saveToDisk(name, false, true), Response::OK);
+        const auto& saved = storage.lastSnapshotStats();
+        EXPECT_TRUE(saved.compressed);
+        EXPECT_EQ(saved.storedBytes, std::filesystem::file_size(path));
+        EXPECT_LT(saved.storedBytes * 2, saved.rawBytes);
+
+        StorageManager loaded;
+        loaded.setSysApi(&mockSysApi);
+        EXPECT_EQ(loaded.loadFromDisk(name), Response::OK);
+        EXPECT_TRUE(loaded.lastSnapshotStats().compressed);
+        EXPECT_EQ(loaded.lastSnapshotStats().rawBytes, saved.rawBytes);
+        std::string out;
+        EXPECT_EQ(loaded.readFile("/logs/app.log", out), Response::OK);
+        EXPECT_EQ(out, log + "\n");
+        std::filesystem::remove(path);
+    }
+}
+
+TEST_F(StorageManagerTest, CompressedSnapshot_CorruptFileKeepsCurrentTree) {
+    EXPECT_EQ(storage.createFile("a.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("a.txt", std::string(10000, 'a')), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_packed_bad.bin", false, true), Response::OK);
+    // cut into the end marker
+    const std::string path = "data/unit_packed_bad.bin";
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+
+    StorageManager loaded;
+    loaded.setSysApi(&mockSysApi);
+    EXPECT_EQ(loaded.createFile("mine.txt"), Response::OK);
+    EXPECT_EQ(loaded.loadFromDisk("unit_packed_bad.bin"), Response::Error);
+    EXPECT_EQ(loaded.fileExists("mine.txt"), Response::OK);
+
+    std::filesystem::remove(path);
+}
+
+class CountingSysApi : public testHelpers::MockSysApi {
+public:
+    size_t liveAllocations() const { return allocations.size(); }
+
+    sys::SysResult deallocateMemoryBatch(const std::vector<void*>& ptrs) override {
+        ++bulkFrees;
+        return MockSysApi::deallocateMemoryBatch(ptrs);
+    }
+
+    size_t bulkFrees = 0;
+};
+
+TEST_F(StorageManagerTest, LazySnapshot_LoadsContentOnFirstUse) {
+    EXPECT_EQ(storage.makeDir("lazy"), Response::OK);
+    EXPECT_EQ(storage.createFile("lazy/one.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("lazy/one.txt", "first file"), Response::OK);
+    EXPECT_EQ(storage.createFile("lazy/two.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("lazy/two.txt", "second file"), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_lazy.bin"), Response::OK);
+
+    CountingSysApi countingSys;
+    {
+        StorageManager loaded;
+        loaded.setSysApi(&countingSys);
+        EXPECT_EQ(loaded.loadFromDisk("unit_lazy.bin", true), Response::OK);
+        EXPECT_EQ(countingSys.liveAllocations(), 0u);
+
+        StorageManager::FileStat st;
+        EXPECT_EQ(loaded.statFile("/lazy/two.txt", st), Response::OK);
+        EXPECT_EQ(st.size, 12u);
+        EXPECT_EQ(countingSys.liveAllocations(), 0u);
+
+        std::string out;
+        EXPECT_EQ(loaded.readFile("/lazy/one.txt", out), Response::OK);
+        EXPECT_EQ(out, "first file\n");
+        EXPECT_EQ(countingSys.liveAllocations(), 1u);
+
+        EXPECT_EQ(loaded.appendFile("/lazy/two.txt", "more"), Response::OK);
+        EXPECT_EQ(loaded.readFile("/lazy/two.txt", out), Response::OK);
+        EXPECT_EQ(out, "second file\nmore\n");
+    }
+    EXPECT_EQ(countingSys.liveAllocations(), 0u);
+
+    std::filesystem::remove("data/unit_lazy.bin");
+}
+
+TEST_F(StorageManagerTest, Dedup_IdenticalContentsShareOneCopy) {
+    CountingSysApi countingSys;
+    {
+        StorageManager dedup;
+        dedup.setSysApi(&countingSys);
+        EXPECT_EQ(dedup.createFile("a.txt"), Response::OK);
+        EXPECT_EQ(dedup.writeFile("a.txt", "template"), Response::OK);
+        EXPECT_EQ(countingSys.liveAllocations(), 1u);
+
+        EXPECT_EQ(dedup.copyFile("a.txt", "b.txt"), Response::OK);
+        EXPECT_EQ(dedup.createFile("c.txt"), Response::OK);
+        EXPECT_EQ(dedup.writeFile("c.txt", "template"), Response::OK);
+        EXPECT_EQ(countingSys.liveAllocations(), 1u);
+
+        auto stats = dedup.dedupStats();
+        EXPECT_EQ(stats.files, 3u);
+        EXPECT_EQ(stats.logicalBytes, 27u);
+        EXPECT_EQ(stats.contents, 1u);
+        EXPECT_EQ(stats.storedBytes, 9u);
+
+        // a write splits the file off without touching the others
+        EXPECT_EQ(dedup.appendFile("b.txt", "changed"), Response::OK);
+        std::string out;
+        EXPECT_EQ(dedup.readFile("a.txt", out), Response::OK);
+        EXPECT_EQ(out, "template\n");
+        EXPECT_EQ(dedup.readFile("b.txt", out), Response::OK);
+        EXPECT_EQ(out, "template\nchanged\n");
+        EXPECT_EQ(dedup.readFile("c.txt", out), Response::OK);
+        EXPECT_EQ(out, "template\n");
+        EXPECT_EQ(countingSys.liveAllocations(), 2u);
+    }
+    EXPECT_EQ(countingSys.liveAllocations(), 0u);
+}
+
+TEST_F(StorageManagerTest, Dedup_DisabledKeepsSeparateCopies) {
+    CountingSysApi countingSys;
+    StorageManager plain;
+    plain.setSysApi(&countingSys);
+    plain.setDedup(false);
+    EXPECT_EQ(plain.createFile("a.txt"), Response::OK);
+    EXPECT_EQ(plain.writeFile("a.txt", "template"), Response::OK);
+    EXPECT_EQ(plain.copyFile("a.txt", "b.txt"), Response::OK);
+    EXPECT_EQ(plain.createFile("c.txt"), Response::OK);
+    EXPECT_EQ(plain.writeFile("c.txt", "template"), Response::OK);
+    EXPECT_EQ(countingSys.liveAllocations(), 3u);
+    EXPECT_EQ(plain.dedupStats().contents, 3u);
+}
+
+TEST_F(StorageManagerTest, Dedup_SnapshotStoresEachContentOnce) {
+    std::string big(200000, 'x');
+    for (size_t i = 0; i < big.size(); i += 7) big[i] = static_cast<char>('a' + i % 26);
+    EXPECT_EQ(storage.makeDir("templates"), Response::OK);
+    EXPECT_EQ(storage.createFile("templates/base.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("templates/base.txt", big), Response::OK);
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(storage.copyFile("templates/base.txt", "templates/copy" + std::to_string(i) + ".txt"), Response::OK);
+    }
+    // same bytes arrived at separately still go in once
+    StorageManager separate;
+    separate.setSysApi(&mockSysApi);
+    separate.setDedup(false);
+    EXPECT_EQ(separate.createFile("one.txt"), Response::OK);
+    EXPECT_EQ(separate.writeFile("one.txt", big), Response::OK);
+    EXPECT_EQ(separate.createFile("two.txt"), Response::OK);
+    EXPECT_EQ(separate.writeFile("two.txt", big), Response::OK);
+
+    EXPECT_EQ(storage.saveToDisk("unit_dedup.bin"), Response::OK);
+    EXPECT_EQ(separate.saveToDisk("unit_dedup_separate.bin"), Response::OK);
+    EXPECT_LT(std::filesystem::file_size("data/unit_dedup.bin"), 2 * big.size());
+    EXPECT_LT(std::filesystem::file_size("data/unit_dedup_separate.bin"), 2 * big.size());
+
+    CountingSysApi countingSys;
+    {
+        StorageManager loaded;
+        loaded.setSysApi(&countingSys);
+        EXPECT_EQ(loaded.loadFromDisk("unit_dedup.bin"), Response::OK);
+        EXPECT_EQ(loaded.dedupStats().files, 9u);
+        EXPECT_EQ(loaded.dedupStats().contents, 1u);
+        size_t oneCopy = countingSys.liveAllocations();
+
+        std::string out;
+        EXPECT_EQ(loaded.readFile("/templates/copy5.txt", out), Response::OK);
+        EXPECT_EQ(out, big + "\n");
+        EXPECT_EQ(loaded.writeFile("/templates/copy5.txt", "own"), Response::OK);
+        EXPECT_EQ(loaded.readFile("/templates/copy6.txt", out), Response::OK);
+        EXPECT_EQ(out, big + "\n");
+        EXPECT_EQ(countingSys.liveAllocations(), oneCopy + 1);
+    }
+
+    std::filesystem::remove("data/unit_dedup.bin");
+    std::filesystem::remove("data/unit_dedup_separate.bin");
+}
+
+TEST_F(StorageManagerTest, BulkDelete_FreesLargeDirectoryInBatches) {
+    CountingSysApi countingSys;
+    StorageManager bulk;
+    bulk.setSysApi(&countingSys);
+    const size_t fileCount = 10000;
+    EXPECT_EQ(bulk.makeDir("big"), Response::OK);
+    EXPECT_EQ(bulk.makeDir("big/nested"), Response::OK);
+    for (size_t i = 0; i < fileCount; ++i) {
+        std::string name = (i % 2 ? "big/f" : "big/nested/f") + std::to_string(i);
+        ASSERT_EQ(bulk.createFile(name), Response::OK);
+        ASSERT_EQ(bulk.writeFile(name, "content " + std::to_string(i)), Response::OK);
+    }
+    EXPECT_EQ(countingSys.liveAllocations(), fileCount);
+
+    StorageManager::DirUsage usage;
+    EXPECT_EQ(bulk.dirUsage("big", usage), Response::OK);
+    EXPECT_EQ(usage.folders, 2u);
+    EXPECT_EQ(usage.files, fileCount);
+
+    EXPECT_EQ(bulk.removeDir("big"), Response::OK);
+    EXPECT_EQ(countingSys.liveAllocations(), 0u);
+    EXPECT_EQ(countingSys.bulkFrees, (fileCount + ContentAllocator::FREE_BATCH - 1) / ContentAllocator::FREE_BATCH);
+    EXPECT_EQ(bulk.dirUsage("big", usage), Response::NotFound);
+}
+
+TEST_F(StorageManagerTest, DirUsage_CountsWholeSubtree) {
+    EXPECT_EQ(storage.makeDir("proj"), Response::OK);
+    EXPECT_EQ(storage.makeDir("proj/src"), Response::OK);
+    EXPECT_EQ(storage.createFile("proj/readme"), Response::OK);
+    EXPECT_EQ(storage.writeFile("proj/readme", "hello"), Response::OK);
+    EXPECT_EQ(storage.createFile("proj/src/main.cpp"), Response::OK);
+    EXPECT_EQ(storage.writeFile("proj/src/main.cpp", "int main() {}"), Response::OK);
+
+    StorageManager::DirUsage usage;
+    EXPECT_EQ(storage.dirUsage("proj", usage), Response::OK);
+    EXPECT_EQ(usage.folders, 2u);
+    EXPECT_EQ(usage.files, 2u);
+    EXPECT_EQ(usage.bytes, 6u + 14u);
+
+    EXPECT_EQ(storage.dirUsage("/", usage), Response::OK);
+    EXPECT_EQ(usage.folders, 3u);
+    EXPECT_EQ(storage.changeDir("proj/src"), Response::OK);
+    EXPECT_EQ(storage.dirUsage("..", usage), Response::OK);
+    EXPECT_EQ(usage.files, 2u);
+    EXPECT_EQ(storage.dirUsage("", usage), Response::OK);
+    EXPECT_EQ(usage.files, 1u);
+    EXPECT_EQ(storage.dirUsage("/missing", usage), Response::NotFound);
+}
+
+TEST_F(StorageManagerTest, DirUsage_FollowsEveryChange) {
+    auto expectUsage = [&](const std::string& path, uint64_t folders, uint64_t files, uint64_t bytes) {
+        StorageManager::DirUsage usage;
+        ASSERT_EQ(storage.dirUsage(path, usage), Response::OK) << path;
+        EXPECT_EQ(usage.folders, folders) << path;
+        EXPECT_EQ(usage.files, files) << path;
+        EXPECT_EQ(usage.bytes, bytes) << path;
+    };
+
+    EXPECT_EQ(storage.makeDir("a"), Response::OK);
+    EXPECT_EQ(storage.makeDir("a/b"), Response::OK);
+    EXPECT_EQ(storage.createFile("a/b/f"), Response::OK);
+    EXPECT_EQ(storage.writeFile("a/b/f", "1234"), Response::OK);           // 5 bytes
+    EXPECT_EQ(storage.appendFile("a/b/f", "56"), Response::OK);            // 8
+    EXPECT_EQ(storage.editFile("a/b/f", "7"), Response::OK);               // 9
+    EXPECT_EQ(storage.writeFileAt("a/b/f", 12, "x"), Response::OK);        // 13
+    expectUsage("a", 2, 1, 13);
+    expectUsage("/", 3, 1, 13);
+
+    EXPECT_EQ(storage.writeFile("a/b/f", "z"), Response::OK);              // shrinks to 2
+    EXPECT_EQ(storage.copyFile("a/b/f", "a/g"), Response::OK);
+    EXPECT_EQ(storage.copyDir("a/b", "c"), Response::OK);
+    expectUsage("a", 2, 2, 4);
+    expectUsage("c", 1, 1, 2);
+    expectUsage("/", 4, 3, 6);
+
+    EXPECT_EQ(storage.moveFile("a/g", "c"), Response::OK);
+    EXPECT_EQ(storage.moveDir("c", "a/b"), Response::OK);
+    expectUsage("a/b", 2, 3, 6);
+    expectUsage("a", 3, 3, 6);
+
+    EXPECT_EQ(storage.deleteFile("a/b/f"), Response::OK);
+    expectUsage("a", 3, 2, 4);
+    EXPECT_EQ(storage.removeDir("a/b/c"), Response::OK);
+    expectUsage("/", 3, 0, 0);
+
+    EXPECT_EQ(storage.createFile("h"), Response::OK);
+    EXPECT_EQ(storage.writeFile("h", "hello"), Response::OK);
+    std::vector<StorageManager::DirEntry> entries;
+    EXPECT_EQ(storage.listDirEntries("/", entries), Response::OK);
+    ASSERT_EQ(entries.size(), 2u);
+    EXPECT_EQ(entries[0].size, 0u);
+    EXPECT_EQ(entries[0].files, 0u);
+    EXPECT_EQ(entries[1].size, 6u);
+    expectUsage("/", 3, 1, 6);
+}
+
+TEST_F(StorageManagerTest, Quota_RejectsGrowthPastLimit) {
+    EXPECT_EQ(storage.makeDir("jail"), Response::OK);
+    EXPECT_EQ(storage.makeDir("jail/inner"), Response::OK);
+    EXPECT_EQ(storage.createFile("jail/inner/log"), Response::OK);
+    EXPECT_EQ(storage.setQuota("jail", {10, 4}), Response::OK);
+    StorageManager::DirQuota quota;
+    EXPECT_EQ(storage.getQuota("jail", quota), Response::OK);
+    EXPECT_EQ(quota.bytes, 10u);
+    EXPECT_EQ(quota.inodes, 4u);
+    EXPECT_EQ(storage.setQuota("missing", {1, 1}), Response::NotFound);
+
+    // bytes: checked below the limited folder, at any depth
+    EXPECT_EQ(storage.writeFile("jail/inner/log", "12345678"), Response::OK);  // 9 bytes
+    EXPECT_EQ(storage.appendFile("jail/inner/log", "x"), Response::QuotaExceeded);
+    EXPECT_EQ(storage.editFile("jail/inner/log", "x"), Response::OK);          // 10
+    EXPECT_EQ(storage.writeFileAt("jail/inner/log", 10, "y"), Response::QuotaExceeded);
+    EXPECT_EQ(storage.writeFileAt("jail/inner/log", 0, "y"), Response::OK);    // overwrite, no growth
+    EXPECT_EQ(storage.writeFile("jail/inner/log", "short"), Response::OK);     // shrinking always fits
+    std::string out;
+    EXPECT_EQ(storage.readFile("jail/inner/log", out), Response::OK);
+    EXPECT_EQ(out, "short\n");
+
+    // inodes: inner, log and two more
+    EXPECT_EQ(storage.createFile("jail/a"), Response::OK);
+    EXPECT_EQ(storage.makeDir("jail/b"), Response::OK);
+    EXPECT_EQ(storage.createFile("jail/inner/c"), Response::QuotaExceeded);
+    EXPECT_EQ(storage.makeDir("jail/b/d"), Response::QuotaExceeded);
+    EXPECT_EQ(storage.fileExists("jail/inner/c"), Response::NotFound);
+
+    // copies and moves in from outside count, moves within do not
+    EXPECT_EQ(storage.createFile("outside"), Response::OK);
+    EXPECT_EQ(storage.copyFile("outside", "jail/b"), Response::QuotaExceeded);
+    EXPECT_EQ(storage.moveFile("outside", "jail/b"), Response::QuotaExceeded);
+    EXPECT_EQ(storage.copyDir("jail/inner", "jail/b"), Response::QuotaExceeded);
+    EXPECT_EQ(storage.moveFile("jail/a", "jail/b"), Response::OK);
+    EXPECT_EQ(storage.moveDir("jail/inner", "jail/b"), Response::OK);
+    EXPECT_EQ(storage.fileExists("outside"), Response::OK);
+
+    // freeing space makes room again; clearing the quota lifts it
+    EXPECT_EQ(storage.deleteFile("jail/b/a"), Response::OK);
+    EXPECT_EQ(storage.moveFile("outside", "jail"), Response::OK);
+    EXPECT_EQ(storage.setQuota("jail", {}), Response::OK);
+    EXPECT_EQ(storage.makeDir("jail/e"), Response::OK);
+}
+
+TEST_F(StorageManagerTest, Quota_PersistsInSnapshotsAndJournal) {
+    EXPECT_EQ(storage.makeDir("a"), Response::OK);
+    EXPECT_EQ(storage.makeDir("a/b"), Response::OK);
+    EXPECT_EQ(storage.setQuota("a", {100, 0}), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_quota.bin"), Response::OK);
+    EXPECT_EQ(storage.setQuota("a/b", {0, 7}), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_quota.bin", true), Response::OK);  // carried by the delta
+    EXPECT_EQ(storage.saveToDisk("unit_quota.json"), Response::OK);
+
+    for (const char* name : {"unit_quota.bin", "unit_quota.json"}) {
+        StorageManager loaded;
+        loaded.setSysApi(&mockSysApi);
+        EXPECT_EQ(loaded.loadFromDisk(name), Response::OK);
+        StorageManager::DirQuota quota;
+        EXPECT_EQ(loaded.getQuota("/a", quota), Response::OK);
+        EXPECT_EQ(quota.bytes, 100u) << name;
+        EXPECT_EQ(quota.inodes, 0u) << name;
+        EXPECT_EQ(loaded.getQuota("/a/b", quota), Response::OK);
+        EXPECT_EQ(quota.bytes, 0u) << name;
+        EXPECT_EQ(quota.inodes, 7u) << name;
+    }
+    std::filesystem::remove("data/unit_quota.bin");
+    std::filesystem::remove("data/unit_quota.bin.delta");
+    std::filesystem::remove("data/unit_quota.json");
+
+    std::filesystem::remove("data/unit_quota.wal");
+    {
+        StorageManager journaled;
+        journaled.setSysApi(&mockSysApi);
+        EXPECT_EQ(journaled.openJournal("data/unit_quota.wal"), Response::OK);
+        EXPECT_EQ(journaled.makeDir("q"), Response::OK);
+        EXPECT_EQ(journaled.changeDir("q"), Response::OK);
+        EXPECT_EQ(journaled.setQuota(".", {5, 1}), Response::OK);
+        journaled.closeJournal();
+    }
+    StorageManager recovered;
+    recovered.setSysApi(&mockSysApi);
+    EXPECT_EQ(recovered.openJournal("data/unit_quota.wal"), Response::OK);
+    StorageManager::DirQuota quota;
+    EXPECT_EQ(recovered.getQuota("/q", quota), Response::OK);
+    EXPECT_EQ(quota.bytes, 5u);
+    EXPECT_EQ(quota.inodes, 1u);
+    recovered.closeJournal();
+    std::filesystem::remove("data/unit_quota.wal");
+}
+
+TEST_F(StorageManagerTest, FileMeta_PersistsInSnapshotsAndJournal) {
+    storage.setCaller(7, 3);
+    EXPECT_EQ(storage.createFile("owned.txt"), Response::OK);
+    storage.setCaller(0, 0);
+    EXPECT_EQ(storage.createFile("plain.txt"), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_meta.bin"), Response::OK);
+    EXPECT_EQ(storage.setFileMode("plain.txt", 0755), Response::OK);
+    EXPECT_EQ(storage.saveToDisk("unit_meta.bin", true), Response::OK);  // carried by the delta
+    EXPECT_EQ(storage.saveToDisk("unit_meta.json"), Response::OK);
+
+    auto expectMeta = [](StorageManager& tree, const char* name) {
+        StorageManager::FileStat st;
+        EXPECT_EQ(tree.statFile("/owned.txt", st), Response::OK);
+        EXPECT_EQ(st.mode, StorageManager::DEFAULT_FILE_MODE) << name;
+        EXPECT_EQ(st.ownerUid, 7u) << name;
+        EXPECT_EQ(st.ownerPid, 3) << name;
+        EXPECT_EQ(tree.statFile("/plain.txt", st), Response::OK);
+        EXPECT_EQ(st.mode, 0755) << name;
+        EXPECT_EQ(st.ownerPid, 0) << name;
+    };
+    for (const char* name : {"unit_meta.bin", "unit_meta.json"}) {
+        StorageManager loaded;
+        loaded.setSysApi(&mockSysApi);
+        EXPECT_EQ(loaded.loadFromDisk(name), Response::OK);
+        expectMeta(loaded, name);
+    }
+    std::filesystem::remove("data/unit_meta.bin");
+    std::filesystem::remove("data/unit_meta.bin.delta");
+    std::filesystem::remove("data/unit_meta.json");
+
+    std::filesystem::remove("data/unit_meta.wal");
+    {
+        StorageManager journaled;
+        journaled.setSysApi(&mockSysApi);
+        EXPECT_EQ(journaled.openJournal("data/unit_meta.wal"), Response::OK);
+        journaled.setCaller(7, 3);
+        EXPECT_EQ(journaled.createFile("owned.txt"), Response::OK);
+        journaled.setCaller(0, 0);
+        EXPECT_EQ(journaled.createFile("plain.txt"), Response::OK);
+        EXPECT_EQ(journaled.setFileMode("plain.txt", 0755), Response::OK);
+        journaled.closeJournal();
+    }
+    StorageManager recovered;
+    recovered.setSysApi(&mockSysApi);
+    recovered.setCaller(9, 9);  // whoever replays does not take the files over
+    EXPECT_EQ(recovered.openJournal("data/unit_meta.wal"), Response::OK);
+    expectMeta(recovered, "journal");
+    recovered.closeJournal();
+    std::filesystem::remove("data/unit_meta.wal");
+}
+
+TEST_F(StorageManagerTest, Concurrency_ReadersSeeWholeWrites) {
+    constexpr int FILES = 8;
+    EXPECT_EQ(storage.makeDir("/shared"), Response::OK);
+    for (int i = 0; i < FILES; ++i) {
+        std::string path = "/shared/f" + std::to_string(i);
+        EXPECT_EQ(storage.createFile(path), Response::OK);
+        EXPECT_EQ(storage.writeFile(path, std::string(1000, 'a')), Response::OK);
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&, r] {
+            std::string content;
+            std::vector<StorageManager::DirEntry> entries;
+            for (int n = 0; !stop; ++n) {
+                std::string path = "/shared/f" + std::to_string((n + r) % FILES);
+                if (storage.readFile(path, content) != Response::OK) {
+                    ++torn;
+                    continue;
+                }
+                // every write fills the file with one letter
+                if (content.size() < 2 || content.find_first_not_of(content[0]) != content.size() - 1) ++torn;
+                storage.listDirEntries("/shared", entries);
+            }
+        });
+    }
+
+    for (int round = 0; round < 200; ++round) {
+        std::string path = "/shared/f" + std::to_string(round % FILES);
+        EXPECT_EQ(storage.writeFile(path, std::string(500 + round, static_cast<char>('a' + round % 26))), Response::OK);
+        EXPECT_EQ(storage.makeDir("/shared/tmp"), Response::OK);
+        EXPECT_EQ(storage.removeDir("/shared/tmp"), Response::OK);
+    }
+    stop = true;
+    for (auto& reader : readers) reader.join();
+    EXPECT_EQ(torn.load(), 0);
+}
+
+TEST_F(StorageManagerTest, Concurrency_WorkingDirIsPerThread) {
+    EXPECT_EQ(storage.makeDir("/a"), Response::OK);
+    EXPECT_EQ(storage.makeDir("/b"), Response::OK);
+    EXPECT_EQ(storage.makeDir("/b/c"), Response::OK);
+    EXPECT_EQ(storage.changeDir("/a"), Response::OK);
+
+    std::promise<void> entered, removed;
+    std::string before, after;
+    std::thread other([&] {
+        before = storage.getWorkingDir();
+        storage.changeDir("/b/c");
+        storage.createFile("here.txt");
+        entered.set_value();
+        removed.get_future().wait();
+        after = storage.getWorkingDir();
+    });
+
+    entered.get_future().wait();
+    EXPECT_EQ(storage.getWorkingDir(), "/a");
+    EXPECT_EQ(storage.fileExists("/b/c/here.txt"), Response::OK);
+    EXPECT_EQ(storage.fileExists("here.txt"), Response::NotFound);
+    // removing another thread's working directory moves it up
+    EXPECT_EQ(storage.removeDir("/b/c"), Response::OK);
+    removed.set_value();
+    other.join();
+
+    EXPECT_EQ(before, "/");
+    EXPECT_EQ(after, "/b");
+    EXPECT_EQ(storage.getWorkingDir(), "/a");
+}
+
+TEST_F(StorageManagerTest, ImportTree_CopiesHostDirectory) {
+    namespace fs = std::filesystem;
+    fs::path host = fs::temp_directory_path() / "s3al_import_test";
+    fs::remove_all(host);
+    fs::create_directories(host / "sub" / "deeper");
+    std::string big(5 * 1024 * 1024 + 123, '\0');
+    for (size_t i = 0; i < big.size(); ++i) big[i] = static_cast<char>('a' + i * 31 % 26);
+    std::ofstream(host / "big.bin", std::ios::binary) << big;
+    std::ofstream(host / "sub" / "note.txt") << "hello";
+    std::ofstream(host / "sub" / "deeper" / "empty");
+    fs::create_symlink(host / "sub", host / "link");
+    auto stamp = fs::file_time_type::clock::now() - std::chrono::hours(48);
+    fs::last_write_time(host / "sub" / "note.txt", stamp);
+
+    EXPECT_EQ(storage.makeDir("/in"), Response::OK);
+    StorageManager::ImportStats stats;
+    EXPECT_EQ(storage.importTree(host.string(), "/in/tree", stats), Response::OK);
+    EXPECT_EQ(stats.files, 3u);
+    EXPECT_EQ(stats.folders, 3u);
+    EXPECT_EQ(stats.bytes, big.size() + 5);
+    EXPECT_EQ(stats.skipped, 1u);
+
+    std::string content;
+    EXPECT_EQ(storage.readFile("/in/tree/big.bin", content), Response::OK);
+    EXPECT_TRUE(content == big);
+    EXPECT_EQ(storage.readFile("/in/tree/sub/note.txt", content), Response::OK);
+    EXPECT_EQ(content, "hello");
+    EXPECT_EQ(storage.fileExists("/in/tree/sub/deeper/empty"), Response::OK);
+    StorageManager::FileStat stat;
+    EXPECT_EQ(storage.statFile("/in/tree/sub/note.txt", stat), Response::OK);
+    EXPECT_LT(stat.modifiedAt, std::chrono::system_clock::now() - std::chrono::hours(47));
+    StorageManager::DirUsage usage;
+    EXPECT_EQ(storage.dirUsage("/in", usage), Response::OK);
+    EXPECT_EQ(usage.files, 3u);
+    EXPECT_EQ(usage.bytes, big.size() + 5);
+
+    EXPECT_EQ(storage.importTree(host.string(), "/in/tree", stats), Response::AlreadyExists);
+    EXPECT_EQ(storage.importTree((host / "missing").string(), "/in/other", stats), Response::NotFound);
+    EXPECT_EQ(storage.setQuota("/in", {1024, 0}), Response::OK);
+    EXPECT_EQ(storage.importTree(host.string(), "/in/other", stats), Response::QuotaExceeded);
+    EXPECT_EQ(storage.fileExists("/in/other/sub/note.txt"), Response::NotFound);
+    fs::remove_all(host);
+}
+
+TEST_F(StorageManagerTest, ImportTree_ReplaysFromJournal) {
+    namespace fs = std::filesystem;
+    fs::path host = fs::temp_directory_path() / "s3al_import_journal";
+    fs::remove_all(host);
+    fs::create_directories(host / "a");
+    std::ofstream(host / "a" / "one.txt") << "first";
+    std::ofstream(host / "two.txt") << "second";
+    std::filesystem::remove("data/unit_import.wal");
+    {
+        StorageManager journaled;
+        journaled.setSysApi(&mockSysApi);
+        EXPECT_EQ(journaled.openJournal("data/unit_import.wal"), Response::OK);
+        StorageManager::ImportStats stats;
+        EXPECT_EQ(journaled.importTree(host.string(), "imported", stats), Response::OK);
+        journaled.closeJournal();
+    }
+    fs::remove_all(host);
+
+    StorageManager recovered;
+    recovered.setSysApi(&mockSysApi);
+    EXPECT_EQ(recovered.openJournal("data/unit_import.wal"), Response::OK);
+    std::string content;
+    EXPECT_EQ(recovered.readFile("/imported/a/one.txt", content), Response::OK);
+    EXPECT_EQ(content, "first");
+    EXPECT_EQ(recovered.readFile("/imported/two.txt", content), Response::OK);
+    EXPECT_EQ(content, "second");
+    recovered.closeJournal();
+    std::filesystem::remove("data/unit_import.wal");
+}
+
+TEST_F(StorageManagerTest, ExportTree_WritesSubtreeToHost) {
+    namespace fs = std::filesystem;
+    fs::path host = fs::temp_directory_path() / "s3al_export_tree";
+    fs::remove_all(host);
+    std::string big(3 * 1024 * 1024 + 7, '\0');
+    for (size_t i = 0; i < big.size(); ++i) big[i] = static_cast<char>(i * 7 % 251);
+    EXPECT_EQ(storage.makeDir("/out"), Response::OK);
+    EXPECT_EQ(storage.makeDir("/out/sub"), Response::OK);
+    EXPECT_EQ(storage.createFile("/out/big.bin"), Response::OK);
+    EXPECT_EQ(storage.writeFileAt("/out/big.bin", 0, big), Response::OK);
+    EXPECT_EQ(storage.createFile("/out/sub/note.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("/out/sub/note.txt", "hello"), Response::OK);
+
+    StorageManager::ExportStats stats;
+    EXPECT_EQ(storage.exportTree("/out", host.string(), stats), Response::OK);
+    EXPECT_EQ(stats.files, 2u);
+    EXPECT_EQ(stats.folders, 2u);
+    EXPECT_EQ(stats.bytes, big.size() + 6);
+
+    std::ifstream bigIn(host / "big.bin", std::ios::binary);
+    std::string exported((std::istreambuf_iterator<char>(bigIn)), std::istreambuf_iterator<char>());
+    EXPECT_TRUE(exported == big);
+    std::ifstream noteIn(host / "sub" / "note.txt", std::ios::binary);
+    std::string note((std::istreambuf_iterator<char>(noteIn)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(note, "hello\n");
+
+    StorageManager::FileStat stat;
+    EXPECT_EQ(storage.statFile("/out/sub/note.txt", stat), Response::OK);
+    auto hostStamp = std::chrono::file_clock::to_sys(fs::last_write_time(host / "sub" / "note.txt"));
+    EXPECT_EQ(std::chrono::duration_cast<std::chrono::seconds>(hostStamp.time_since_epoch()).count(),
+              std::chrono::duration_cast<std::chrono::seconds>(stat.modifiedAt.time_since_epoch()).count());
+
+    EXPECT_EQ(storage.exportTree("/missing", host.string(), stats), Response::NotFound);
+    EXPECT_EQ(storage.exportTree("/out/big.bin", host.string(), stats), Response::NotFound);
+    fs::remove_all(host);
+}
+
+TEST_F(StorageManagerTest, NodeNames_InternedOnceAndFoundWithoutAdding) {
+    using storage::NodeName;
+    NodeName first("node-name-interned-once");
+    NodeName second(std::string("node-name-interned-once"));
+    EXPECT_TRUE(first == second);
+    EXPECT_EQ(first.view(), "node-name-interned-once");
+    EXPECT_TRUE(NodeName::lookup("node-name-interned-once") == first);
+    EXPECT_TRUE(NodeName::lookup("node-name-never-used").empty());
+    // looking a name up does not add it
+    EXPECT_TRUE(NodeName::lookup("node-name-never-used").empty());
+    EXPECT_EQ("/dir/" + first, "/dir/node-name-interned-once");
+
+    // a name no node had yet resolves like any other once it is created
+    EXPECT_EQ(storage.makeDir("node-name-fresh-dir"), Response::OK);
+    EXPECT_EQ(storage.createFile("node-name-fresh-dir/node-name-fresh-file"), Response::OK);
+    EXPECT_EQ(storage.fileExists("node-name-fresh-dir/node-name-fresh-file"), Response::OK);
+    EXPECT_EQ(storage.moveFile("node-name-fresh-dir/node-name-fresh-file", "node-name-fresh-dir/renamed-once"),
+              Response::OK);
+    EXPECT_EQ(storage.fileExists("node-name-fresh-dir/renamed-once"), Response::OK);
+    EXPECT_EQ(storage.fileExists("node-name-fresh-dir/node-name-fresh-file"), Response::NotFound);
+}
+
+TEST_F(StorageManagerTest, CopyDir_StampsWholeCopyOnce) {
+    EXPECT_EQ(storage.makeDir("src"), Response::OK);
+    EXPECT_EQ(storage.makeDir("src/deep"), Response::OK);
+    EXPECT_EQ(storage.createFile("src/a.txt"), Response::OK);
+    EXPECT_EQ(storage.createFile("src/deep/b.txt"), Response::OK);
+    EXPECT_EQ(storage.copyDir("src", "dst"), Response::OK);
+
+    StorageManager::FileStat first, second;
+    EXPECT_EQ(storage.statFile("dst/a.txt", first), Response::OK);
+    EXPECT_EQ(storage.statFile("dst/deep/b.txt", second), Response::OK);
+    EXPECT_EQ(first.createdAt, second.createdAt);
+    EXPECT_EQ(first.modifiedAt, second.createdAt);
+}
+
+TEST_F(StorageManagerTest, CopyDir_ParallelCopyMatchesSource) {
+    CountingSysApi countingSys;
+    StorageManager plain;
+    plain.setSysApi(&countingSys);
+    plain.setDedup(false);
+
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    EXPECT_EQ(plain.makeDir("data"), Response::OK);
+    EXPECT_EQ(plain.makeDir("data/sub"), Response::OK);
+    std::vector<std::string> contents;
+    for (int i = 0; i < 12; ++i) {
+        std::string content(150000 + i * 1000, ' ');
+        for (char& c : content) c = static_cast<char>(letter(generator));
+        std::string name = (i % 3 ? "data/f" : "data/sub/f") + std::to_string(i);
+        ASSERT_EQ(plain.createFile(name), Response::OK);
+        ASSERT_EQ(plain.writeFile(name, content), Response::OK);
+        contents.push_back(content + "\n");
+    }
+    size_t before = countingSys.liveAllocations();
+
+    EXPECT_EQ(plain.copyDir("data", "copy"), Response::OK);
+    EXPECT_EQ(countingSys.liveAllocations(), 2 * before);
+    for (int i = 0; i < 12; ++i) {
+        std::string out;
+        std::string name = (i % 3 ? "copy/f" : "copy/sub/f") + std::to_string(i);
+        EXPECT_EQ(plain.readFile(name, out), Response::OK);
+        EXPECT_EQ(out, contents[i]);
+    }
+
+    EXPECT_EQ(plain.writeFileAt("copy/f1", 0, "CHANGED"), Response::OK);
+    std::string out;
+    EXPECT_EQ(plain.readFile("data/f1", out), Response::OK);
+    EXPECT_EQ(out, contents[1]);
+}
+
+TEST_F(StorageManagerTest, Glob_MatchesWildcards) {
+    EXPECT_TRUE(StorageManager::globMatch("*.txt", "notes.txt"));
+    EXPECT_TRUE(StorageManager::globMatch("n?tes*", "notes.txt"));
+    EXPECT_TRUE(StorageManager::globMatch("*a*b*", "xxaxxbxx"));
+    EXPECT_TRUE(StorageManager::globMatch("*", ""));
+    EXPECT_FALSE(StorageManager::globMatch("*.txt", "notes.md"));
+    EXPECT_FALSE(StorageManager::globMatch("?", ""));
+    EXPECT_FALSE(StorageManager::globMatch("a*b", "ab_"));
+}
+
+TEST_F(StorageManagerTest, Find_FiltersByNameTypeSizeAndTime) {
+    EXPECT_EQ(storage.makeDir("docs"), Response::OK);
+    EXPECT_EQ(storage.makeDir("docs/old"), Response::OK);
+    EXPECT_EQ(storage.createFile("docs/a.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("docs/a.txt", std::string(5000, 'a')), Response::OK);
+    EXPECT_EQ(storage.createFile("docs/old/b.txt"), Response::OK);
+    EXPECT_EQ(storage.createFile("docs/old/c.md"), Response::OK);
+
+    auto collect = [this](const StorageManager::FindQuery& query) {
+        std::vector<std::string> paths;
+        EXPECT_EQ(storage.find("docs", query, [&](const StorageManager::FoundEntry& entry) {
+            paths.emplace_back(entry.path);
+            return true;
+        }), Response::OK);
+        return paths;
+    };
+
+    StorageManager::FindQuery all;
+    EXPECT_EQ(collect(all), (std::vector<std::string>{"/docs", "/docs/a.txt", "/docs/old", "/docs/old/b.txt",
+                                                      "/docs/old/c.md"}));
+
+    StorageManager::FindQuery byName;
+    byName.nameGlob = "*.txt";
+    EXPECT_EQ(collect(byName), (std::vector<std::string>{"/docs/a.txt", "/docs/old/b.txt"}));
+
+    StorageManager::FindQuery folders;
+    folders.type = StorageManager::FindQuery::Type::Folder;
+    EXPECT_EQ(collect(folders), (std::vector<std::string>{"/docs", "/docs/old"}));
+
+    StorageManager::FindQuery big;
+    big.minSize = 4096;
+    EXPECT_EQ(collect(big), (std::vector<std::string>{"/docs/a.txt"}));
+
+    StorageManager::FindQuery future;
+    future.modifiedAfter = std::chrono::system_clock::now() + std::chrono::hours(1);
+    EXPECT_TRUE(collect(future).empty());
+    StorageManager::FindQuery recent;
+    recent.type = StorageManager::FindQuery::Type::File;
+    recent.modifiedAfter = std::chrono::system_clock::now() - std::chrono::hours(1);
+    EXPECT_EQ(collect(recent).size(), 3u);
+
+    EXPECT_EQ(storage.find("missing", all, [](const StorageManager::FoundEntry&) { return true; }), Response::NotFound);
+}
+
+TEST_F(StorageManagerTest, Grep_FindsLiteralAcrossExtents) {
+    // the needle straddles the first extent boundary
+    std::string content(FileContent::EXTENT_SIZE - 3, 'x');
+    content += "\nNEEDLE here\n";
+    content += std::string(100000, 'y') + "\nsecond NEEDLE\n";
+    EXPECT_EQ(storage.createFile("big"), Response::OK);
+    EXPECT_EQ(storage.writeFile("big", content), Response::OK);
+
+    StorageManager::GrepQuery query;
+    query.pattern = "EDLE";
+    std::vector<std::pair<size_t, std::string>> hits;
+    EXPECT_EQ(storage.grep("big", query, [&](const StorageManager::GrepMatch& match) {
+        EXPECT_EQ(match.path, "/big");
+        hits.emplace_back(match.lineNumber, std::string(match.line));
+        return true;
+    }), Response::OK);
+    ASSERT_EQ(hits.size(), 2u);
+    EXPECT_EQ(hits[0], (std::pair<size_t, std::string>{2, "NEEDLE here"}));
+    EXPECT_EQ(hits[1], (std::pair<size_t, std::string>{4, "second NEEDLE"}));
+}
+
+TEST_F(StorageManagerTest, Grep_RegexIgnoreCaseAndEarlyStop) {
+    EXPECT_EQ(storage.makeDir("src"), Response::OK);
+    EXPECT_EQ(storage.createFile("src/a.cpp"), Response::OK);
+    EXPECT_EQ(storage.writeFile("src/a.cpp", "int x = 1;\n// TODO fix\nint y = 22;"), Response::OK);
+    EXPECT_EQ(storage.createFile("src/b.h"), Response::OK);
+    EXPECT_EQ(storage.writeFile("src/b.h", "// todo later"), Response::OK);
+
+    auto lines = [this](const StorageManager::GrepQuery& query) {
+        std::vector<std::string> found;
+        EXPECT_EQ(storage.grep("src", query, [&](const StorageManager::GrepMatch& match) {
+            found.push_back(std::string(match.path) + ":" + std::to_string(match.lineNumber));
+            return true;
+        }), Response::OK);
+        return found;
+    };
+
+    StorageManager::GrepQuery regex;
+    regex.pattern = "[0-9]{2}";
+    regex.regex = true;
+    EXPECT_EQ(lines(regex), (std::vector<std::string>{"/src/a.cpp:3"}));
+
+    StorageManager::GrepQuery icase;
+    icase.pattern = "todo";
+    icase.ignoreCase = true;
+    EXPECT_EQ(lines(icase), (std::vector<std::string>{"/src/a.cpp:2", "/src/b.h:1"}));
+    icase.nameGlob = "*.h";
+    EXPECT_EQ(lines(icase), (std::vector<std::string>{"/src/b.h:1"}));
+
+    StorageManager::GrepQuery literal;
+    literal.pattern = "int";
+    size_t calls = 0;
+    EXPECT_EQ(storage.grep("src", literal, [&](const StorageManager::GrepMatch&) { return ++calls < 1; }), Response::OK);
+    EXPECT_EQ(calls, 1u);
+
+    StorageManager::GrepQuery broken;
+    broken.pattern = "(";
+    broken.regex = true;
+    EXPECT_EQ(storage.grep("src", broken, [](const StorageManager::GrepMatch&) { return true; }), Response::InvalidArgument);
+}
+
+namespace {
+
+std::vector<std::string> indexHits(const StorageManager& storage, const std::string& query) {
+    std::vector<std::string> hits;
+    storage.searchIndex(query, [&](const StorageManager::IndexHit& hit) {
+        std::string entry(hit.path);
+        for (uint64_t offset : hit.offsets) entry += " " + std::to_string(offset);
+        hits.push_back(entry);
+        return true;
+    });
+    std::sort(hits.begin(), hits.end());
+    return hits;
+}
+
+}  // namespace
+
+TEST_F(StorageManagerTest, Index_FollowsWritesAppendsAndDeletes) {
+    EXPECT_EQ(storage.searchIndex("x", [](const StorageManager::IndexHit&) { return true; }), Response::Error);
+    storage.setIndexing(true);
+    EXPECT_EQ(storage.makeDir("docs"), Response::OK);
+    EXPECT_EQ(storage.createFile("docs/a.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("docs/a.txt", "Hello world, hello index"), Response::OK);
+    EXPECT_EQ(storage.createFile("docs/b.txt"), Response::OK);
+    EXPECT_EQ(storage.writeFile("docs/b.txt", "world peace"), Response::OK);
+
+    EXPECT_EQ(indexHits(storage, "HELLO"), (std::vector<std::string>{"/docs/a.txt 0 13"}));
+    EXPECT_EQ(indexHits(storage, "world"), (std::vector<std::string>{"/docs/a.txt 6", "/docs/b.txt 0"}));
+    EXPECT_EQ(indexHits(storage, "world hello"), (std::vector<std::string>{"/docs/a.txt 0 6 13"}));
+    EXPECT_TRUE(indexHits(storage, "world missing").empty());
+    EXPECT_EQ(storage.searchIndex("  ,. ", [](const StorageManager::IndexHit&) { return true; }),
+              Response::InvalidArgument);
+
+    // "peace" ends the old content before its newline; "peacetime" does not
+    EXPECT_EQ(storage.writeFile("docs/b.txt", "world peace"), Response::OK);
+    EXPECT_EQ(storage.writeFileAt("docs/b.txt", 11, "time"), Response::OK);
+    EXPECT_EQ(storage.appendFile("docs/b.txt", "keeper"), Response::OK);
+    EXPECT_TRUE(indexHits(storage, "peace").empty());
+    EXPECT_EQ(indexHits(storage, "peacetimekeeper"), (std::vector<std::string>{"/docs/b.txt 6"}));
+    EXPECT_EQ(storage.editFile("docs/b.txt", " again"), Response::OK);
+    EXPECT_EQ(indexHits(storage, "again"), (std::vector<std::string>{"/docs/b.txt 23"}));
+
+    EXPECT_EQ(storage.copyFile("docs/a.txt", "docs/c.txt"), Response::OK);
+    EXPECT_EQ(storage.moveFile("docs/b.txt", "moved.txt"), Response::OK);
+    EXPECT_EQ(indexHits(storage, "world"),
+              (std::vector<std::string>{"/docs/a.txt 6", "/docs/c.txt 6", "/moved.txt 0"}));
+
+    EXPECT_EQ(storage.deleteFile("docs/a.txt"), Response::OK);
+    EXPECT_EQ(storage.copyDir("docs", "copy"), Response::OK);
+    EXPECT_EQ(storage.moveDir("copy", "docs/inner"), Response::OK);
+    EXPECT_EQ(indexHits(storage, "index"), (std::vector<std::string>{"/docs/c.txt 19", "/docs/inner/c.txt 19"}));
+    EXPECT_EQ(storage.removeDir("docs"), Response::OK);
+    EXPECT_TRUE(indexHits(storage, "index").empty());
+    EXPECT_EQ(storage.indexStats().files, 1u);
+}
+
+TEST_F(StorageManagerTest, Index_MatchesRebuildAfterAppends) {
+    storage.setIndexing(true);
+    EXPECT_EQ(storage.createFile("log"), Response::OK);
+    std::mt19937 generator(11);
+    std::uniform_int_distribution<int> pick(0, 5);
+    const char* words[] = {"alpha", "beta", "gam", "ma", " ", "\n"};
+    for (int i = 0; i < 200; ++i) {
+        std::string piece;
+        for (int j = 0; j < 4; ++j) piece += words[pick(generator)];
+        EXPECT_EQ(storage.editFile("log", piece), Response::OK);
+    }
+    auto incremental = indexHits(storage, "gamma");
+    auto stats = storage.indexStats();
+
+    storage.setIndexing(false);
+    storage.setIndexing(true);
+    EXPECT_EQ(indexHits(storage, "gamma"), incremental);
+    EXPECT_EQ(storage.indexStats().postings, stats.postings);
+    EXPECT_EQ(storage.indexStats().terms, stats.terms);
+}
+
+TEST_F(StorageManagerTest, Index_PersistsInBinarySnapshots) {
+    storage.setIndexing(true);
+    EXPECT_EQ(storage.makeDir("a"), Response::OK);
+    EXPECT_EQ(storage.makeDir("b"), Response::OK);
+    EXPECT_EQ(storage.createFile("a/one"), Response::OK);
+    EXPECT_EQ(storage.writeFile("a/one", "shared apple"), Response::OK);
+    EXPECT_EQ(storage.createFile("b/two"), Response::OK);
+    EXPECT_EQ(storage.writeFile("b/two", "shared banana"), Response::OK);
+    EXPECT_EQ(storage.createFile("root"), Response::OK);
+    EXPECT_EQ(storage.writeFile("root", "apple banana"), Response::OK);
+    auto before = indexHits(storage, "shared");
+    ASSERT_EQ(before.size(), 2u);
+    EXPECT_EQ(storage.saveToDisk("index_test.bin"), Response::OK);
+
+    StorageManager loaded;
+    loaded.setSysApi(&mockSysApi);
+    loaded.setIndexing(true);
+    EXPECT_EQ(loaded.loadFromDisk("index_test.bin"), Response::OK);
+    EXPECT_EQ(indexHits(loaded, "shared"), before);
+    EXPECT_EQ(indexHits(loaded, "banana apple"), (std::vector<std::string>{"/root 0 6"}));
+    EXPECT_EQ(loaded.indexStats().terms, storage.indexStats().terms);
+
+    // the saved index stays usable for later changes
+    EXPECT_EQ(loaded.writeFile("a/one", "cherry"), Response::OK);
+    EXPECT_EQ(indexHits(loaded, "shared"), (std::vector<std::string>{"/b/two 0"}));
+
+    // deltas on top of the base make the load index afresh
+    EXPECT_EQ(loaded.saveToDisk("index_test.bin", true), Response::OK);
+    StorageManager replayed;
+    replayed.setSysApi(&mockSysApi);
+    replayed.setIndexing(true);
+    EXPECT_EQ(replayed.loadFromDisk("index_test.bin", true), Response::OK);
+    EXPECT_EQ(indexHits(replayed, "cherry"), (std::vector<std::string>{"/a/one 0"}));
+    EXPECT_EQ(indexHits(replayed, "shared"), (std::vector<std::string>{"/b/two 0"}));
+
+    std::filesystem::remove("data/index_test.bin");
+    std::filesystem::remove("data/index_test.bin.delta");
+}
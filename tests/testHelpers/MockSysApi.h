@@ -38,6 +38,14 @@ public:
         return sys::SysResult::OK;
     }
     
+    sys::SysResult deallocateMemoryBatch(const std::vector<void*>& ptrs) override {
+        sys::SysResult result = sys::SysResult::OK;
+        for (void* ptr : ptrs) {
+            if (deallocateMemory(ptr) != sys::SysResult::OK) result = sys::SysResult::Error;
+        }
+        return result;
+    }
+    
     void freeProcessMemory(int processId) override {}
     
     // Scheduler operations - stubs
@@ -56,20 +64,43 @@ public:
     sys::SysResult copyFile(const std::string&, const std::string&) override { return sys::SysResult::OK; }
     sys::SysResult moveFile(const std::string&, const std::string&) override { return sys::SysResult::OK; }
     sys::SysResult appendFile(const std::string&, const std::string&) override { return sys::SysResult::OK; }
+    sys::SysResult readFileRange(const std::string&, size_t, size_t, std::string&) override { return sys::SysResult::OK; }
+    sys::SysResult writeFileAt(const std::string&, size_t, const std::string&) override { return sys::SysResult::OK; }
+    sys::SysResult statFile(const std::string&, sys::SysApi::FileStat&) override { return sys::SysResult::OK; }
+    sys::SysResult setFileMode(const std::string&, uint16_t) override { return sys::SysResult::OK; }
+    void setCallerPid(int) override {}
+    sys::SysResult openFileView(const std::string&, sys::FileView&) override { return sys::SysResult::OK; }
     
     // Directory operations - stubs
     std::string getWorkingDir() override { return "/"; }
     sys::SysResult listDir(const std::string&, std::vector<std::string>&) override { return sys::SysResult::OK; }
+    sys::SysResult listDirEntries(const std::string&, std::vector<DirEntry>&) override { return sys::SysResult::OK; }
+    sys::SysResult dirUsage(const std::string&, DirUsage&) override { return sys::SysResult::OK; }
+    sys::SysResult setDirQuota(const std::string&, const DirQuota&) override { return sys::SysResult::OK; }
+    sys::SysResult getDirQuota(const std::string&, DirQuota&) override { return sys::SysResult::OK; }
     sys::SysResult makeDir(const std::string&) override { return sys::SysResult::OK; }
     sys::SysResult removeDir(const std::string&) override { return sys::SysResult::OK; }
     sys::SysResult changeDir(const std::string&) override { return sys::SysResult::OK; }
     sys::SysResult copyDir(const std::string&, const std::string&) override { return sys::SysResult::OK; }
     sys::SysResult moveDir(const std::string&, const std::string&) override { return sys::SysResult::OK; }
+    sys::SysResult findFiles(const std::string&, const FindQuery&,
+                             const std::function<bool(const FindEntry&)>&) override { return sys::SysResult::OK; }
+    sys::SysResult grepFiles(const std::string&, const GrepQuery&,
+                             const std::function<bool(const GrepMatch&)>&) override { return sys::SysResult::OK; }
+    sys::SysResult setFileIndex(bool) override { return sys::SysResult::OK; }
+    IndexStats getFileIndexStats() override { return {}; }
+    sys::SysResult searchFileIndex(const std::string&,
+                                   const std::function<bool(const IndexHit&)>&) override { return sys::SysResult::OK; }
     
     // Storage persistence - stubs
-    sys::SysResult saveToDisk(const std::string&) override { return sys::SysResult::OK; }
-    sys::SysResult loadFromDisk(const std::string&) override { return sys::SysResult::OK; }
+    sys::SysResult saveToDisk(const std::string&, bool = false, bool = false) override { return sys::SysResult::OK; }
+    sys::SysResult saveToDiskAsync(const std::string&, bool = false) override { return sys::SysResult::OK; }
+    sys::SysApi::SnapshotStats getSnapshotStats() override { return {}; }
+    sys::SysResult loadFromDisk(const std::string&, bool = false) override { return sys::SysResult::OK; }
+    sys::SysResult compactSnapshot(const std::string&) override { return sys::SysResult::OK; }
     sys::SysResult readFileFromHost(const std::string&, std::string&) override { return sys::SysResult::OK; }
+    sys::SysResult importTree(const std::string&, const std::string&, ImportStats&) override { return sys::SysResult::OK; }
+    sys::SysResult exportTree(const std::string&, const std::string&, ExportStats&) override { return sys::SysResult::OK; }
     sys::SysResult resetStorage() override { return sys::SysResult::OK; }
     sys::SysResult listDataFiles(std::vector<std::string>&) override { return sys::SysResult::OK; }
     